@@ -73,6 +73,8 @@
 #define configIDLE_SHOULD_YIELD			 0
 #define configUSE_MUTEXES				 1
 #define configQUEUE_REGISTRY_SIZE		 8
+/* index 1 is used by the pi_task waits */
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 2
 #define configCHECK_FOR_STACK_OVERFLOW	 2
 #define configUSE_RECURSIVE_MUTEXES		 1
 #define configUSE_MALLOC_FAILED_HOOK	 1
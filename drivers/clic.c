@@ -31,35 +31,95 @@
 
 extern void (*isr_table[ISR_TABLE_SIZE])(void);
 
+extern char __vector_start[];
+
+/* encode "jal x0, target" for the vector table entry of the given id */
+static int vector_jump(int id, void (*target)(void), uint32_t *insn)
+{
+	uintptr_t entry = (uintptr_t)__vector_start + 4 * id;
+	int32_t off = (int32_t)((uintptr_t)target - entry);
+
+	/* +-1MiB reach of jal */
+	if (off < -(1 << 20) || off >= (1 << 20))
+		return -1;
+
+	uint32_t imm = (uint32_t)off;
+	*insn = (imm & 0x100000) << 11 | (imm & 0x7fe) << 20 |
+		(imm & 0x800) << 9 | (imm & 0xff000) | 0x6f;
+	return 0;
+}
+
+/* target of the jump in entry 0, which all lines use by default */
+static void (*vector_default(void))(void)
+{
+	uint32_t insn = *(volatile uint32_t *)__vector_start;
+	uint32_t imm = (insn >> 11 & 0x100000) | (insn >> 20 & 0x7fe) |
+		       (insn >> 9 & 0x800) | (insn & 0xff000);
+	/* sign extend the 21 bit offset */
+	int32_t off = (int32_t)(imm << 11) >> 11;
+	return (void (*)(void))((uintptr_t)__vector_start + off);
+}
+
+static void vector_set(int id, uint32_t insn)
+{
+	volatile uint32_t *entry = (volatile uint32_t *)__vector_start + id;
+	if (*entry == insn)
+		return;
+	*entry = insn;
+	/* the vector table is fetched as code */
+	asm volatile("fence.i" ::: "memory");
+}
+
 /* set interrupt handler for given interrupt id */
 void irq_set_handler(int id, void (*handler)(void))
 {
 	assert(0 <= id && id < ISR_TABLE_SIZE);
+	uint32_t insn;
+
 	isr_table[id] = handler;
+
+	/* undo irq_set_fast_handler: back to the kernel trap handler */
+	if (id != 0 && vector_jump(id, vector_default(), &insn) == 0 &&
+	    *((volatile uint32_t *)__vector_start + id) != insn) {
+		irq_set_lvl_and_prio(id, CLIC_KERNEL_LEVEL, CLIC_KERNEL_PRIO);
+		vector_set(id, insn);
+	}
+}
+
+/* Let the given interrupt jump directly to handler. Its level must be above
+ * the ones the kernel masks, so it also preempts other interrupt handlers. */
+int irq_set_fast_handler(int id, void (*handler)(void), int lvl, int prio)
+{
+	assert(0 <= id && id < CLIC_PARAM_NUM_SRC);
+	uint32_t insn;
+
+	if (lvl <= CLIC_MAX_SYSCALL_LEVEL || lvl > (int)BIT_MASK(CLIC_NLBITS))
+		return -1;
+	if (vector_jump(id, handler, &insn))
+		return -1;
+
+	uint32_t ie = readw((uintptr_t)(PULP_CLIC_ADDR + CLIC_CLICINTIE_REG_OFFSET(id)));
+	writew(0ul, (uintptr_t)(PULP_CLIC_ADDR + CLIC_CLICINTIE_REG_OFFSET(id)));
+
+	vector_set(id, insn);
+	irq_set_lvl_and_prio(id, lvl, prio);
+
+	writew(ie, (uintptr_t)(PULP_CLIC_ADDR + CLIC_CLICINTIE_REG_OFFSET(id)));
+	return 0;
 }
 
 /* utility functions for PULPs external interrupt controller */
 void irq_enable(int id)
 {
 	assert(0 <= id && id < CLIC_PARAM_NUM_SRC);
-	/* TODO: enable selective hardware vectoring for interrupt. We might later
-	 * make this configurable */
-	writew(1 << CLIC_CLICINTATTR_SHV_BIT,
-	       (uintptr_t)(PULP_CLIC_ADDR + CLIC_CLICINTATTR_REG_OFFSET(id)));
-
+	/* level, priority and trigger are set up by pulp_irq_init or the
+	 * irq_set_* functions */
 	writew(1ul, (uintptr_t)(PULP_CLIC_ADDR + CLIC_CLICINTIE_REG_OFFSET(id)));
-
-	/* TODO: fix this quick hack which is there just to get going */
-	irq_set_lvl_and_prio(id, 1, 1);
-	/* TODO: assume edge triggered interrupt by default */
-	irq_set_trigger_type(id, CLIC_TRIG_EDGE | CLIC_TRIG_POSITIVE);
 }
 
 void irq_disable(int id)
 {
 	assert(0 <= id && id < CLIC_PARAM_NUM_SRC);
-	writew(0 << CLIC_CLICINTATTR_SHV_BIT,
-	       (uintptr_t)(PULP_CLIC_ADDR + CLIC_CLICINTATTR_REG_OFFSET(id)));
 	writew(0ul, (uintptr_t)(PULP_CLIC_ADDR + CLIC_CLICINTIE_REG_OFFSET(id)));
 }
 
@@ -78,12 +138,8 @@ void irq_clear(int id)
 void irq_set_lvl_and_prio(int id, int lvl, int prio)
 {
 	/* TODO: probe CLICINTCTLBITS */
-	uint32_t nlbits = readw((uintptr_t)(PULP_CLIC_ADDR + CLIC_CLICCFG_REG_OFFSET)) >>
-				  CLIC_CLICCFG_NLBITS_OFFSET &
-			  CLIC_CLICCFG_NLBITS_MASK;
-
-	uint32_t shift = 8 - nlbits;
-	uint32_t val = ((((uint32_t)lvl & BIT_MASK(nlbits)) << shift |
+	uint32_t shift = 8 - CLIC_NLBITS;
+	uint32_t val = ((((uint32_t)lvl & BIT_MASK(CLIC_NLBITS)) << shift |
 			 ((uint32_t)prio & BIT_MASK(shift))) &
 			0xff);
 	writew(val, (uintptr_t)(PULP_CLIC_ADDR + CLIC_CLICINTCTL_REG_OFFSET(id)));
@@ -134,6 +190,16 @@ void pulp_irq_init()
 	/* min threshold, thereby propagating all interrupts */
 	csr_write(CSR_MINTTHRESH, 0x0);
 	/* set nlbits to four which gives 4 bits for level and priority */
-	/* TODO: implement freertos level interrupts */
-	writeb((0x4 << CLIC_CLICCFG_NLBITS_OFFSET), PULP_CLIC_ADDR + CLIC_CLICCFG_REG_OFFSET);
+	writeb((CLIC_NLBITS << CLIC_CLICCFG_NLBITS_OFFSET), PULP_CLIC_ADDR + CLIC_CLICCFG_REG_OFFSET);
+
+	/* Every line starts at the kernel level, hardware vectored to the trap
+	 * handler and edge triggered. Fast handlers raise their level with
+	 * irq_set_fast_handler. */
+	for (int id = 0; id < CLIC_PARAM_NUM_SRC; id++) {
+		writew(1 << CLIC_CLICINTATTR_SHV_BIT |
+			       (CLIC_TRIG_EDGE | CLIC_TRIG_POSITIVE)
+				       << CLIC_CLICINTATTR_TRIG_OFFSET,
+		       (uintptr_t)(PULP_CLIC_ADDR + CLIC_CLICINTATTR_REG_OFFSET(id)));
+		irq_set_lvl_and_prio(id, CLIC_KERNEL_LEVEL, CLIC_KERNEL_PRIO);
+	}
 }
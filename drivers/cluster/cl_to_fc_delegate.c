@@ -37,13 +37,13 @@ void cl_notify_fc_event_handler(void)
 		callback_func((void *)task->arg[1]);
 		pi_task_release(task);
 	}
-	/* Push pi_task callback to event kernel. */
+	/* Blocking task, nothing to run. */
+	else if (task->id == PI_TASK_NONE_ID) {
+		pi_task_release(task);
+	}
+	/* Push pi_task callback to event kernel, which releases it. */
 	else {
-		/* TODO: callbacks are currently not supported */
 		pi_task_push(task);
-		/* TODO: this might not be entirly correct. The sink that consumes the
-		 * tasks should release it */
-		pi_task_release(task);
 	}
 	hal_compiler_barrier();
 	data->task_to_fc = NULL;
@@ -64,6 +64,55 @@ void pi_cl_send_task_to_fc(pi_task_t *task)
 	hal_eu_mutex_unlock(0);
 }
 
+/* Run on the FC, the batch is detached so cores can keep posting. */
+static void cl_fc_req_batch_handler(void *arg)
+{
+	struct cl_fc_req *req = (struct cl_fc_req *)arg;
+	while (req != NULL) {
+		/* The handler may complete the request, read next first. */
+		struct cl_fc_req *next = req->next;
+		req->handler(req);
+		req = next;
+	}
+}
+
+void cl_fc_req_send(struct cl_fc_req *req)
+{
+	struct cluster_driver_data *data = __per_cluster_data[0];
+	req->next = NULL;
+
+	hal_eu_mutex_lock(0);
+	if (data->req_first == NULL) {
+		data->req_first = req;
+	} else {
+		data->req_last->next = req;
+	}
+	data->req_last = req;
+	/* Another core is handing the list over, req goes along. */
+	if (data->req_sender) {
+		hal_eu_mutex_unlock(0);
+		return;
+	}
+	data->req_sender = 1;
+	/* Let the other cores append while the FC slot is busy. */
+	while (data->task_to_fc != NULL) {
+		hal_eu_mutex_unlock(0);
+		hal_compiler_barrier();
+		hal_eu_evt_mask_wait_and_clr(1 << FC_NOTIFY_CLUSTER_EVENT);
+		hal_compiler_barrier();
+		hal_eu_mutex_lock(0);
+	}
+	/* Light callback: the FC handler calls arg[0](arg[1]). */
+	data->req_task.arg[0] = (uintptr_t)cl_fc_req_batch_handler;
+	data->req_task.arg[1] = (uintptr_t)data->req_first;
+	data->req_first = NULL;
+	data->req_last = NULL;
+	data->req_sender = 0;
+	data->task_to_fc = (pi_task_t *)((uint32_t)&data->req_task | 0x1);
+	hal_eu_fc_evt_trig_set(CLUSTER_TO_FC_NOTIFY_IRQN, 0);
+	hal_eu_mutex_unlock(0);
+}
+
 void mc_fc_delegate_init(void *arg)
 {
 	/* Activate interrupt handler for FC when cluster want to push a task to FC */
@@ -73,14 +122,15 @@ void mc_fc_delegate_init(void *arg)
 
 void cl_wait_task(uint8_t *done)
 {
-	/* while ((*(volatile uint8_t *) done) == 0) */
-	/* { */
-	/*     hal_eu_evt_mask_wait_and_clr(1 << FC_NOTIFY_CLUSTER_EVENT); */
-	/* } */
+	/* The event stays pending if the FC triggers it before we sleep. */
+	while ((*(volatile uint8_t *)done) == 0) {
+		hal_eu_evt_mask_wait_and_clr(1 << FC_NOTIFY_CLUSTER_EVENT);
+	}
 }
 
 void cl_notify_task_done(uint8_t *done, uint8_t cluster_id)
 {
-	/* (*(volatile uint8_t *) done) = 1; */
-	/* hal_eu_cluster_evt_trig_set(FC_NOTIFY_CLUSTER_EVENT, 0); */
+	(void)cluster_id;
+	(*(volatile uint8_t *)done) = 1;
+	hal_eu_cluster_evt_trig_set(FC_NOTIFY_CLUSTER_EVENT, 0);
 }
@@ -0,0 +1,332 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Event kernel
+ *
+ * Tasks are handed to the event kernel task through single producer rings, one
+ * for tasks and one for interrupt handlers. On the single hart a producer only
+ * writes the tail and the kernel only the head of a ring, each with one word
+ * store, so pushing masks no interrupts. Tasks serialize their pushes by
+ * suspending the scheduler. A handler finishes before another one at the same
+ * nesting depth starts, so the first depth is a single producer too. A push to
+ * a full ring, or from a nested handler, goes to an overflow list with
+ * interrupts masked, and the ring producers queue behind it until the kernel
+ * takes it to keep their push order. Pushers wake the kernel with a task
+ * notification if it is sleeping.
+ *
+ * Delayed tasks carry their expiry tick in arg[2]. The kernel moves them to
+ * the timer wheel, where the slot is the expiry tick modulo the wheel size,
+ * and sleeps until the nearest expiry. Tasks more than one turn ahead stay in
+ * their slot until their tick comes.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "riscv.h"
+#include "irq.h"
+#include "pmsis_types.h"
+#include "pmsis_task.h"
+#include "event_kernel.h"
+#include "irq_latency.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#if (PI_EVENT_KERNEL_WHEEL_SIZE & (PI_EVENT_KERNEL_WHEEL_SIZE - 1)) != 0
+#error "PI_EVENT_KERNEL_WHEEL_SIZE must be a power of 2"
+#endif
+
+#if (PI_EVENT_KERNEL_RING_SIZE & (PI_EVENT_KERNEL_RING_SIZE - 1)) != 0
+#error "PI_EVENT_KERNEL_RING_SIZE must be a power of 2"
+#endif
+
+#define EK_WHEEL_MASK (PI_EVENT_KERNEL_WHEEL_SIZE - 1)
+#define EK_RING_MASK  (PI_EVENT_KERNEL_RING_SIZE - 1)
+/* Expiry tick of a delayed task. */
+#define EK_EXPIRY(task) ((task)->arg[2])
+/* Set in a ring slot for a delayed push. */
+#define EK_DELAYED ((uintptr_t)1)
+
+/* Rings by interrupt nesting depth: tasks, then interrupt handlers. */
+#define EK_NB_RINGS 2
+
+struct ek_ring {
+	uintptr_t slot[PI_EVENT_KERNEL_RING_SIZE];
+	volatile uint32_t head; /* written by the kernel */
+	volatile uint32_t tail; /* written by the producer */
+};
+
+static struct {
+	TaskHandle_t task;
+	volatile uint32_t waiting; /* kernel about to sleep, written by it */
+	struct ek_ring ring[EK_NB_RINGS];
+	/* pending and delayed pushes which missed the rings, interrupts
+	 * masked */
+	pi_task_t *volatile overflow[2];
+	pi_task_t *overflow_last[2];
+	/* owned by the kernel task */
+	pi_task_t *wheel[PI_EVENT_KERNEL_WHEEL_SIZE];
+	uint32_t nb_timers;
+	TickType_t now; /* last tick the wheel was run for */
+} ek;
+
+static inline TickType_t ek_tick_count(void)
+{
+	return irq_in_isr() ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+}
+
+static int ek_ring_push(struct ek_ring *ring, uintptr_t entry)
+{
+	uint32_t tail = ring->tail;
+	if (tail - ring->head == PI_EVENT_KERNEL_RING_SIZE) {
+		return -1;
+	}
+	ring->slot[tail & EK_RING_MASK] = entry;
+	/* the slot is written before the kernel can see it */
+	hal_compiler_barrier();
+	ring->tail = tail + 1;
+	return 0;
+}
+
+static void ek_overflow_push(pi_task_t *task, uintptr_t delayed)
+{
+	uint32_t irq = __disable_irq();
+	task->next = NULL;
+	if (ek.overflow[delayed] == NULL) {
+		ek.overflow[delayed] = task;
+	} else {
+		ek.overflow_last[delayed]->next = task;
+	}
+	ek.overflow_last[delayed] = task;
+	__restore_irq(irq);
+}
+
+/* Detach an overflow list, oldest task first. */
+static pi_task_t *ek_overflow_take(uintptr_t delayed)
+{
+	if (ek.overflow[delayed] == NULL) {
+		return NULL;
+	}
+	uint32_t irq = __disable_irq();
+	pi_task_t *task = ek.overflow[delayed];
+	ek.overflow[delayed] = NULL;
+	__restore_irq(irq);
+	return task;
+}
+
+static void ek_push(pi_task_t *task, uintptr_t delayed)
+{
+	uint32_t depth = irq_nesting;
+	/* Other tasks may push to the same ring, main() before the scheduler
+	 * starts is alone. */
+	int lock = (depth == 0) &&
+		   (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+
+	if (lock) {
+		vTaskSuspendAll();
+	}
+	if ((depth >= EK_NB_RINGS) || (ek.overflow[0] != NULL) ||
+	    (ek.overflow[1] != NULL) ||
+	    ek_ring_push(&ek.ring[depth], (uintptr_t)task | delayed)) {
+		ek_overflow_push(task, delayed);
+	}
+	if (lock) {
+		xTaskResumeAll();
+	}
+
+	/* The kernel sets waiting before it looks at the rings a last time,
+	 * either it sees this push or this sees it waiting. Not created or
+	 * not started yet, it looks at the rings before its first wait. */
+	hal_compiler_barrier();
+	if (!ek.waiting) {
+		return;
+	}
+	if (depth != 0) {
+		BaseType_t woken = pdFALSE;
+		irq_latency_wake(ek.task);
+		vTaskNotifyGiveFromISR(ek.task, &woken);
+		portYIELD_FROM_ISR(woken);
+	} else {
+		xTaskNotifyGive(ek.task);
+	}
+}
+
+static void ek_run(pi_task_t *task)
+{
+	if (task->id == PI_TASK_CALLBACK_ID) {
+		pi_callback_func_t func = (pi_callback_func_t)task->arg[0];
+		void *arg = (void *)task->arg[1];
+		/* done before the call, the callback may reuse the task */
+		pi_task_release(task);
+		func(arg);
+	} else {
+		pi_task_release(task);
+	}
+}
+
+static void ek_timer_add(pi_task_t *task, TickType_t now)
+{
+	if ((int32_t)(EK_EXPIRY(task) - now) <= 0) {
+		ek_run(task);
+		return;
+	}
+	pi_task_t **slot = &ek.wheel[EK_EXPIRY(task) & EK_WHEEL_MASK];
+	task->next = *slot;
+	*slot = task;
+	ek.nb_timers++;
+}
+
+/* Run the timers of the slots of the ticks elapsed since the last call. */
+static void ek_timer_fire(TickType_t now)
+{
+	uint32_t ticks = now - ek.now;
+	if (ticks > PI_EVENT_KERNEL_WHEEL_SIZE) {
+		ticks = PI_EVENT_KERNEL_WHEEL_SIZE;
+	}
+	for (uint32_t i = 1; (i <= ticks) && (ek.nb_timers != 0); i++) {
+		pi_task_t **prev = &ek.wheel[(ek.now + i) & EK_WHEEL_MASK];
+		while (*prev != NULL) {
+			pi_task_t *task = *prev;
+			if ((int32_t)(EK_EXPIRY(task) - now) > 0) {
+				/* a later turn of the wheel */
+				prev = &task->next;
+				continue;
+			}
+			*prev = task->next;
+			ek.nb_timers--;
+			ek_run(task);
+		}
+	}
+	ek.now = now;
+}
+
+/* Ticks until the nearest timer. */
+static TickType_t ek_timer_timeout(TickType_t now)
+{
+	if (ek.nb_timers == 0) {
+		return portMAX_DELAY;
+	}
+	uint32_t timeout = UINT32_MAX;
+	for (uint32_t i = 0; i < PI_EVENT_KERNEL_WHEEL_SIZE; i++) {
+		for (pi_task_t *task = ek.wheel[i]; task != NULL;
+		     task = task->next) {
+			uint32_t left = EK_EXPIRY(task) - now;
+			if (left < timeout) {
+				timeout = left;
+			}
+		}
+	}
+	return (TickType_t)timeout;
+}
+
+static void ek_dispatch(pi_task_t *task, uintptr_t delayed, TickType_t now)
+{
+	if (delayed) {
+		ek_timer_add(task, now);
+	} else {
+		ek_run(task);
+	}
+}
+
+/* Run or arm everything pushed so far, each ring in push order. */
+static void ek_drain(TickType_t now)
+{
+	for (uint32_t i = 0; i < EK_NB_RINGS; i++) {
+		struct ek_ring *ring = &ek.ring[i];
+		uint32_t head = ring->head;
+		while (head != ring->tail) {
+			/* the slot is read after the tail which covers it */
+			hal_compiler_barrier();
+			uintptr_t entry = ring->slot[head & EK_RING_MASK];
+			/* free the slot before running, the task may push */
+			hal_compiler_barrier();
+			ring->head = ++head;
+			ek_dispatch((pi_task_t *)(entry & ~EK_DELAYED),
+				    entry & EK_DELAYED, now);
+		}
+	}
+	/* after the rings, ring producers queue behind the overflow */
+	for (uintptr_t delayed = 0; delayed < 2; delayed++) {
+		pi_task_t *task = ek_overflow_take(delayed);
+		while (task != NULL) {
+			pi_task_t *next = task->next;
+			ek_dispatch(task, delayed, now);
+			task = next;
+		}
+	}
+}
+
+static int ek_empty(void)
+{
+	for (uint32_t i = 0; i < EK_NB_RINGS; i++) {
+		if (ek.ring[i].head != ek.ring[i].tail) {
+			return 0;
+		}
+	}
+	return (ek.overflow[0] == NULL) && (ek.overflow[1] == NULL);
+}
+
+static void ek_main(void *arg)
+{
+	(void)arg;
+	ek.now = xTaskGetTickCount();
+	for (;;) {
+		TickType_t now = xTaskGetTickCount();
+		ek_drain(now);
+		ek_timer_fire(now);
+
+		ek.waiting = 1;
+		hal_compiler_barrier();
+		if (ek_empty()) {
+			ulTaskNotifyTake(pdTRUE, ek_timer_timeout(now));
+			irq_latency_woken();
+		}
+		ek.waiting = 0;
+	}
+}
+
+int pi_event_kernel_init(void)
+{
+	if (ek.task != NULL) {
+		return 0;
+	}
+	if (xTaskCreate(ek_main, "events", PI_EVENT_KERNEL_STACK_SIZE, NULL,
+			PI_EVENT_KERNEL_PRIORITY, &ek.task) != pdPASS) {
+		return -1;
+	}
+	return 0;
+}
+
+void pi_event_kernel_push(pi_task_t *task)
+{
+	ek_push(task, 0);
+}
+
+void pi_event_kernel_push_delayed(pi_task_t *task, uint32_t delay_us)
+{
+	if (delay_us == 0) {
+		ek_push(task, 0);
+		return;
+	}
+	uint32_t ticks = (uint32_t)(((uint64_t)delay_us * configTICK_RATE_HZ +
+				     999999) / 1000000);
+	EK_EXPIRY(task) = ek_tick_count() + ticks;
+	ek_push(task, EK_DELAYED);
+}
@@ -22,14 +22,24 @@
 #include "memory_map.h"
 #include "pulp_mem_map.h"
 #include "riscv.h"
+#include "irq_latency.h"
 #ifdef CONFIG_CLIC
 #include "clic.h"
 #endif
 
 
+/* Maximum number of events handled per interrupt entry, the interrupt is
+ * taken again if more are pending. */
+#ifndef PI_FC_EVENT_DRAIN_MAX
+#define PI_FC_EVENT_DRAIN_MAX 32
+#endif
+
 static void fc_event_null_event(void *arg);
 
-static volatile pi_fc_event_handler_t fc_event_handlers[NB_SOC_EVENTS];
+static struct {
+	pi_fc_event_handler_t handler;
+	void *arg;
+} fc_event_handlers[NB_SOC_EVENTS];
 
 static void fc_event_null_event(void *arg)
 {
@@ -50,36 +60,52 @@ void pi_fc_event_handler_init(uint32_t fc_event_irq)
 }
 
 void pi_fc_event_handler_set(uint32_t event_id,
-			     pi_fc_event_handler_t event_handler)
+			     pi_fc_event_handler_t event_handler, void *arg)
 {
-	fc_event_handlers[event_id] = event_handler;
+	uint32_t irq = __disable_irq();
+	fc_event_handlers[event_id].handler = event_handler;
+	fc_event_handlers[event_id].arg = arg;
+	__restore_irq(irq);
 }
 
 void pi_fc_event_handler_clear(uint32_t event_id)
 {
-	fc_event_handlers[event_id] =
-		(pi_fc_event_handler_t)fc_event_null_event;
+	pi_fc_event_handler_set(event_id, fc_event_null_event, NULL);
+}
+
+static inline void fc_event_dispatch(uint32_t event)
+{
+	event &= 0xff;
+	/* redirect to handler with jump table */
+	if (fc_event_handlers[event].handler != NULL) {
+		uint32_t start = irq_latency_soc_event_enter();
+		fc_event_handlers[event].handler(fc_event_handlers[event].arg);
+		irq_latency_soc_event_exit(start);
+	}
 }
 
-/* TODO: fix */
 __attribute__((section(".text"))) void fc_soc_event_handler(void)
 {
-	uint32_t event = 0;
+#ifdef CONFIG_CLIC
 	/* When we are using the clic, we don't have the SIMPLE_IRQ FIFO
 	 * register anymore. Instead, we have a minimal event_to_level_int
 	 * convertor that takes over the role of generating a level sensitive
 	 * interrupt on the CLIC and contains a small register storing the event
-	 * data. This data needs to be read to clear the interrupt */
-#ifdef CONFIG_CLIC
-	event = readw((uintptr_t)PULP_EVENT_TO_INT_ADDR);
+	 * data. This data needs to be read to clear the interrupt. It holds a
+	 * single event, the next one raises the level again. */
+	fc_event_dispatch(readw((uintptr_t)PULP_EVENT_TO_INT_ADDR));
 #else
-	/* Pop one event element from the FIFO */
-	event = SIMPLE_IRQ->FIFO;
-#endif
-	event &= 0xff;
-
-	/* redirect to handler with jump table */
-	if (fc_event_handlers[event] != NULL) {
-		fc_event_handlers[event]((void *)event);
+	/* Drain the FIFO instead of taking one interrupt per event. The
+	 * controller sets the soc event line again for an event left in the
+	 * FIFO after a pop. Clear the line before each pop, so that setting it
+	 * again is never lost, and pop again while it is set. */
+	for (int i = 0; i < PI_FC_EVENT_DRAIN_MAX; i++) {
+		SIMPLE_IRQ->IRQ_CLEAR = BIT(IRQ_FC_EVT_SOC_EVT);
+		uint32_t event = SIMPLE_IRQ->FIFO;
+		fc_event_dispatch(event);
+		if (!(SIMPLE_IRQ->IRQ & BIT(IRQ_FC_EVT_SOC_EVT))) {
+			break;
+		}
 	}
+#endif
 }
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2021 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * High resolution clock and timers on the high half of the FC timer
+ *
+ * The 32-bit counter runs freely and the wraps are counted on each read. The
+ * compare is never more than half a wrap ahead, so the interrupt handler reads
+ * the counter often enough to see every wrap. Running timers are kept in a
+ * list sorted by expiry, the compare is set to the first one.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "pulp_mem_map.h"
+#include "io.h"
+#include "irq.h"
+#include "riscv.h"
+#include "timer.h"
+#include "system.h"
+#include "hrtimer.h"
+
+/* furthest compare value from the current count */
+#define HRTIMER_MAX_DELTA (1ull << 31)
+
+static struct {
+	uint32_t started;
+	uint32_t freq;
+	uint32_t last; /* counter at the last read */
+	uint32_t high; /* number of wraps */
+	struct hrtimer *timers; /* sorted by expiry */
+} hr;
+
+/* with interrupts disabled */
+static uint64_t hr_now(void)
+{
+	uint32_t cnt = readw((uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CNT_HI_OFFSET));
+	if (cnt < hr.last)
+		hr.high++;
+	hr.last = cnt;
+	return (uint64_t)hr.high << 32 | cnt;
+}
+
+static uint64_t hr_us_to_cycles(uint32_t us)
+{
+	return (uint64_t)us * hr.freq / 1000000;
+}
+
+static void hr_insert(struct hrtimer *timer)
+{
+	struct hrtimer **prev = &hr.timers;
+	while (*prev != NULL && (*prev)->expiry <= timer->expiry)
+		prev = &(*prev)->next;
+	timer->next = *prev;
+	*prev = timer;
+	timer->active = 1;
+}
+
+static void hr_remove(struct hrtimer *timer)
+{
+	struct hrtimer **prev = &hr.timers;
+	while (*prev != NULL && *prev != timer)
+		prev = &(*prev)->next;
+	if (*prev != NULL)
+		*prev = timer->next;
+	timer->active = 0;
+}
+
+/* Set the compare for the first timer, returns 0 if it expired already. */
+static int hr_arm(void)
+{
+	uint64_t next = hr_now() + HRTIMER_MAX_DELTA;
+	if (hr.timers != NULL && hr.timers->expiry < next)
+		next = hr.timers->expiry;
+
+	writew((uint32_t)next, (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CMP_HI_OFFSET));
+	/* the compare only matches the exact count, it must still be ahead */
+	return hr_now() < next;
+}
+
+static void hr_irq_handler(void)
+{
+	do {
+		uint64_t now = hr_now();
+		while (hr.timers != NULL && hr.timers->expiry <= now) {
+			struct hrtimer *timer = hr.timers;
+			hr.timers = timer->next;
+			timer->active = 0;
+			if (timer->period) {
+				/* skip the periods we missed */
+				uint64_t late = now - timer->expiry;
+				timer->expiry += (late / timer->period + 1) *
+						 timer->period;
+				hr_insert(timer);
+			}
+			timer->func(timer->arg);
+		}
+	} while (!hr_arm());
+}
+
+int hrtimer_init(void)
+{
+	if (hr.started)
+		return 0;
+
+	uint32_t irq = __disable_irq();
+	if (!hr.started) {
+		hr.freq = system_core_clock_get();
+		hr.last = 0;
+		hr.high = 0;
+		/* free running on the SoC clock, interrupt on compare */
+		writew(TIMER_CFG_HI_ENABLE_MASK | TIMER_CFG_HI_RESET_MASK |
+			       TIMER_CFG_HI_IRQEN_MASK,
+		       (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CFG_HI_OFFSET));
+		irq_set_handler(IRQ_FC_EVT_TIMER0_HI, hr_irq_handler);
+		hr_arm();
+		irq_enable(IRQ_FC_EVT_TIMER0_HI);
+		irq_clint_enable(IRQ_FC_EVT_TIMER0_HI);
+		hr.started = 1;
+	}
+	__restore_irq(irq);
+	return 0;
+}
+
+uint64_t hrtimer_get_cycles(void)
+{
+	hrtimer_init();
+
+	uint32_t irq = __disable_irq();
+	uint64_t now = hr_now();
+	__restore_irq(irq);
+	return now;
+}
+
+uint32_t hrtimer_get_freq(void)
+{
+	hrtimer_init();
+	return hr.freq;
+}
+
+uint64_t hrtimer_get_us(void)
+{
+	uint64_t cycles = hrtimer_get_cycles();
+	return cycles / hr.freq * 1000000 +
+	       cycles % hr.freq * 1000000 / hr.freq;
+}
+
+void hrtimer_setup(struct hrtimer *timer, void (*func)(void *arg), void *arg)
+{
+	timer->next = NULL;
+	timer->func = func;
+	timer->arg = arg;
+	timer->active = 0;
+}
+
+void hrtimer_start(struct hrtimer *timer, uint32_t delay_us,
+		   uint32_t period_us)
+{
+	hrtimer_init();
+
+	uint32_t irq = __disable_irq();
+	if (timer->active)
+		hr_remove(timer);
+	timer->expiry = hr_now() + hr_us_to_cycles(delay_us);
+	timer->period = hr_us_to_cycles(period_us);
+	hr_insert(timer);
+	if (!hr_arm()) {
+		/* expire it from the interrupt handler */
+		irq_pend(IRQ_FC_EVT_TIMER0_HI);
+	}
+	__restore_irq(irq);
+}
+
+void hrtimer_stop(struct hrtimer *timer)
+{
+	uint32_t irq = __disable_irq();
+	if (timer->active)
+		hr_remove(timer);
+	__restore_irq(irq);
+}
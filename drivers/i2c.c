@@ -16,6 +16,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
+
 #include "i2c.h"
 #include "udma.h"
 #include "udma_i2c.h"
@@ -25,6 +27,8 @@
 #include "fc_event.h"
 #include "freq.h"
 #include "debug.h"
+#include "udma_bounce.h"
+#include "udma_queue.h"
 
 /*
  * pi_task:
@@ -33,28 +37,29 @@
  * data[2] = flags
  * data[3] = channel
  * data[4] = p_cs_data
- * data[5] = repeat_size
+ * data[5] = tx_buf of a write-read, l2_buf is then the RX buffer
+ * data[6] = tx_size of a write-read, 0 otherwise
  */
 
 void pi_l2_free(void *chunk, int size);
 void *pi_l2_malloc(int size);
 
+/* Bytes written inline in the command sequence of a write-read. */
+#define __PI_I2C_INLINE_TX_SIZE (8)
 /* Length of i2c cmd buffer. */
-#define __PI_I2C_CMD_BUFF_SIZE (16)
+#define __PI_I2C_CMD_BUFF_SIZE (16 + __PI_I2C_INLINE_TX_SIZE)
 /* Lenght of i2c stop command sequence. */
 #define __PI_I2C_STOP_CMD_SIZE (4)
 /* Lenght of i2c eot subset of stop command sequence. */
 #define __PI_I2C_ONLY_EOT_CMD_SIZE (3)
+/* Length of the command of a chunk after the first one, with a restart. */
+#define __PI_I2C_CHUNK_CMD_SIZE (8)
 
-struct i2c_pending_transfer_s {
-	uint32_t pending_buffer;
-	uint32_t pending_size;
-	uint32_t pending_repeat;
-	uint32_t pending_repeat_size;
-	pi_i2c_xfer_flags_e flags;
-	uint8_t device_id;
-	udma_channel_e channel;
-};
+/* Next part of the running transfer to send on the TX channel. */
+#define __PI_I2C_STAGE_CMD  0 /* command of the next chunk, or stop */
+#define __PI_I2C_STAGE_DATA 1 /* data of the current chunk (write) */
+#define __PI_I2C_STAGE_STOP 2 /* stop or eot sequence */
+#define __PI_I2C_STAGE_END  3 /* nothing left */
 
 struct i2c_cs_data_s {
 	uint8_t device_id;	    /*!< I2C interface ID. */
@@ -64,22 +69,40 @@ struct i2c_cs_data_s {
 	struct i2c_cs_data_s *next; /*!< Pointer to next i2c cs data struct. */
 };
 
+/* A transfer prepared for the hardware. */
+struct i2c_xfer_s {
+	struct pi_task *task;			       /*!< NULL if the slot is free. */
+	uint8_t cmd_seq[__PI_I2C_CMD_BUFF_SIZE];       /*!< Header and first chunk command. */
+	uint8_t chunk_seq[2][__PI_I2C_CHUNK_CMD_SIZE]; /*!< Commands of next chunks,
+							 alternated. */
+	uint32_t cmd_size;			       /*!< Size of cmd_seq. */
+	uint32_t buffer;			       /*!< Data of the next chunk to write. */
+	uint32_t rx_buffer;			       /*!< Buffer of the RX channel. */
+	uint32_t rx_size;			       /*!< Bytes to read, after the write if any. */
+	uint32_t left;				       /*!< Bytes not covered by a command yet. */
+	uint32_t chunk;				       /*!< Size of the chunk to write. */
+	uint8_t read;				       /*!< Set if the read part is running. */
+	uint8_t restart;			       /*!< Read address byte of a write-read. */
+	uint8_t stage;				       /*!< Next part to send. */
+	uint8_t seq;				       /*!< Next chunk_seq to use. */
+	uint8_t stop_send;			       /*!< Set if a stop cmd seq should be sent. */
+	uint8_t *bounce_buf;			       /*!< Bounce buffer of the transfer. */
+	uint32_t bounce_user;			       /*!< User buffer to copy RX data to. */
+	uint32_t bounce_size;			       /*!< Size of the bounced data. */
+};
+
 struct i2c_itf_data_s {
 	/* Best to use only one queue since both RX & TX can be used at the same time. */
-	struct pi_task *buf[2];		/*!< RX + TX */
-	struct pi_task *fifo_head;		/*!< Head of SW fifo waiting transfers. */
-	struct pi_task *fifo_tail;		/*!< Tail of SW fifo waiting transfers. */
-	struct i2c_pending_transfer_s *pending; /*!< RX + TX. */
+	struct i2c_xfer_s xfer[2];		/*!< Running transfer and the next one. */
+	uint8_t cur;				/*!< Slot of the running transfer. */
+	struct udma_queue queue;		/*!< Transfers, head is the running one. */
 	uint32_t nb_open;			/*!< Number of devices opened. */
-	uint32_t i2c_cmd_index;			/*!< Number of commands in i2c_cmd_seq. */
 	/* pi_freq_cb_t i2c_freq_cb;		/\*!< Callback associated to frequency changes. *\/
 	 */
 	struct i2c_cs_data_s *cs_list;		      /*!< List of i2c associated to this itf. */
-	uint8_t i2c_cmd_seq[__PI_I2C_CMD_BUFF_SIZE];  /*!< Command sequence. */
-	uint8_t i2c_stop_send;			      /*!< Set if a stop cmd seq should be sent. */
 	uint8_t i2c_stop_seq[__PI_I2C_STOP_CMD_SIZE]; /*!< Command STOP sequence. */
-	uint8_t i2c_eot_send;			      /*!< Set if a eot cmd seq should be sent. */
 	uint8_t* i2c_only_eot_seq;                    /*!< Only EOT sequence part of of STOP sequence */
+	uint8_t tx_pending;			      /*!< Parts in the TX channel. */
 	uint8_t device_id;			      /*!< I2C interface ID. */
 	/* This variable is used to count number of events received to handle EoT sequence. */
 	uint8_t nb_events; /*!< Number of events received. */
@@ -101,6 +124,10 @@ void __pi_i2c_ioctl(struct i2c_cs_data_s *device_data, uint32_t cmd, void *arg);
 void __pi_i2c_copy(struct i2c_cs_data_s *cs_data, uint32_t l2_buff, uint32_t length,
 		   pi_i2c_xfer_flags_e flags, udma_channel_e channel, struct pi_task *task);
 
+/* Write then read with a repeated start, as one transfer. */
+void __pi_i2c_write_read(struct i2c_cs_data_s *cs_data, uint32_t tx_buff, uint32_t rx_buff,
+			 uint32_t tx_size, uint32_t rx_size, struct pi_task *task);
+
 /* Scan i2c bus to detect connected devices. */
 int32_t __pi_i2c_detect(struct i2c_cs_data_s *cs_data, struct pi_i2c_conf *conf, uint8_t *rx_data,
 			struct pi_task *task);
@@ -215,10 +242,39 @@ void pi_i2c_write_async(struct pi_device *device, uint8_t *tx_data, int length,
 	__pi_i2c_copy(device_data, (uint32_t)tx_data, (uint32_t)length, flags, channel, task);
 }
 
+void pi_i2c_write_read(struct pi_device *device, void *tx_buffer, void *rx_buffer,
+		       uint32_t tx_size, uint32_t rx_size)
+{
+	pi_task_t task_block;
+	pi_task_block(&task_block);
+	pi_i2c_write_read_async(device, tx_buffer, rx_buffer, tx_size, rx_size, &task_block);
+	pi_task_wait_on(&task_block);
+	pi_task_destroy(&task_block);
+}
+
+void pi_i2c_write_read_async(struct pi_device *device, void *tx_buffer, void *rx_buffer,
+			     uint32_t tx_size, uint32_t rx_size, pi_task_t *callback)
+{
+	struct i2c_cs_data_s *device_data = (struct i2c_cs_data_s *)device->data;
+	I2C_TRACE("I2C(%d) : write-read %lx %ld %lx %ld, task %lx\n", device_data->device_id,
+		  (uint32_t)tx_buffer, tx_size, (uint32_t)rx_buffer, rx_size, callback);
+	if (tx_size == 0) {
+		__pi_i2c_copy(device_data, (uint32_t)rx_buffer, rx_size,
+			      PI_I2C_XFER_START | PI_I2C_XFER_STOP, RX_CHANNEL, callback);
+		return;
+	}
+	if (rx_size == 0) {
+		__pi_i2c_copy(device_data, (uint32_t)tx_buffer, tx_size,
+			      PI_I2C_XFER_START | PI_I2C_XFER_STOP, TX_CHANNEL, callback);
+		return;
+	}
+	__pi_i2c_write_read(device_data, (uint32_t)tx_buffer, (uint32_t)rx_buffer, tx_size,
+			    rx_size, callback);
+}
+
 int pi_i2c_get_request_status(pi_task_t *task)
 {
-	(void)task;
-	return PI_OK;
+	return pi_task_status_get(task);
 }
 
 int pi_i2c_detect(struct pi_device *device, struct pi_i2c_conf *conf, uint8_t *rx_data)
@@ -262,8 +318,14 @@ static void __pi_i2c_cs_data_add(struct i2c_itf_data_s *driver_data, struct i2c_
 static void __pi_i2c_cs_data_remove(struct i2c_itf_data_s *driver_data,
 				    struct i2c_cs_data_s *cs_data);
 
-/* Handle a pending transfer after end of previous part of transfer. */
-static void __pi_i2c_handle_pending_transfer(struct i2c_itf_data_s *driver_data);
+/* Fill the command of the next chunk of a transfer. */
+static uint32_t __pi_i2c_chunk_cmd(struct i2c_xfer_s *xfer, uint8_t *seq);
+
+/* Fill the repeated start and first read command of a write-read. */
+static uint32_t __pi_i2c_restart_cmd(struct i2c_xfer_s *xfer, uint8_t *seq);
+
+/* Enqueue the next part of the running transfer in the TX channel. */
+static int __pi_i2c_tx_next(struct i2c_itf_data_s *driver_data);
 
 /* Send a stop command sequence. */
 static void __pi_i2c_send_stop_cmd(struct i2c_itf_data_s *driver_data);
@@ -271,66 +333,164 @@ static void __pi_i2c_send_stop_cmd(struct i2c_itf_data_s *driver_data);
 /* Send a only eot command sequence. */
 static void __pi_i2c_send_only_eot_cmd(struct i2c_itf_data_s *driver_data);
 
-/* Check if a HW UDMA slot is free. */
-static int32_t __pi_i2c_cb_buf_empty(struct i2c_itf_data_s *driver_data);
+/* Attach a task to a transfer slot. */
+static void __pi_i2c_cb_buf_enqueue(struct i2c_xfer_s *xfer, struct pi_task *task);
 
-/* Enqueue a new task for callback. Currently, there is only a single slot */
-static void __pi_i2c_cb_buf_enqueue(struct i2c_itf_data_s *driver_data, struct pi_task *task);
-
-/* Pop a task from callback buffer . */
+/* Pop the task of the running transfer and free its slot. */
 static struct pi_task *__pi_i2c_cb_buf_pop(struct i2c_itf_data_s *driver_data);
 
-/* Create a new callabck struct with transfer info then enqueue it in SW fifo. */
-static void __pi_i2c_task_fifo_enqueue(struct i2c_itf_data_s *driver_data, struct pi_task *task);
+/* Get an uDMA reachable address for a buffer, through the bounce pool if needed.
+ * Returns 0 if the buffer needs a bounce buffer and none can be taken. */
+static uint32_t __pi_i2c_bounce_get(struct i2c_itf_data_s *driver_data, struct i2c_xfer_s *xfer,
+				    uint32_t buffer, uint32_t size, uint32_t channel);
+
+/* Copy RX data out of the bounce buffer and give it back to the pool. */
+static void __pi_i2c_bounce_release(struct i2c_xfer_s *xfer);
+
+/* Complete current transfer and start the next queued one. */
+static void __pi_i2c_transfer_done(struct i2c_itf_data_s *driver_data);
+
+/* Queue a transfer and start it if the interface is idle. */
+static void __pi_i2c_transfer_enqueue(struct i2c_itf_data_s *driver_data, struct pi_task *task);
+
+/* Start a queued transfer, the caller owns the interface. */
+static void __pi_i2c_copy_exec(struct i2c_itf_data_s *driver_data, struct pi_task *task);
+
+/* Prepare the transfer following the running one in the free slot. */
+static void __pi_i2c_stage_next(struct i2c_itf_data_s *driver_data);
 
-/* Pop a callback struct containing a new transfer from SW fifo. */
-static struct pi_task *__pi_i2c_task_fifo_pop(struct i2c_itf_data_s *driver_data);
+/* Enqueue the prepared transfer of the running slot. */
+static void __pi_i2c_xfer_launch(struct i2c_itf_data_s *driver_data);
 
-/* Initiate and enqueue a read command sequence. */
-static void __pi_i2c_copy_exec_read(struct i2c_itf_data_s *driver_data, struct pi_task *task);
+/* Prepare the command sequence of a transfer in a slot. Returns -1 if a
+ * buffer outside L2 could not get a bounce buffer. */
+static int __pi_i2c_prepare(struct i2c_itf_data_s *driver_data, struct i2c_xfer_s *xfer,
+			    struct pi_task *task);
 
-/* Initiate and enqueue a write command sequence. */
-static void __pi_i2c_copy_exec_write(struct i2c_itf_data_s *driver_data, struct pi_task *task);
+/* Prepare a write-read command sequence. */
+static int __pi_i2c_prepare_write_read(struct i2c_itf_data_s *driver_data,
+				       struct i2c_xfer_s *xfer, struct pi_task *task);
+
+/* Prepare a read command sequence. */
+static int __pi_i2c_prepare_read(struct i2c_itf_data_s *driver_data, struct i2c_xfer_s *xfer,
+				 struct pi_task *task);
+
+/* Prepare a write command sequence. */
+static int __pi_i2c_prepare_write(struct i2c_itf_data_s *driver_data, struct i2c_xfer_s *xfer,
+				  struct pi_task *task);
 
 /* Callback to execute when frequency changes. */
 __attribute__((unused)) static void __pi_i2c_freq_cb(void *args);
 
-static void __pi_i2c_handle_pending_transfer(struct i2c_itf_data_s *driver_data)
+/*
+ * A transfer is split in chunks of at most MAX_SIZE bytes, the count of a
+ * repeat command. Its parts (header with the first chunk command, write data,
+ * command of the next chunk, ..., stop) are chained on the TX channel from
+ * the TX handler, always keeping the two slots of the channel busy. A read
+ * receives all its data with a single RX transfer.
+ *
+ * While a transfer runs, the next queued one is prepared in the other slot
+ * (command sequence, bounce buffer) so that the end of transfer handler only
+ * has to enqueue it.
+ */
+static uint32_t __pi_i2c_chunk_cmd(struct i2c_xfer_s *xfer, uint8_t *seq)
 {
-	struct i2c_pending_transfer_s *pending = driver_data->pending;
-	pending->pending_buffer += pending->pending_repeat;
-	pending->pending_repeat_size -= pending->pending_repeat;
-	pending->pending_size = pending->pending_repeat;
-
-	if (pending->pending_repeat_size <= pending->pending_repeat) {
-		pending->pending_repeat = 0;
-		pending->pending_size = pending->pending_repeat_size;
-		/* Stop bit at the end? */
-		driver_data->i2c_stop_send = (pending->flags & PI_I2C_XFER_NO_STOP) ? 0 : 1;
+	uint32_t index = 0;
+	uint32_t size = xfer->left;
+	if (size > (uint32_t)MAX_SIZE) {
+		size = (uint32_t)MAX_SIZE;
+	}
+	xfer->left -= size;
+	if (xfer->read) {
+		/* The last byte of the transfer is not acknowledged. */
+		uint32_t ack = (xfer->left == 0) ? size - 1 : size;
+		if (ack > 0) {
+			seq[index++] = I2C_CMD_RPT;
+			seq[index++] = ack;
+			seq[index++] = I2C_CMD_RD_ACK;
+		}
+		if (xfer->left == 0) {
+			seq[index++] = I2C_CMD_RD_NACK;
+		}
+	} else {
+		seq[index++] = I2C_CMD_RPT;
+		seq[index++] = size;
+		seq[index++] = I2C_CMD_WR;
+		xfer->chunk = size;
+		xfer->stage = __PI_I2C_STAGE_DATA;
 	}
-	/* Initiate next part of command sequence. */
-	{
-		/* Data. */
-		uint32_t index = 0;
-		driver_data->i2c_cmd_seq[index++] = I2C_CMD_RPT;
-		driver_data->i2c_cmd_seq[index++] = pending->pending_size;
-		driver_data->i2c_cmd_seq[index++] = I2C_CMD_WR;
+	return index;
+}
+
+static uint32_t __pi_i2c_restart_cmd(struct i2c_xfer_s *xfer, uint8_t *seq)
+{
+	uint32_t index = 0;
+	seq[index++] = I2C_CMD_START;
+	seq[index++] = I2C_CMD_WR;
+	seq[index++] = xfer->restart;
+	xfer->read = 1;
+	xfer->left = xfer->rx_size;
+	index += __pi_i2c_chunk_cmd(xfer, &seq[index]);
+	return index;
+}
+
+static int __pi_i2c_tx_next(struct i2c_itf_data_s *driver_data)
+{
+	struct i2c_xfer_s *xfer = &driver_data->xfer[driver_data->cur];
+	switch (xfer->stage) {
+	case __PI_I2C_STAGE_CMD:
+		if (xfer->left != 0) {
+			/* The other one may still be in the channel. */
+			uint8_t *seq = xfer->chunk_seq[xfer->seq];
+			xfer->seq ^= 1;
+			uint32_t size = __pi_i2c_chunk_cmd(xfer, seq);
+			hal_i2c_enqueue(driver_data->device_id, TX_CHANNEL, (uint32_t)seq, size,
+					UDMA_CORE_TX_CFG_EN(1));
+			break;
+		}
+		if (!xfer->read && (xfer->rx_size != 0)) {
+			/* Written, turn the bus around. */
+			uint8_t *seq = xfer->chunk_seq[xfer->seq];
+			xfer->seq ^= 1;
+			uint32_t size = __pi_i2c_restart_cmd(xfer, seq);
+			hal_i2c_enqueue(driver_data->device_id, TX_CHANNEL, (uint32_t)seq, size,
+					UDMA_CORE_TX_CFG_EN(1));
+			break;
+		}
+		/* fall through */
+	case __PI_I2C_STAGE_STOP:
+		xfer->stage = __PI_I2C_STAGE_END;
+		if (xfer->stop_send) {
+			__pi_i2c_send_stop_cmd(driver_data);
+			break;
+		}
+#ifdef CONFIG_UDMA_I2C_EOT
+		__pi_i2c_send_only_eot_cmd(driver_data);
+		break;
+#else
+		return 0;
+#endif
+	case __PI_I2C_STAGE_DATA:
+		hal_i2c_enqueue(driver_data->device_id, TX_CHANNEL, xfer->buffer, xfer->chunk,
+				UDMA_CORE_TX_CFG_EN(1));
+		xfer->buffer += xfer->chunk;
+		xfer->stage = __PI_I2C_STAGE_CMD;
+		break;
+	default:
+		return 0;
 	}
-	// hal_i2c_enqueue(device_id, driver_data->channel);
-	/* TODO: Renqueue next cmd! */
+	driver_data->tx_pending++;
+	return 1;
 }
 
 static void __pi_i2c_send_stop_cmd(struct i2c_itf_data_s *driver_data)
 {
-	driver_data->i2c_stop_send = 0;
-	driver_data->i2c_eot_send = 0;
 	hal_i2c_enqueue(driver_data->device_id, TX_CHANNEL, (uint32_t)driver_data->i2c_stop_seq,
 			(uint32_t)__PI_I2C_STOP_CMD_SIZE, UDMA_CORE_TX_CFG_EN(1));
 }
 
 static void __pi_i2c_send_only_eot_cmd(struct i2c_itf_data_s *driver_data)
 {
-	driver_data->i2c_eot_send = 0;
 	hal_i2c_enqueue(driver_data->device_id, TX_CHANNEL, (uint32_t)driver_data->i2c_only_eot_seq,
 			(uint32_t)__PI_I2C_ONLY_EOT_CMD_SIZE, UDMA_CORE_TX_CFG_EN(1));
 }
@@ -357,40 +517,21 @@ static void __pi_i2c_rx_handler(void *arg)
 
 static void __pi_i2c_tx_handler(void *arg)
 {
-	uint32_t event = (uint32_t)arg;
-	uint32_t periph_id = (event >> UDMA_CHANNEL_NB_EVENTS_LOG2) - UDMA_I2C_ID(0);
-
-	struct i2c_itf_data_s *driver_data = g_i2c_itf_data[periph_id];
+	struct i2c_itf_data_s *driver_data = arg;
 	/*
-	 * In case of a read command sequence, TX ends first then wait on RX.
+	 * One part of the transfer left the TX channel, refill the slot. In
+	 * case of a read command sequence, TX ends first then wait on RX.
 	 * Until then, no other transaction should occur.
 	 */
-	/* Pending transfer. */
-	if (driver_data->pending->pending_repeat) {
-		/* FIXME: not implemented */
-		__pi_i2c_handle_pending_transfer(driver_data);
-	} else if (driver_data->i2c_stop_send) {
-		__pi_i2c_send_stop_cmd(driver_data);
-#ifdef CONFIG_UDMA_I2C_EOT
-	} else if (driver_data->i2c_eot_send){
-		__pi_i2c_send_only_eot_cmd(driver_data);
-#else
-	} else {
-		struct pi_task *task = __pi_i2c_cb_buf_pop(driver_data);
-		if (task)
-			__pi_irq_handle_end_of_task(task);
-
-		task = __pi_i2c_task_fifo_pop(driver_data);
-		if (task) {
-			/* Enqueue transfer in HW fifo. */
-			if (task->data[3] == RX_CHANNEL) {
-				__pi_i2c_copy_exec_read(driver_data, task);
-			} else {
-				__pi_i2c_copy_exec_write(driver_data, task);
-			}
-		}
+	driver_data->tx_pending--;
+	if (!__pi_i2c_tx_next(driver_data) && (driver_data->tx_pending == 0)) {
+#ifndef CONFIG_UDMA_I2C_EOT
+		__pi_i2c_transfer_done(driver_data);
+		return;
 #endif
 	}
+	/* The bus is busy for a while, prepare the next transfer meanwhile. */
+	__pi_i2c_stage_next(driver_data);
 }
 
 #ifdef CONFIG_UDMA_I2C_EOT
@@ -401,72 +542,150 @@ static void __pi_i2c_tx_handler(void *arg)
  * when you try to detect slave ACK/NACKs. */
 static void __pi_i2c_eot_handler(void *arg)
 {
-	uint32_t event = (uint32_t)arg;
-	uint32_t periph_id = (event >> UDMA_CHANNEL_NB_EVENTS_LOG2) - UDMA_I2C_ID(0);
-	struct i2c_itf_data_s *driver_data = g_i2c_itf_data[periph_id];
+	struct i2c_itf_data_s *driver_data = arg;
+
+	__pi_i2c_transfer_done(driver_data);
+}
+#endif
 
+static void __pi_i2c_transfer_done(struct i2c_itf_data_s *driver_data)
+{
 	struct pi_task *task = __pi_i2c_cb_buf_pop(driver_data);
-	if (task)
+	if (task == NULL)
+		return;
+	/* Bus detection does not go through the queue. */
+	if (task != udma_queue_head(&driver_data->queue)) {
 		__pi_irq_handle_end_of_task(task);
+		return;
+	}
+	udma_queue_pop(&driver_data->queue);
+	__pi_irq_handle_end_of_task(task);
 
-	task = __pi_i2c_task_fifo_pop(driver_data);
+	task = udma_queue_next(&driver_data->queue);
 	if (task) {
-		/* Enqueue transfer in HW fifo. */
-		if (task->data[3] == RX_CHANNEL) {
-			__pi_i2c_copy_exec_read(driver_data, task);
-		} else {
-			__pi_i2c_copy_exec_write(driver_data, task);
+		/* Enqueue transfer in HW fifo, usually already prepared. */
+		__pi_i2c_copy_exec(driver_data, task);
+	}
+}
+
+static void __pi_i2c_copy_exec(struct i2c_itf_data_s *driver_data, struct pi_task *task)
+{
+	struct i2c_xfer_s *staged = &driver_data->xfer[driver_data->cur ^ 1];
+	while (task != NULL) {
+		if (staged->task == task) {
+			driver_data->cur ^= 1;
+			break;
+		}
+		if (__pi_i2c_prepare(driver_data, &driver_data->xfer[driver_data->cur], task) == 0) {
+			break;
 		}
+		/* Fail the transfer, the bus is not touched. */
+		udma_queue_pop(&driver_data->queue);
+		pi_task_status_set(task, -1);
+		__pi_irq_handle_end_of_task(task);
+		task = udma_queue_next(&driver_data->queue);
+	}
+	if (task == NULL) {
+		return;
 	}
+	/* The TX handler must neither run before the parts are counted nor
+	 * stage concurrently. */
+	uint32_t irq = __disable_irq();
+	__pi_i2c_xfer_launch(driver_data);
+	__pi_i2c_stage_next(driver_data);
+	__restore_irq(irq);
 }
-#endif
 
-static int32_t __pi_i2c_cb_buf_empty(struct i2c_itf_data_s *driver_data)
+static void __pi_i2c_stage_next(struct i2c_itf_data_s *driver_data)
 {
-	return  driver_data->buf[0] == NULL;
+	struct i2c_xfer_s *xfer = &driver_data->xfer[driver_data->cur ^ 1];
+	if (xfer->task != NULL) {
+		return;
+	}
+	/* The head is the running transfer. */
+	struct pi_task *task = udma_queue_at(&driver_data->queue, 1);
+	if (task != NULL) {
+		/* On failure it is prepared again once it runs. */
+		(void)__pi_i2c_prepare(driver_data, xfer, task);
+	}
 }
 
-static void __pi_i2c_cb_buf_enqueue(struct i2c_itf_data_s *driver_data, struct pi_task *task)
+static void __pi_i2c_xfer_launch(struct i2c_itf_data_s *driver_data)
 {
-	uint32_t irq = __disable_irq();
-	driver_data->buf[0] = task;
-	__restore_irq(irq);
+	struct i2c_xfer_s *xfer = &driver_data->xfer[driver_data->cur];
+	if (xfer->rx_size != 0) {
+		/* Open RX channel to receive data. */
+		hal_i2c_enqueue(driver_data->device_id, RX_CHANNEL, xfer->rx_buffer, xfer->rx_size,
+				UDMA_CORE_RX_CFG_EN(1));
+	}
+	/* Transfer header, then the next part. */
+	hal_i2c_enqueue(driver_data->device_id, TX_CHANNEL, (uint32_t)xfer->cmd_seq,
+			xfer->cmd_size, UDMA_CORE_TX_CFG_EN(1));
+	driver_data->tx_pending = 1;
+	__pi_i2c_tx_next(driver_data);
+}
+
+/* The slots are only accessed by the owner of the interface. */
+static void __pi_i2c_cb_buf_enqueue(struct i2c_xfer_s *xfer, struct pi_task *task)
+{
+	xfer->task = task;
 }
 
 static struct pi_task *__pi_i2c_cb_buf_pop(struct i2c_itf_data_s *driver_data)
 {
-	uint32_t irq = __disable_irq();
-	struct pi_task *task_to_return = NULL;
-	task_to_return = driver_data->buf[0];
+	struct i2c_xfer_s *xfer = &driver_data->xfer[driver_data->cur];
+	struct pi_task *task_to_return = xfer->task;
 	/* Free the slot for another transfer. */
-	driver_data->buf[0] = NULL;
-	__restore_irq(irq);
+	xfer->task = NULL;
+	if (xfer->bounce_buf != NULL) {
+		__pi_i2c_bounce_release(xfer);
+	}
 	return task_to_return;
 }
 
-static void __pi_i2c_task_fifo_enqueue(struct i2c_itf_data_s *driver_data, struct pi_task *task)
+static uint32_t __pi_i2c_bounce_get(struct i2c_itf_data_s *driver_data, struct i2c_xfer_s *xfer,
+				    uint32_t buffer, uint32_t size, uint32_t channel)
 {
-	uint32_t irq = __disable_irq();
-	/* Enqueue transfer in SW fifo. */
-	if (driver_data->fifo_head == NULL) {
-		driver_data->fifo_head = task;
-	} else {
-		driver_data->fifo_tail->next = task;
+	if (udma_bounce_is_l2(buffer)) {
+		return buffer;
 	}
-	driver_data->fifo_tail = task;
-	__restore_irq(irq);
+	/* Larger buffers do not fit the pool, they must be reachable by the uDMA,
+	 * as well as the second buffer of a write-read. */
+	uint8_t *buf = NULL;
+	if ((size <= (uint32_t)UDMA_BOUNCE_BUF_SIZE) && (xfer->bounce_buf == NULL)) {
+		buf = udma_bounce_alloc();
+	}
+	if (buf == NULL) {
+		I2C_TRACE_ERR("I2C(%d) : no bounce buffer for %lx !\n", driver_data->device_id,
+			      buffer);
+		return 0;
+	}
+	if (channel == TX_CHANNEL) {
+		memcpy(buf, (void *)buffer, size);
+	}
+	xfer->bounce_buf = buf;
+	xfer->bounce_user = (channel == RX_CHANNEL) ? buffer : 0;
+	xfer->bounce_size = size;
+	return (uint32_t)buf;
 }
 
-static struct pi_task *__pi_i2c_task_fifo_pop(struct i2c_itf_data_s *driver_data)
+/* Give the bounce buffer of a transfer back, without copying it out. */
+static void __pi_i2c_bounce_drop(struct i2c_xfer_s *xfer)
 {
-	struct pi_task *task_to_return = NULL;
-	uint32_t irq = __disable_irq();
-	if (driver_data->fifo_head != NULL) {
-		task_to_return = driver_data->fifo_head;
-		driver_data->fifo_head = driver_data->fifo_head->next;
+	if (xfer->bounce_buf != NULL) {
+		xfer->bounce_user = 0;
+		__pi_i2c_bounce_release(xfer);
 	}
-	__restore_irq(irq);
-	return task_to_return;
+}
+
+static void __pi_i2c_bounce_release(struct i2c_xfer_s *xfer)
+{
+	if (xfer->bounce_user) {
+		memcpy((void *)xfer->bounce_user, xfer->bounce_buf, xfer->bounce_size);
+	}
+	udma_bounce_free(xfer->bounce_buf);
+	xfer->bounce_buf = NULL;
+	xfer->bounce_user = 0;
 }
 
 static uint32_t __pi_i2c_clk_div_get(uint32_t i2c_freq)
@@ -489,134 +708,168 @@ static uint32_t __pi_i2c_clk_div_get(uint32_t i2c_freq)
 	return div;
 }
 
-static void __pi_i2c_copy_exec_read(struct i2c_itf_data_s *driver_data, struct pi_task *task)
+static int __pi_i2c_prepare(struct i2c_itf_data_s *driver_data, struct i2c_xfer_s *xfer,
+			    struct pi_task *task)
+{
+	int status;
+	if (task->data[6] != 0) {
+		status = __pi_i2c_prepare_write_read(driver_data, xfer, task);
+	} else if (task->data[3] == RX_CHANNEL) {
+		status = __pi_i2c_prepare_read(driver_data, xfer, task);
+	} else {
+		status = __pi_i2c_prepare_write(driver_data, xfer, task);
+	}
+	if (status) {
+		__pi_i2c_bounce_drop(xfer);
+	}
+	return status;
+}
+
+static int __pi_i2c_prepare_write_read(struct i2c_itf_data_s *driver_data,
+				       struct i2c_xfer_s *xfer, struct pi_task *task)
 {
 	uint32_t index = 0;
 	uint32_t buffer = task->data[0];
 	uint32_t size = task->data[1];
-	uint32_t flags = task->data[2];
-	uint32_t channel = task->data[3];
+	uint32_t tx_buffer = task->data[5];
+	uint32_t tx_size = task->data[6];
 	struct i2c_cs_data_s *cs_data = (struct i2c_cs_data_s *)task->data[4];
 
-	if (size == 0)
-		return;
-
 	/* Header. */
-	driver_data->i2c_cmd_seq[index++] = I2C_CMD_CFG;
-	driver_data->i2c_cmd_seq[index++] = ((cs_data->clk_div >> 8) & 0xFF);
-	driver_data->i2c_cmd_seq[index++] = (cs_data->clk_div & 0xFF);
-	driver_data->i2c_cmd_seq[index++] = I2C_CMD_START;
-	driver_data->i2c_cmd_seq[index++] = I2C_CMD_WR;
-	driver_data->i2c_cmd_seq[index++] = (cs_data->cs | ADDRESS_READ);
-
-	struct i2c_pending_transfer_s *pending = driver_data->pending;
-	if (size > (uint32_t)MAX_SIZE) {
-		pending->pending_buffer = buffer;
-		pending->pending_repeat = (uint32_t)MAX_SIZE;
-		pending->pending_repeat_size = size;
-		// pending->device_id = driver_data->device_id;
-		pending->flags = flags;
-		pending->channel = channel;
-		size = (uint32_t)MAX_SIZE;
-	} else {
-		pending->pending_repeat = 0;
-		/* Stop bit at then end? */
-		driver_data->i2c_stop_send = (flags & PI_I2C_XFER_NO_STOP) ? 0 : 1;
-		driver_data->i2c_eot_send = 1;
+	xfer->cmd_seq[index++] = I2C_CMD_CFG;
+	xfer->cmd_seq[index++] = ((cs_data->clk_div >> 8) & 0xFF);
+	xfer->cmd_seq[index++] = (cs_data->clk_div & 0xFF);
+	xfer->cmd_seq[index++] = I2C_CMD_START;
+	xfer->cmd_seq[index++] = I2C_CMD_WR;
+	xfer->cmd_seq[index++] = (cs_data->cs | ADDRESS_WRITE);
+
+	xfer->stop_send = 1;
+	xfer->read = 0;
+	xfer->restart = (cs_data->cs | ADDRESS_READ);
+	xfer->rx_size = size;
+	xfer->left = tx_size;
+	xfer->stage = __PI_I2C_STAGE_CMD;
+	xfer->rx_buffer = __pi_i2c_bounce_get(driver_data, xfer, buffer, size, RX_CHANNEL);
+	if (xfer->rx_buffer == 0) {
+		return -1;
 	}
-	/* Data. */
-	if (size > 1) {
-		driver_data->i2c_cmd_seq[index++] = I2C_CMD_RPT;
-		driver_data->i2c_cmd_seq[index++] = size - 1;
-		driver_data->i2c_cmd_seq[index++] = I2C_CMD_RD_ACK;
+	if (tx_size <= (uint32_t)__PI_I2C_INLINE_TX_SIZE) {
+		/* Register address, written from the command sequence itself. */
+		xfer->cmd_seq[index++] = I2C_CMD_RPT;
+		xfer->cmd_seq[index++] = tx_size;
+		xfer->cmd_seq[index++] = I2C_CMD_WR;
+		memcpy(&xfer->cmd_seq[index], (void *)tx_buffer, tx_size);
+		index += tx_size;
+		index += __pi_i2c_restart_cmd(xfer, &xfer->cmd_seq[index]);
+	} else {
+		xfer->buffer = __pi_i2c_bounce_get(driver_data, xfer, tx_buffer, tx_size,
+						   TX_CHANNEL);
+		if (xfer->buffer == 0) {
+			return -1;
+		}
+		index += __pi_i2c_chunk_cmd(xfer, &xfer->cmd_seq[index]);
 	}
-	driver_data->i2c_cmd_seq[index++] = I2C_CMD_RD_NACK;
+	xfer->cmd_size = index;
 
-	/* Enqueue in HW fifo. */
-	__pi_i2c_cb_buf_enqueue(driver_data, task);
+	__pi_i2c_cb_buf_enqueue(xfer, task);
+	return 0;
+}
 
-	/* Open RX channel to receive data. */
-	hal_i2c_enqueue(driver_data->device_id, RX_CHANNEL, buffer, size,
-			UDMA_CORE_RX_CFG_EN(1));
-	/* Transfer command. */
-	hal_i2c_enqueue(driver_data->device_id, TX_CHANNEL,
-			(uint32_t)driver_data->i2c_cmd_seq, index, UDMA_CORE_TX_CFG_EN(1));
+static int __pi_i2c_prepare_read(struct i2c_itf_data_s *driver_data, struct i2c_xfer_s *xfer,
+				 struct pi_task *task)
+{
+	uint32_t index = 0;
+	uint32_t buffer = task->data[0];
+	uint32_t size = task->data[1];
+	uint32_t flags = task->data[2];
+	struct i2c_cs_data_s *cs_data = (struct i2c_cs_data_s *)task->data[4];
+
+	/* Header. */
+	xfer->cmd_seq[index++] = I2C_CMD_CFG;
+	xfer->cmd_seq[index++] = ((cs_data->clk_div >> 8) & 0xFF);
+	xfer->cmd_seq[index++] = (cs_data->clk_div & 0xFF);
+	xfer->cmd_seq[index++] = I2C_CMD_START;
+	xfer->cmd_seq[index++] = I2C_CMD_WR;
+	xfer->cmd_seq[index++] = (cs_data->cs | ADDRESS_READ);
+
+	/* Stop bit at then end? */
+	xfer->stop_send = (flags & PI_I2C_XFER_NO_STOP) ? 0 : 1;
+	xfer->read = 1;
+	xfer->rx_size = size;
+	xfer->left = size;
+	xfer->stage = __PI_I2C_STAGE_CMD;
+	/* Data of the first chunk. */
+	index += __pi_i2c_chunk_cmd(xfer, &xfer->cmd_seq[index]);
+	xfer->cmd_size = index;
+
+	/* Buffer of the RX channel. */
+	xfer->rx_buffer = __pi_i2c_bounce_get(driver_data, xfer, buffer, size, RX_CHANNEL);
+	if (xfer->rx_buffer == 0) {
+		return -1;
+	}
+
+	__pi_i2c_cb_buf_enqueue(xfer, task);
+	return 0;
 }
 
-static void __pi_i2c_copy_exec_write(struct i2c_itf_data_s *driver_data, struct pi_task *task)
+static int __pi_i2c_prepare_write(struct i2c_itf_data_s *driver_data, struct i2c_xfer_s *xfer,
+				  struct pi_task *task)
 {
 	uint32_t index = 0, start_bit = 0;
 	uint32_t buffer = task->data[0];
 	uint32_t size = task->data[1];
 	uint32_t flags = task->data[2];
-	uint32_t channel = task->data[3];
 	struct i2c_cs_data_s *cs_data = (struct i2c_cs_data_s *)task->data[4];
 	start_bit = flags & PI_I2C_XFER_NO_START;
 
 	/* Header. */
-	driver_data->i2c_cmd_seq[index++] = I2C_CMD_CFG;
-	driver_data->i2c_cmd_seq[index++] = ((cs_data->clk_div >> 8) & 0xFF);
-	driver_data->i2c_cmd_seq[index++] = (cs_data->clk_div & 0xFF);
+	xfer->cmd_seq[index++] = I2C_CMD_CFG;
+	xfer->cmd_seq[index++] = ((cs_data->clk_div >> 8) & 0xFF);
+	xfer->cmd_seq[index++] = (cs_data->clk_div & 0xFF);
 	if (!start_bit) {
-		driver_data->i2c_cmd_seq[index++] = I2C_CMD_START;
-		driver_data->i2c_cmd_seq[index++] = I2C_CMD_WR;
-		driver_data->i2c_cmd_seq[index++] = (cs_data->cs | ADDRESS_WRITE);
-	}
-	struct i2c_pending_transfer_s *pending = driver_data->pending;
-	if (size > (uint32_t)MAX_SIZE) {
-		pending->pending_buffer = buffer;
-		pending->pending_repeat = (uint32_t)MAX_SIZE;
-		pending->pending_repeat_size = size;
-		// pending->device_id = driver_data->device_id;
-		pending->flags = flags;
-		pending->channel = channel;
-		size = (uint32_t)MAX_SIZE;
-	} else {
-		pending->pending_repeat = 0;
-		/* Stop bit at the end? */
-		driver_data->i2c_stop_send = (flags & PI_I2C_XFER_NO_STOP) ? 0 : 1;
-		driver_data->i2c_eot_send = 1;
+		xfer->cmd_seq[index++] = I2C_CMD_START;
+		xfer->cmd_seq[index++] = I2C_CMD_WR;
+		xfer->cmd_seq[index++] = (cs_data->cs | ADDRESS_WRITE);
 	}
-	/* Data. */
+	/* Stop bit at the end? */
+	xfer->stop_send = (flags & PI_I2C_XFER_NO_STOP) ? 0 : 1;
+	xfer->read = 0;
+	xfer->rx_size = 0;
+	xfer->left = size;
+	xfer->stage = __PI_I2C_STAGE_CMD;
+	/* Data of the first chunk. */
 	if (size > 0) {
-		driver_data->i2c_cmd_seq[index++] = I2C_CMD_RPT;
-		driver_data->i2c_cmd_seq[index++] = size;
-		driver_data->i2c_cmd_seq[index++] = I2C_CMD_WR;
+		xfer->buffer = __pi_i2c_bounce_get(driver_data, xfer, buffer, size, TX_CHANNEL);
+		if (xfer->buffer == 0) {
+			return -1;
+		}
+		index += __pi_i2c_chunk_cmd(xfer, &xfer->cmd_seq[index]);
 	}
+	xfer->cmd_size = index;
 
-	/* Enqueue in HW fifo. */
-	__pi_i2c_cb_buf_enqueue(driver_data, task);
-
-	/* Transfer header. */
-	hal_i2c_enqueue(driver_data->device_id, TX_CHANNEL,
-			(uint32_t)driver_data->i2c_cmd_seq, index, UDMA_CORE_TX_CFG_EN(1));
-	/* Transfer data. */
-	if (size > 0)
-		hal_i2c_enqueue(driver_data->device_id, TX_CHANNEL, buffer, size,
-				UDMA_CORE_TX_CFG_EN(1));
+	__pi_i2c_cb_buf_enqueue(xfer, task);
+	return 0;
 }
 
 static void __pi_i2c_cs_data_add(struct i2c_itf_data_s *driver_data, struct i2c_cs_data_s *cs_data)
 {
-	struct i2c_cs_data_s *head = driver_data->cs_list;
-	while (head != NULL) {
-		head = head->next;
+	struct i2c_cs_data_s **head = &driver_data->cs_list;
+	while (*head != NULL) {
+		head = &(*head)->next;
 	}
-	head->next = cs_data;
+	*head = cs_data;
 }
 
 static void __pi_i2c_cs_data_remove(struct i2c_itf_data_s *driver_data,
 				    struct i2c_cs_data_s *cs_data)
 {
-	struct i2c_cs_data_s *head = driver_data->cs_list;
-	struct i2c_cs_data_s *prev = driver_data->cs_list;
-	while ((head != NULL) && (head != cs_data)) {
-		prev = head;
+	struct i2c_cs_data_s **head = &driver_data->cs_list;
+	while ((*head != NULL) && (*head != cs_data)) {
 		hal_compiler_barrier();
-		head = head->next;
+		head = &(*head)->next;
 	}
-	if (head != NULL) {
-		prev->next = head->next;
+	if (*head != NULL) {
+		*head = cs_data->next;
 	}
 }
 
@@ -677,18 +930,13 @@ int32_t __pi_i2c_open(struct pi_i2c_conf *conf, struct i2c_cs_data_s **device_da
 			I2C_TRACE_ERR("Driver data alloc failed !\n");
 			return -12;
 		}
-		driver_data->buf[0] = NULL;
-		driver_data->fifo_head = NULL;
-		driver_data->fifo_tail = NULL;
-		driver_data->pending = NULL;
+		/* Both transfer slots free. */
+		memset(driver_data->xfer, 0, sizeof(driver_data->xfer));
+		driver_data->cur = 0;
+		udma_queue_init(&driver_data->queue);
 		driver_data->nb_open = 0;
-		driver_data->i2c_cmd_index = 0;
 		driver_data->cs_list = NULL;
-		for (uint32_t i = 0; i < (uint32_t)__PI_I2C_CMD_BUFF_SIZE; i++) {
-			driver_data->i2c_cmd_seq[i] = 0;
-		}
-		driver_data->i2c_stop_send = 0;
-		driver_data->i2c_eot_send = 0;
+		driver_data->tx_pending = 0;
 		/* Set up i2c cmd stop sequence. */
 		driver_data->i2c_stop_seq[0] = I2C_CMD_STOP;
 		driver_data->i2c_stop_seq[1] = I2C_CMD_WAIT;
@@ -708,11 +956,11 @@ int32_t __pi_i2c_open(struct pi_i2c_conf *conf, struct i2c_cs_data_s **device_da
 		/* Set handlers. */
 		/* Enable SOC events propagation to FC. */
 #ifdef CONFIG_UDMA_I2C_EOT
-		pi_fc_event_handler_set((uint32_t)SOC_EVENT_UDMA_I2C_EOT((int)conf->itf), __pi_i2c_eot_handler);
+		pi_fc_event_handler_set((uint32_t)SOC_EVENT_UDMA_I2C_EOT((int)conf->itf), __pi_i2c_eot_handler, driver_data);
 		hal_soc_eu_set_fc_mask((int)SOC_EVENT_UDMA_I2C_EOT(conf->itf));
 #endif
-		pi_fc_event_handler_set((uint32_t)SOC_EVENT_UDMA_I2C_RX(conf->itf), __pi_i2c_rx_handler);
-		pi_fc_event_handler_set((uint32_t)SOC_EVENT_UDMA_I2C_TX(conf->itf), __pi_i2c_tx_handler);
+		pi_fc_event_handler_set((uint32_t)SOC_EVENT_UDMA_I2C_RX(conf->itf), __pi_i2c_rx_handler, driver_data);
+		pi_fc_event_handler_set((uint32_t)SOC_EVENT_UDMA_I2C_TX(conf->itf), __pi_i2c_tx_handler, driver_data);
 		hal_soc_eu_set_fc_mask(SOC_EVENT_UDMA_I2C_RX(conf->itf));
 		hal_soc_eu_set_fc_mask(SOC_EVENT_UDMA_I2C_TX(conf->itf));
 
@@ -761,10 +1009,6 @@ void __pi_i2c_close(struct i2c_cs_data_s *device_data)
 		/* TODO:  Remove freq callback. */
 		/* pi_freq_callback_remove(&(driver_data->i2c_freq_cb)); */
 
-		/* Clear allocated fifo. */
-		pi_l2_free(driver_data->pending, sizeof(struct i2c_pending_transfer_s));
-		pi_l2_free(driver_data, sizeof(struct i2c_itf_data_s));
-
 		/* Clear handlers. */
 		/* Disable SOC events propagation to FC. */
 #ifdef CONFIG_UDMA_I2C_EOT
@@ -803,34 +1047,51 @@ void __pi_i2c_ioctl(struct i2c_cs_data_s *device_data, uint32_t cmd, void *arg)
 void __pi_i2c_copy(struct i2c_cs_data_s *cs_data, uint32_t l2_buff, uint32_t length,
 		   pi_i2c_xfer_flags_e flags, udma_channel_e channel, struct pi_task *task)
 {
-	uint32_t irq = __disable_irq();
 	task->data[0] = l2_buff;
 	task->data[1] = length;
 	task->data[2] = flags;
 	task->data[3] = channel;
 	task->data[4] = (uint32_t)cs_data;
-	task->next = NULL;
+	task->data[5] = 0;
+	task->data[6] = 0;
+	pi_task_status_set(task, PI_OK);
 	struct i2c_itf_data_s *driver_data = g_i2c_itf_data[cs_data->device_id];
-	int32_t slot_rxtx = __pi_i2c_cb_buf_empty(driver_data);
-	/* Both slots should be empty to start a new read transfer. When enqueueing
-	 * a new read transfer, RX should be opened first then TX. So if RX is already
-	 * in use, then wait for it to finish. */
-	if (slot_rxtx == 0) {
-		/* Enqueue transfer in SW fifo. */
-		I2C_TRACE("I2C(%d) : enqueue transfer in SW fifo : channel %d task %lx.\n",
-			  driver_data->device_id, task->data[3], task);
-		__pi_i2c_task_fifo_enqueue(driver_data, task);
-	} else {
+	/* Nothing to read, no command sequence is sent. */
+	if ((channel == RX_CHANNEL) && (length == 0)) {
+		__pi_irq_handle_end_of_task(task);
+		return;
+	}
+	__pi_i2c_transfer_enqueue(driver_data, task);
+}
+
+static void __pi_i2c_transfer_enqueue(struct i2c_itf_data_s *driver_data, struct pi_task *task)
+{
+	/* Only one transfer runs at a time, since a read needs both RX and TX. The
+	 * others wait in the queue until the running one is done. */
+	I2C_TRACE("I2C(%d) : enqueue transfer : channel %d task %lx.\n",
+		  driver_data->device_id, task->data[3], task);
+	/* Parked while the queue is full, this may run in an interrupt
+	 * handler or a completion callback. */
+	udma_queue_push_defer(&driver_data->queue, task);
+	task = udma_queue_claim(&driver_data->queue);
+	if (task) {
 		/* Enqueue transfer in HW fifo. */
-		I2C_TRACE("I2C(%d) : enqueue transfer in HW fifo : channel %d task %lx.\n",
-			  driver_data->device_id, task->data[3], task);
-		if (task->data[3] == RX_CHANNEL) {
-			__pi_i2c_copy_exec_read(driver_data, task);
-		} else {
-			__pi_i2c_copy_exec_write(driver_data, task);
-		}
+		__pi_i2c_copy_exec(driver_data, task);
 	}
-	__restore_irq(irq);
+}
+
+void __pi_i2c_write_read(struct i2c_cs_data_s *cs_data, uint32_t tx_buff, uint32_t rx_buff,
+			 uint32_t tx_size, uint32_t rx_size, struct pi_task *task)
+{
+	task->data[0] = rx_buff;
+	task->data[1] = rx_size;
+	task->data[2] = PI_I2C_XFER_START | PI_I2C_XFER_STOP;
+	task->data[3] = RX_CHANNEL;
+	task->data[4] = (uint32_t)cs_data;
+	task->data[5] = tx_buff;
+	task->data[6] = tx_size;
+	pi_task_status_set(task, PI_OK);
+	__pi_i2c_transfer_enqueue(g_i2c_itf_data[cs_data->device_id], task);
 }
 
 int32_t __pi_i2c_detect(struct i2c_cs_data_s *cs_data, struct pi_i2c_conf *conf, uint8_t *rx_data,
@@ -855,34 +1116,31 @@ int32_t __pi_i2c_detect(struct i2c_cs_data_s *cs_data, struct pi_i2c_conf *conf,
 	task->next = NULL;
 
 	uint32_t index = 0;
-	uint32_t buffer = (uint32_t)rx_data;
-	uint32_t size = 1;
+	struct i2c_xfer_s *xfer = &driver_data->xfer[driver_data->cur];
 
 	/* Header. */
-	driver_data->i2c_cmd_seq[index++] = I2C_CMD_CFG;
-	driver_data->i2c_cmd_seq[index++] = ((clkdiv >> 8) & 0xFF);
-	driver_data->i2c_cmd_seq[index++] = (clkdiv & 0xFF);
-	driver_data->i2c_cmd_seq[index++] = I2C_CMD_START;
-	driver_data->i2c_cmd_seq[index++] = I2C_CMD_WR;
-	driver_data->i2c_cmd_seq[index++] = ((conf->cs & 0xff) | ADDRESS_READ);
+	xfer->cmd_seq[index++] = I2C_CMD_CFG;
+	xfer->cmd_seq[index++] = ((clkdiv >> 8) & 0xFF);
+	xfer->cmd_seq[index++] = (clkdiv & 0xFF);
+	xfer->cmd_seq[index++] = I2C_CMD_START;
+	xfer->cmd_seq[index++] = I2C_CMD_WR;
+	xfer->cmd_seq[index++] = ((conf->cs & 0xff) | ADDRESS_READ);
 	/* TODO: 10 bit slave address handling */
 
-	struct i2c_pending_transfer_s *pending = driver_data->pending;
-	pending->pending_repeat = 0;
-	/* Stop bit at then end? */
-	driver_data->i2c_stop_send = 1;
-	driver_data->i2c_eot_send = 1;
+	xfer->cmd_seq[index++] = I2C_CMD_RD_NACK;
+	xfer->cmd_size = index;
 
-	driver_data->i2c_cmd_seq[index++] = I2C_CMD_RD_NACK;
+	/* Stop bit at then end? */
+	xfer->stop_send = 1;
+	xfer->read = 1;
+	xfer->rx_buffer = (uint32_t)rx_data;
+	xfer->rx_size = 1;
+	xfer->left = 0;
+	xfer->stage = __PI_I2C_STAGE_STOP;
 
 	/* Enqueue in HW fifo. */
-	__pi_i2c_cb_buf_enqueue(driver_data, task);
-
-	/* Open RX channel to receive data. */
-	hal_i2c_enqueue(driver_data->device_id, RX_CHANNEL, buffer, size, UDMA_CORE_RX_CFG_EN(1));
-	/* Transfer command. */
-	hal_i2c_enqueue(driver_data->device_id, TX_CHANNEL, (uint32_t)driver_data->i2c_cmd_seq,
-			index, UDMA_CORE_TX_CFG_EN(1));
+	__pi_i2c_cb_buf_enqueue(xfer, task);
+	__pi_i2c_xfer_launch(driver_data);
 	__restore_irq(irq);
 	return 0;
 }
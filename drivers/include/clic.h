@@ -20,6 +20,8 @@
 #ifndef __CLIC_H__
 #define __CLIC_H__
 
+#include "bits.h"
+
 /* Number of interrupt sources */
 /* taken from target configuration */
 /* #define CLIC_PARAM_NUM_SRC 256 */
@@ -81,4 +83,22 @@ enum clic_trig {
 #define CLIC_CLICINTCTL_CLICINTCTL_MASK	  0xff
 #define CLIC_CLICINTCTL_CLICINTCTL_OFFSET 0
 
+/* Interrupt levels and priorities, nlbits as set up by pulp_irq_init */
+#define CLIC_NLBITS 4
+
+/* Interrupts up to this level go through the kernel trap handler and may use
+ * the FreeRTOS FromISR API. They do not nest. Fast interrupts above it preempt
+ * them and must not call into the kernel. */
+#ifndef CLIC_MAX_SYSCALL_LEVEL
+#define CLIC_MAX_SYSCALL_LEVEL 1
+#endif
+
+/* default level and priority of a line */
+#define CLIC_KERNEL_LEVEL 1
+#define CLIC_KERNEL_PRIO  1
+
+/* mintthresh value masking every level up to lvl */
+#define CLIC_LEVEL_THRESH(lvl)                                                 \
+	(((lvl) << (8 - CLIC_NLBITS)) | BIT_MASK(8 - CLIC_NLBITS))
+
 #endif /* __CLIC_H__ */
@@ -182,14 +182,15 @@ static inline void hal_cl_dma_flush()
 /* Disabling/re-enabling IRQ is needed to synchronize transfer IDs. */
 static inline void hal_cl_dma_wait(uint8_t tid)
 {
-	uint32_t irq = __disable_irq();
+	/* cluster cores have no CLIC */
+	uint32_t irq = __disable_mie();
 	while (cl_dma_status_get() & (1 << tid)) {
-		__restore_irq(irq);
+		__restore_mie(irq);
 		hal_eu_evt_mask_wait(1 << CL_IRQ_DMA0);
-		irq = __disable_irq();
+		irq = __disable_mie();
 	}
 	hal_cl_dma_tid_free(tid);
-	__restore_irq(irq);
+	__restore_mie(irq);
 }
 
 #endif /* __PI_HAL_CL_DMA_H__ */
@@ -59,6 +59,38 @@ void pi_cl_send_task_to_fc(pi_task_t *task);
 
 /// @cond IMPLEM
 
+/**
+ * \brief Request executed by the FC on behalf of a cluster core.
+ *
+ * Requests posted by several cores while the FC delegation slot is busy are
+ * chained and handed to the FC in a single delegation.
+ */
+struct cl_fc_req {
+	struct cl_fc_req *next;
+	void (*handler)(struct cl_fc_req *req); /*!< Runs on the FC, in IRQ. */
+};
+
+/** \brief Post a request to the FC
+ *
+ * Returns once the request is queued, the handler signals its completion.
+ * \param req request, kept alive until its handler has run
+ */
+void cl_fc_req_send(struct cl_fc_req *req);
+
+/** \brief Sleep on the cluster event unit until done is set
+ *
+ * \param done flag set by cl_notify_task_done() on the FC
+ */
+void cl_wait_task(uint8_t *done);
+
+/** \brief Set done and wake up the cluster cores waiting on it
+ *
+ * Called on the FC.
+ * \param done flag a cluster core waits on with cl_wait_task()
+ * \param cluster_id cluster of the waiting core
+ */
+void cl_notify_task_done(uint8_t *done, uint8_t cluster_id);
+
 
 /** \brief Create an opaque task structure for FC
  * create a task ready to launch on the fc (os dependant implementation)
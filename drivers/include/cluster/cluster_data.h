@@ -52,6 +52,11 @@ struct cluster_driver_data {
 	void *heap_start;
 	uint32_t heap_size;
 	pi_task_t *task_to_fc;
+	// requests batched for the FC, see cl_fc_req_send
+	struct cl_fc_req *req_first;
+	struct cl_fc_req *req_last;
+	pi_task_t req_task;
+	uint8_t req_sender;
 	uint8_t hw_barrier_alloc;
 #if !defined(__DISABLE_PRINTF__) && (defined(PRINTF_UART) || defined(PRINTF_SEMIHOST))
 	uint8_t *printf_buffer;
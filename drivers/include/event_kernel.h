@@ -0,0 +1,85 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __EVENT_KERNEL_H__
+#define __EVENT_KERNEL_H__
+
+/**
+ * Event kernel
+ *
+ * A task which runs the pi_task notifications pushed with pi_task_push():
+ * callbacks are called, blocking tasks are released. Tasks are handed over
+ * through single producer rings, one for tasks and one for interrupt handlers,
+ * which push without masking interrupts. Pushes to a full ring or from nested
+ * handlers mask interrupts for a few instructions. Tasks pushed from tasks run
+ * in push order, so do tasks pushed from interrupt handlers. Delayed pushes
+ * wait in a timer wheel with one slot per tick.
+ */
+
+#include <stdint.h>
+#include "pmsis_types.h"
+
+#ifndef PI_EVENT_KERNEL_PRIORITY
+#define PI_EVENT_KERNEL_PRIORITY (configMAX_PRIORITIES - 1)
+#endif
+
+#ifndef PI_EVENT_KERNEL_STACK_SIZE
+#define PI_EVENT_KERNEL_STACK_SIZE (2 * configMINIMAL_STACK_SIZE)
+#endif
+
+/* Number of slots of each push ring, must be a power of 2. */
+#ifndef PI_EVENT_KERNEL_RING_SIZE
+#define PI_EVENT_KERNEL_RING_SIZE (16)
+#endif
+
+/* Number of slots of the timer wheel, must be a power of 2. */
+#ifndef PI_EVENT_KERNEL_WHEEL_SIZE
+#define PI_EVENT_KERNEL_WHEEL_SIZE (32)
+#endif
+
+/**
+ * \brief Create the event kernel task.
+ *
+ * Called by pmsis_kickoff() before the scheduler starts. Tasks pushed before
+ * are run as soon as it starts.
+ *
+ * \return 0 on success, -1 if the task could not be created.
+ */
+int pi_event_kernel_init(void);
+
+/**
+ * \brief Run a task from the event kernel.
+ *
+ * Can be called from a task or an interrupt handler.
+ *
+ * \param task The task to run.
+ */
+void pi_event_kernel_push(pi_task_t *task);
+
+/**
+ * \brief Run a task from the event kernel after a delay.
+ *
+ * The delay is rounded up to the scheduler tick. Can be called from a task or
+ * an interrupt handler.
+ *
+ * \param task     The task to run.
+ * \param delay_us The delay in micro-seconds.
+ */
+void pi_event_kernel_push_delayed(pi_task_t *task, uint32_t delay_us);
+
+#endif /* __EVENT_KERNEL_H__ */
@@ -31,13 +31,21 @@ void pi_fc_event_handler_init(uint32_t fc_event_irq);
 /*!
  * @brief FC event handler.
  *
- * This function pops an event and executes the handler corresponding to the
- * event.
+ * This function pops the pending events and executes the handler
+ * corresponding to each event.
  */
 void fc_soc_event_handler(void);
 
+/*!
+ * @brief Set the handler of a SoC event.
+ *
+ * @param event_id      SoC event number.
+ * @param event_handler Function called from the interrupt handler.
+ * @param arg           Argument given to the handler, usually the driver data
+ *                      of the peripheral raising the event.
+ */
 void pi_fc_event_handler_set(uint32_t event_id,
-			     pi_fc_event_handler_t event_handler);
+			     pi_fc_event_handler_t event_handler, void *arg);
 
 void pi_fc_event_handler_clear(uint32_t event_id);
 
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2021 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __HRTIMER_H__
+#define __HRTIMER_H__
+
+/**
+ * High resolution clock and timers
+ *
+ * The high half of the FC timer counts SoC clock cycles freely and is
+ * extended to 64 bits in software. Its compare interrupt
+ * (IRQ_FC_EVT_TIMER0_HI) runs the timers, independently of the scheduler
+ * tick. The low half stays with the tick.
+ *
+ * Everything is set up on first use, which claims the high half of the timer.
+ * The SoC clock frequency is sampled then and is assumed not to change.
+ */
+
+#include <stdint.h>
+
+struct hrtimer {
+	struct hrtimer *next;
+	uint64_t expiry; /* in cycles */
+	uint64_t period; /* in cycles, 0 for one shot */
+	void (*func)(void *arg);
+	void *arg;
+	uint32_t active;
+};
+
+/**
+ * \brief Start the clock.
+ *
+ * Called implicitly by the other functions.
+ *
+ * \return 0 on success.
+ */
+int hrtimer_init(void);
+
+/**
+ * \brief Cycles since the clock was started.
+ */
+uint64_t hrtimer_get_cycles(void);
+
+/**
+ * \brief Clock frequency in Hz.
+ */
+uint32_t hrtimer_get_freq(void);
+
+/**
+ * \brief Micro-seconds since the clock was started.
+ */
+uint64_t hrtimer_get_us(void);
+
+/**
+ * \brief Set the function a timer calls when it expires.
+ *
+ * func is called from the timer interrupt handler, it may use the FreeRTOS
+ * FromISR functions and pi_task_push().
+ *
+ * \param timer The timer.
+ * \param func  Called on expiry.
+ * \param arg   Argument of func.
+ */
+void hrtimer_setup(struct hrtimer *timer, void (*func)(void *arg), void *arg);
+
+/**
+ * \brief Start or restart a timer.
+ *
+ * A periodic timer expires every period_us after the first expiry, without
+ * accumulating the handling delays.
+ *
+ * \param timer     The timer.
+ * \param delay_us  Time until the first expiry.
+ * \param period_us Time between expiries, 0 for a one shot timer.
+ */
+void hrtimer_start(struct hrtimer *timer, uint32_t delay_us,
+		   uint32_t period_us);
+
+/**
+ * \brief Stop a timer.
+ *
+ * Does nothing if the timer is not running.
+ *
+ * \param timer The timer.
+ */
+void hrtimer_stop(struct hrtimer *timer);
+
+#endif /* __HRTIMER_H__ */
@@ -270,7 +270,18 @@ int pi_i2c_read(struct pi_device *device, uint8_t *rx_buff, int length,
 int pi_i2c_write(struct pi_device *device, uint8_t *tx_data, int length,
   pi_i2c_xfer_flags_e flags);
 
-
+/** \brief Write then read data, typically a register read.
+ *
+ * The data is written and read back with a repeated start in between and a
+ * STOP bit at the end, as a single transfer.
+ * The caller is blocked until the transfer is finished.
+ *
+ * \param device    A pointer to the structure describing the device.
+ * \param tx_buffer The data to write, typically the register address.
+ * \param rx_buffer Where to store the data read.
+ * \param tx_size   The size in bytes of the data to write.
+ * \param rx_size   The size in bytes of the data to read.
+ */
 void pi_i2c_write_read(struct pi_device *device, void *tx_buffer,
         void *rx_buffer, uint32_t tx_size, uint32_t rx_size);
 
@@ -326,6 +337,19 @@ void pi_i2c_read_async(struct pi_device *device, uint8_t *rx_buff, int length,
 void pi_i2c_write_async(struct pi_device *device, uint8_t *tx_data, int length,
   pi_i2c_xfer_flags_e flags, pi_task_t *task);
 
+/** \brief Write then read data asynchronously, typically a register read.
+ *
+ * Same as pi_i2c_write_read(), the task is notified once the data is read.
+ * Up to 8 bytes to write are copied in the command sequence, so that the whole
+ * transfer needs a single end of transfer interrupt.
+ *
+ * \param device    A pointer to the structure describing the device.
+ * \param tx_buffer The data to write, typically the register address.
+ * \param rx_buffer Where to store the data read.
+ * \param tx_size   The size in bytes of the data to write.
+ * \param rx_size   The size in bytes of the data to read.
+ * \param callback  The task used to notify the end of transfer.
+ */
 void pi_i2c_write_read_async(struct pi_device *device, void *tx_buffer,
         void *rx_buffer, uint32_t tx_size, uint32_t rx_size, pi_task_t *callback);
 
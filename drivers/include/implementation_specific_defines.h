@@ -54,7 +54,9 @@
 
 #ifndef PI_TASK_IMPLEM
 #define PI_TASK_IMPLEM                          \
-    uint8_t destroy;
+    uint8_t destroy;                            \
+    void *waiter;                               \
+    int32_t status;
 #endif
 #define CLUSTER_TASK_IMPLEM                     \
     uint32_t cluster_team_mask;
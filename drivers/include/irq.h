@@ -108,9 +108,27 @@ uint32_t irq_clint_enable(int mask);
 #ifdef CONFIG_CLIC
 void irq_set_lvl_and_prio(int id, int lvl, int prio);
 void irq_set_trigger_type(int id, int flags);
+/* Jump straight from the vector table to handler, bypassing the kernel trap
+ * handler. lvl must be above CLIC_MAX_SYSCALL_LEVEL. handler must be declared
+ * __attribute__((interrupt)) and must not call FreeRTOS functions. Returns -1
+ * on an invalid level or a handler out of reach of the vector table.
+ * irq_set_handler reverts the line to a normal handler. */
+int irq_set_fast_handler(int id, void (*handler)(void), int lvl, int prio);
 #endif
 void pulp_irq_init();
 
+/* Depth of interrupt handlers running through vSystemIrqHandler. */
+extern volatile uint32_t irq_nesting;
+
+/* Returns 1 in an interrupt handler called by vSystemIrqHandler, which must
+ * use the FromISR kernel functions. Returns 0 in tasks and in main(), also
+ * before the scheduler starts. Fast CLIC handlers bypass vSystemIrqHandler
+ * and see the context they interrupted, they must not call the kernel. */
+static inline int irq_in_isr(void)
+{
+	return irq_nesting != 0;
+}
+
 /** Interrupt Number Definitions */
 #define NUMBER_OF_INT_VECTORS                                                  \
 	32 /**< Number of interrupts in the Vector table */
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2021 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __IRQ_LATENCY_H__
+#define __IRQ_LATENCY_H__
+
+/**
+ * Interrupt latency instrumentation
+ *
+ * Enabled with CONFIG_IRQ_LATENCY=y. Times are in core cycles (mcycle), the
+ * FC timer runs from the 32 kHz reference clock which is too coarse.
+ *
+ * Per interrupt line it records:
+ * - entry: from irq_latency_raise() to vSystemIrqHandler, for lines whose
+ *   source marks when it raises the interrupt (software interrupts, tests).
+ *   The FC timer low line (kernel tick) is measured from its compare match,
+ *   with the resolution of one timer count.
+ * - handler: time spent in the isr_table handler
+ *
+ * It also records the time spent in each SoC event handler called by
+ * fc_soc_event_handler and the latency from an interrupt handler waking a
+ * task to that task running. Up to IRQ_LATENCY_NB_WAKES woken tasks are
+ * tracked at once, the oldest is dropped and counted as lost beyond that.
+ *
+ * Histograms have power of two buckets: bucket i counts the values in
+ * [2^i, 2^(i+1)), the last one everything above.
+ */
+
+#include <stdint.h>
+
+#ifndef IRQ_LATENCY_NB_LINES
+#define IRQ_LATENCY_NB_LINES 32
+#endif
+
+#ifndef IRQ_LATENCY_NB_WAKES
+#define IRQ_LATENCY_NB_WAKES 8
+#endif
+
+#ifndef IRQ_LATENCY_NB_BUCKETS
+#define IRQ_LATENCY_NB_BUCKETS 16
+#endif
+
+struct irq_latency_stat {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint32_t hist[IRQ_LATENCY_NB_BUCKETS];
+};
+
+#ifdef CONFIG_IRQ_LATENCY
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/**
+ * \brief Enable the cycle counter and clear all statistics.
+ */
+void irq_latency_reset(void);
+
+/**
+ * \brief Print all non-empty statistics with printf.
+ */
+void irq_latency_dump(void);
+
+/**
+ * \brief Copy the statistics of an interrupt line.
+ *
+ * \param id      Interrupt line.
+ * \param entry   Filled with the entry latency.
+ * \param handler Filled with the handler duration.
+ *
+ * \return 0 on success, -1 if the line is not instrumented.
+ */
+int irq_latency_get(int id, struct irq_latency_stat *entry,
+		    struct irq_latency_stat *handler);
+
+/**
+ * \brief Mark that an interrupt is about to be raised.
+ *
+ * The next entry of the line measures its latency from this point.
+ *
+ * \param id Interrupt line.
+ */
+void irq_latency_raise(int id);
+
+/* hooks of the interrupt path */
+uint32_t irq_latency_enter(int id);
+void irq_latency_exit(int id, uint32_t start);
+uint32_t irq_latency_soc_event_enter(void);
+void irq_latency_soc_event_exit(uint32_t start);
+void irq_latency_wake(TaskHandle_t task);
+void irq_latency_woken(void);
+
+#else
+
+static inline void irq_latency_reset(void)
+{
+}
+
+static inline void irq_latency_dump(void)
+{
+}
+
+static inline int irq_latency_get(int id, struct irq_latency_stat *entry,
+				  struct irq_latency_stat *handler)
+{
+	return -1;
+}
+
+static inline void irq_latency_raise(int id)
+{
+}
+
+static inline uint32_t irq_latency_enter(int id)
+{
+	return 0;
+}
+
+static inline void irq_latency_exit(int id, uint32_t start)
+{
+}
+
+static inline uint32_t irq_latency_soc_event_enter(void)
+{
+	return 0;
+}
+
+static inline void irq_latency_soc_event_exit(uint32_t start)
+{
+}
+
+#define irq_latency_wake(task) ((void)(task))
+
+static inline void irq_latency_woken(void)
+{
+}
+
+#endif /* CONFIG_IRQ_LATENCY */
+
+#endif /* __IRQ_LATENCY_H__ */
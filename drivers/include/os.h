@@ -29,6 +29,7 @@
 #include "riscv.h"
 #include "properties.h"
 #include "pmsis_types.h"
+#include "event_kernel.h"
 
 
 static inline void pmsis_exit(int err)
@@ -50,14 +51,13 @@ static inline int pmsis_kickoff(void *arg)
 		pmsis_exit(-1);
 	}
 
-	__enable_irq();
-
-	/* TODO: blocks everything because priority too high */
-	/* TODO: spawn event loop for callbacks or use FreeRTOS callback api */
+	/* runs the pi_task callbacks pushed by drivers and interrupts */
+	if (pi_event_kernel_init()) {
+		printf("event kernel is NULL !\n");
+		pmsis_exit(-1);
+	}
 
-	/* struct pmsis_event_kernel_wrap *wrap; */
-	/* pmsis_event_kernel_init(&wrap, pmsis_event_kernel_main); */
-	/* pmsis_event_set_default_scheduler(wrap); */
+	__enable_irq();
 
 	/* TODO: handle case when uart is being used before initialized */
 	/* Start the kernel. From here on only tasks and interrupts will run. */
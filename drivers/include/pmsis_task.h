@@ -30,7 +30,6 @@
  * \brief Prepare a blocking event task.
  *
  * This function initializes an instance of event task.
- * A semaphore will be initialized.
  *
  * \param task           Pointer to event task.
  *
@@ -124,6 +123,12 @@ static inline pi_task_t *pi_task_callback(pi_task_t *task,
  *
  * \note The notification event is released just before returning from this call
  *       and must be reinitialized before it can be re-used.
+ * \note The caller sleeps until the event is triggered and is woken up with a
+ *       FreeRTOS task notification on index PI_TASK_NOTIFY_INDEX, 1 if
+ *       configTASK_NOTIFICATION_ARRAY_ENTRIES is at least 2. With a single
+ *       entry index 0 is shared with the application, whose notifications to
+ *       a waiting task are then consumed. Only one task may wait on an event. Interrupt handlers and code running before
+ *       the scheduler poll instead.
  */
 static inline void pi_task_wait_on(pi_task_t *task)
 {
@@ -151,6 +156,24 @@ static inline void pi_task_destroy(pi_task_t *task)
 
 void pi_task_release(pi_task_t *task);
 
+/**
+ * \brief Get the status of the request a notification was used for.
+ *
+ * Drivers set it before triggering the notification: 0 if the request was
+ * successful, a negative error code otherwise.
+ *
+ * \param task           Pointer to notification event.
+ */
+static inline int32_t pi_task_status_get(pi_task_t *task)
+{
+	return task->status;
+}
+
+static inline void pi_task_status_set(pi_task_t *task, int32_t status)
+{
+	task->status = status;
+}
+
 /**
  * \brief Trigger a notification.
  *
@@ -165,5 +188,63 @@ void pi_task_release(pi_task_t *task);
  */
 void pi_task_push_delayed_us(pi_task_t *task, uint32_t delay);
 
+/** Wait without timeout in pi_task_wait_any() and pi_task_wait_all(). */
+#define PI_TASK_WAIT_FOREVER (0xFFFFFFFFu)
+
+/**
+ * \brief Initialize an empty completion group.
+ *
+ * \param group          Pointer to the group.
+ */
+void pi_task_group_init(pi_task_group_t *group);
+
+/**
+ * \brief Attach a notification event to a completion group.
+ *
+ * The event must have been initialized with pi_task_block or pi_task_callback
+ * and is attached before being handed to a driver. Once attached, its release
+ * is reported to the group, and it must not be waited on with
+ * pi_task_wait_on.
+ *
+ * \param group          Pointer to the group.
+ * \param task           Pointer to notification event.
+ *
+ * \return The index of the event in the group, or -1 if the group already
+ *         holds 32 events.
+ */
+int pi_task_group_add(pi_task_group_t *group, pi_task_t *task);
+
+/**
+ * \brief Wait until any event of a group is triggered.
+ *
+ * The triggered event is removed from the group, calling this function again
+ * returns the next one. Only one task may wait on a group. Interrupt handlers
+ * and code running before the scheduler poll instead of sleeping, and time
+ * the timeout with the hrtimer clock, which claims the high half of the FC
+ * timer.
+ *
+ * \param group          Pointer to the group.
+ * \param timeout_us     Maximum time to wait in micro-seconds, rounded up to
+ *                       the scheduler tick, or PI_TASK_WAIT_FOREVER.
+ *
+ * \return The index of the triggered event, as returned by
+ *         pi_task_group_add, or -1 on timeout or if the group is empty.
+ */
+int pi_task_wait_any(pi_task_group_t *group, uint32_t timeout_us);
+
+/**
+ * \brief Wait until all events of a group are triggered.
+ *
+ * The group is empty when this function succeeds. Only one task may wait on
+ * a group. Polls like pi_task_wait_any() outside of tasks.
+ *
+ * \param group          Pointer to the group.
+ * \param timeout_us     Maximum time to wait in micro-seconds, rounded up to
+ *                       the scheduler tick, or PI_TASK_WAIT_FOREVER.
+ *
+ * \return 0 if all events were triggered, -1 on timeout.
+ */
+int pi_task_wait_all(pi_task_group_t *group, uint32_t timeout_us);
+
 
 #endif /* __PMSIS_TASK_H__ */
@@ -165,7 +165,9 @@ enum pi_task_id {
 };
 
 #ifndef PI_TASK_IMPLEM
-#define PI_TASK_IMPLEM int8_t destroy;
+/* waiter is the task blocked in pi_task_wait_on(), status is the result of
+ * the request, see pi_task_status_get() */
+#define PI_TASK_IMPLEM int8_t destroy; void *waiter; int32_t status;
 #endif
 
 typedef struct pi_callback_s
@@ -194,5 +196,12 @@ typedef struct pi_task {
 	PI_TASK_IMPLEM;
 } pi_task_t;
 
+/* Tasks released as a group, see pi_task_wait_any() */
+typedef struct pi_task_group {
+	uint32_t mask;	/* attached tasks, one bit each */
+	uint32_t done;	/* released tasks not returned yet */
+	void *waiter;	/* task sleeping in pi_task_wait_any/all() */
+} pi_task_group_t;
+
 /// @endcond
 #endif
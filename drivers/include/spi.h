@@ -180,6 +180,38 @@ typedef enum {
     external memory. */
 } pi_spi_flags_e;
 
+/** \struct pi_spi_batch_req_t
+ * \brief One transfer of a batch.
+ */
+typedef struct pi_spi_batch_req
+{
+    struct pi_device *device;   /*!< Opened SPI device, selects the chip
+                                  select. */
+    void *tx_data;              /*!< Data to send, NULL to only receive. */
+    void *rx_data;              /*!< Where to store the received data, NULL to
+                                  only send. Both buffers give a full duplex
+                                  transfer, which must not use
+                                  PI_SPI_LINES_QUAD. */
+    size_t len;                 /*!< Size in bits, a multiple of 8. */
+    pi_spi_flags_e flags;       /*!< Chip select mode and lines. */
+} pi_spi_batch_req_t;
+
+/** \struct pi_spi_batch_t
+ * \brief Compiled batch of transfers, see pi_spi_batch_init().
+ */
+typedef struct pi_spi_batch
+{
+    pi_spi_batch_req_t *reqs;
+    int nb_reqs;
+    void *drv_data;             /* interface of the batch */
+    uint32_t *cmd;              /* command stream */
+    uint32_t cmd_size;
+    uint8_t *tx_buf;            /* gathered send data */
+    uint32_t tx_size;
+    uint8_t *rx_buf;            /* received data, scattered at the end */
+    uint32_t rx_size;
+} pi_spi_batch_t;
+
 /** \brief Initialize an SPI master configuration with default values.
  *
  * This function can be called to get default values for all parameters before
@@ -285,7 +317,8 @@ void pi_spi_receive(struct pi_device *device, void *data, size_t len,
  * full duplex mode.
  * The copy will make a synchronous transfer between the SPI and one of the
  * chip memory.
- * This is using classic SPI transfer with MOSI and MISO lines.
+ * This is using classic SPI transfer with MOSI and MISO lines. Full duplex has
+ * no quad mode, with PI_SPI_LINES_QUAD nothing is sent.
  * Due to hardware constraints, the address of the buffer must be aligned on 4
  * bytes and the size must be a multiple of 4.
  * The caller is blocked until the transfer is finished.
@@ -319,6 +352,11 @@ void pi_spi_transfer(struct pi_device *device, void *tx_data, void *rx_data,
  * notified when the transfer is finished.
  * Depending on the chip, there may be some restrictions on the memory which
  * can be used. Check the chip-specific documentation for more details.
+ * Buffers outside L2 go through the uDMA bounce pool. If it is empty, the
+ * transfer fails and pi_task_status_get() returns -1 for the task.
+ * A size which is not a multiple of 8 bits fails the same way. Transfers are
+ * sent in chunks of up to 8 KiB, a last chunk which is not a multiple of 4
+ * bytes is sent in 8-bit words.
  *
  * \param device  A pointer to the structure describing the device.
  * \param data   The address in the chip where the data to be sent must be read.
@@ -347,6 +385,11 @@ void pi_spi_send_async(struct pi_device *device, void *data, size_t len,
  * notified when the transfer is finished.
  * Depending on the chip, there may be some restrictions on the memory which
  * can be used. Check the chip-specific documentation for more details.
+ * Buffers outside L2 go through the uDMA bounce pool. If it is empty, the
+ * transfer fails and pi_task_status_get() returns -1 for the task.
+ * A size which is not a multiple of 8 bits fails the same way. Transfers are
+ * sent in chunks of up to 8 KiB, a last chunk which is not a multiple of 4
+ * bytes is sent in 8-bit words.
  *
  * \param device  A pointer to the structure describing the device.
  * \param data    The address in the chip where the received data must be
@@ -368,13 +411,20 @@ void pi_spi_receive_async(struct pi_device *device, void *data, size_t len,
  * full duplex flag.
  * The copy will make an asynchronous transfer between the SPI and one of the
  * chip memory.
- * This is using classic SPI transfer with MOSI and MISO lines.
+ * This is using classic SPI transfer with MOSI and MISO lines. Full duplex has
+ * no quad mode, with PI_SPI_LINES_QUAD the transfer fails and
+ * pi_task_status_get() returns -1 for the task.
  * Due to hardware constraints, the address of the buffer must be aligned on 4
  * bytes and the size must be a multiple of 4.
  * A task must be specified in order to specify how the caller should be
  * notified when the transfer is finished.
  * Depending on the chip, there may be some restrictions on the memory which
  * can be used. Check the chip-specific documentation for more details.
+ * Buffers outside L2 go through the uDMA bounce pool. If it is empty, the
+ * transfer fails and pi_task_status_get() returns -1 for the task.
+ * A size which is not a multiple of 8 bits fails the same way. Transfers are
+ * sent in chunks of up to 8 KiB, a last chunk which is not a multiple of 4
+ * bytes is sent in 8-bit words.
  *
  * \param device  A pointer to the structure describing the device.
  * \param tx_data  The address in the chip where the data to be sent must be
@@ -391,6 +441,54 @@ void pi_spi_receive_async(struct pi_device *device, void *data, size_t len,
 void pi_spi_transfer_async(struct pi_device *device, void *tx_data,
   void *rx_data, size_t len, pi_spi_flags_e flag, pi_task_t *task);
 
+/** \brief Initialize a batch of small transfers.
+ *
+ * A batch is a list of transfers, possibly to different chip selects of the
+ * same SPI interface, which are compiled once into a single command stream.
+ * Running the batch then sends all the transfers back to back with a single
+ * end of transfer notification, which is much cheaper than one asynchronous
+ * transfer per element when the transfers are only a few bytes long.
+ *
+ * The requests are not copied, the array must be kept alive until the batch
+ * is deinitialized. Their device, size and flags are fixed by this call, the
+ * content of the buffers is read and written each time the batch runs. Data
+ * is sent and received byte by byte in memory order, so the buffers have no
+ * alignment constraint.
+ *
+ * \param batch    A pointer to the batch structure.
+ * \param reqs     The transfers of the batch.
+ * \param nb_reqs  The number of transfers.
+ * \return         0 if the batch was initialized, -1 if the requests are not
+ *   on the same interface, too big, full duplex in quad mode or if the memory
+ *   could not be allocated.
+ */
+int pi_spi_batch_init(pi_spi_batch_t *batch, pi_spi_batch_req_t *reqs,
+  int nb_reqs);
+
+/** \brief Release the memory of a batch.
+ *
+ * \param batch    A pointer to the batch structure.
+ */
+void pi_spi_batch_deinit(pi_spi_batch_t *batch);
+
+/** \brief Run a batch of transfers.
+ *
+ * The caller is blocked until all the transfers of the batch are finished.
+ *
+ * \param batch    A pointer to the batch structure.
+ */
+void pi_spi_batch(pi_spi_batch_t *batch);
+
+/** \brief Enqueue a batch of transfers.
+ *
+ * The batch goes through the same queue as the other transfers of the
+ * interface. It must not be run again before the task is notified.
+ *
+ * \param batch    A pointer to the batch structure.
+ * \param task     The task used to notify the end of the batch.
+ */
+void pi_spi_batch_async(pi_spi_batch_t *batch, pi_task_t *task);
+
 //!@}
 
 /**
@@ -400,14 +498,18 @@ void pi_spi_transfer_async(struct pi_device *device, void *tx_data,
 /// @cond IMPLEM
 
 /**
- * Enqueue receive ucode given by the user, and receive answer in data buffer
+ * Enqueue receive ucode given by the user, and receive answer in data buffer.
+ * The ucode is sent after SOT and before the data, it replaces the receive
+ * program of the chip select (see pi_spi_receive_ucode_set()).
  */
 void pi_spi_receive_with_ucode(struct pi_device *device, void *data,
         size_t len, pi_spi_flags_e flags, int ucode_size,
         void *ucode);
 
 /**
- * Enqueue receive ucode given by the user, and receive answer in data buffer
+ * Enqueue send ucode given by the user, and send the data buffer after it.
+ * The ucode replaces the send program of the chip select (see
+ * pi_spi_send_ucode_set()).
  */
 void pi_spi_send_with_ucode(struct pi_device *device, void *data,
         size_t len, pi_spi_flags_e flags, int ucode_size,
@@ -422,14 +524,43 @@ uint32_t pi_spi_get_config(struct pi_device *device);
 #define SPI_UCODE_CMD_SEND_ADDR(bits,qpi)       ((3<<28) | ((qpi)<<27) | (((bits)-1)<<16))
 #define SPI_UCODE_CMD_DUMMY(cycles)             ((4<<28) | (((cycles)-1)<<16))
 
+/**
+ * Compile the receive program of the chip select from ucode_size bytes of
+ * SPI commands (e.g. SPI_UCODE_CMD_SEND_CMD, SPI_UCODE_CMD_SEND_ADDR followed
+ * by an address word, SPI_UCODE_CMD_DUMMY). The program is kept with the chip
+ * select and replayed before the data of each pi_spi_copy() from the device.
+ * Returns the copy of the ucode inside the program, NULL if it could not be
+ * allocated. Must not be called while a transfer using the program is
+ * pending.
+ */
 void *pi_spi_receive_ucode_set(struct pi_device *device, uint8_t *ucode, uint32_t ucode_size);
 
+/**
+ * Tell which word of the receive program gets the device address of
+ * pi_spi_copy(). ucode points into the ucode returned by
+ * pi_spi_receive_ucode_set() and ucode_size is the address size in bytes.
+ * The address is sent most significant bit first, as SPI_UCODE_CMD_SEND_ADDR
+ * expects.
+ * Large copies are then split into several commands with increasing
+ * addresses.
+ */
 void pi_spi_receive_ucode_set_addr_info(struct pi_device *device, uint8_t *ucode, uint32_t ucode_size);
 
+/**
+ * Same as pi_spi_receive_ucode_set() for copies to the device.
+ */
 void *pi_spi_send_ucode_set(struct pi_device *device, uint8_t *ucode, uint32_t ucode_size);
 
+/**
+ * Same as pi_spi_receive_ucode_set_addr_info() for copies to the device.
+ */
 void pi_spi_send_ucode_set_addr_info(struct pi_device *device, uint8_t *ucode, uint32_t ucode_size);
 
+/**
+ * Copy size bytes between data and the device address addr using the
+ * program of the chip select. PI_SPI_COPY_EXT2LOC selects the receive
+ * program, the send program is used otherwise.
+ */
 void pi_spi_copy(struct pi_device *device,
   uint32_t addr, void *data, uint32_t size,
   pi_spi_flags_e flags);
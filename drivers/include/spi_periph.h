@@ -332,7 +332,7 @@ typedef struct {
 	 ((event) << SPI_CMD_WAIT_EVENT_OFFSET))
 #define SPI_CMD_RPT_END() ((SPI_CMD_RPT_END_ID << SPI_CMD_ID_OFFSET))
 #define SPI_CMD_FUL(words, wordstrans, bitsword, lsbfirst)                     \
-	((SPI_CMD_FUL_ID << SPI_CMD_ID_OFFSET) |                               \
+	((SPI_CMD_FULL_DUPL_ID << SPI_CMD_ID_OFFSET) |                               \
 	 ((wordstrans) << SPI_CMD_FUL_WORDTRANS_OFFSET) |                      \
 	 ((bitsword - 1ul) << SPI_CMD_FUL_BITSWORD_OFFSET) |                   \
 	 (((words)-1ul) << SPI_CMD_FUL_SIZE_OFFSET) |                          \
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __SPIFLASH_H__
+#define __SPIFLASH_H__
+
+#include <stdint.h>
+#include "pmsis_types.h"
+#include "spi.h"
+
+/**
+ * @ingroup groupDrivers
+ */
+
+/**
+ * @defgroup SPIFLASH SPI NOR flash
+ *
+ * \brief SPI NOR flash on top of the SPI master driver
+ *
+ * The flash is probed with its JEDEC ID and read with the fast read command,
+ * on four data lines if requested. Small reads are served from a read cache
+ * in L2, which also reads ahead the next line on sequential accesses when it
+ * has at least two lines.
+ * Program and erase operations sleep while the flash is busy, so other tasks
+ * keep running.
+ */
+
+/**
+ * @addtogroup SPIFLASH
+ * @{
+ */
+
+/**
+ * \struct pi_spiflash_conf
+ *
+ * \brief SPI flash configuration structure.
+ */
+struct pi_spiflash_conf {
+	struct pi_spi_conf spi;	  /*!< Interface, chip select and baudrate. */
+	uint8_t quad;		  /*!< 1 to read on four data lines, the quad
+				    enable bit of the flash must be set. */
+	uint32_t cache_lines;	  /*!< Number of read cache lines, 0 disables
+				    the cache. */
+	uint32_t cache_line_size; /*!< Size of a cache line in bytes, a power of
+				    2 and at least 4. */
+};
+
+/**
+ * \struct pi_spiflash_info
+ *
+ * \brief Geometry of a probed flash.
+ */
+struct pi_spiflash_info {
+	uint8_t jedec_id[3];  /*!< Manufacturer, memory type and capacity. */
+	uint32_t size;	      /*!< Size in bytes. */
+	uint32_t sector_size; /*!< Size of the erase unit in bytes. */
+	uint32_t page_size;   /*!< Size of the program unit in bytes. */
+};
+
+/** \brief Initialize a flash configuration with default values.
+ *
+ * \param conf A pointer to the flash configuration.
+ */
+void pi_spiflash_conf_init(struct pi_spiflash_conf *conf);
+
+/** \brief Open a flash device.
+ *
+ * The SPI interface is opened and the flash is probed. The device must be
+ * opened from a task.
+ *
+ * \param device A pointer to the device structure, opened from a
+ *   pi_spiflash_conf.
+ * \return 0 if the flash was found, -1 otherwise.
+ */
+int pi_spiflash_open(struct pi_device *device);
+
+/** \brief Close a flash device.
+ *
+ * No synchronous operation may be running on the device. Asynchronous
+ * operations which have not started yet are completed without being run,
+ * pi_task_status_get() returns -1 for them.
+ *
+ * \param device A pointer to the device structure.
+ */
+void pi_spiflash_close(struct pi_device *device);
+
+/** \brief Get the geometry of the flash.
+ *
+ * \param device A pointer to the device structure.
+ * \param info   Where to store the geometry.
+ */
+void pi_spiflash_info_get(struct pi_device *device,
+			  struct pi_spiflash_info *info);
+
+/** \brief Read from the flash.
+ *
+ * Reads smaller than two cache lines go through the read cache. Larger reads
+ * into 4 bytes aligned buffers go directly to the buffer.
+ *
+ * \param device A pointer to the device structure.
+ * \param addr   Address in the flash.
+ * \param data   Where to store the data.
+ * \param size   Size in bytes.
+ * \return 0 on success, -1 if the range is outside the flash.
+ */
+int pi_spiflash_read(struct pi_device *device, uint32_t addr, void *data,
+		     uint32_t size);
+
+/** \brief Program the flash.
+ *
+ * The range must have been erased. It may cross page boundaries.
+ *
+ * \param device A pointer to the device structure.
+ * \param addr   Address in the flash.
+ * \param data   Data to program.
+ * \param size   Size in bytes.
+ * \return 0 on success, -1 if the range is outside the flash.
+ */
+int pi_spiflash_program(struct pi_device *device, uint32_t addr,
+			const void *data, uint32_t size);
+
+/** \brief Erase a sector of the flash.
+ *
+ * \param device A pointer to the device structure.
+ * \param addr   Address of the sector, aligned on the sector size.
+ * \return 0 on success, -1 if the address is not a sector of the flash.
+ */
+int pi_spiflash_erase_sector(struct pi_device *device, uint32_t addr);
+
+/** \brief Program the flash asynchronously.
+ *
+ * The operation is run by a task of the driver, the data must be kept alive
+ * until the task is notified.
+ *
+ * \param device A pointer to the device structure.
+ * \param addr   Address in the flash.
+ * \param data   Data to program.
+ * \param size   Size in bytes.
+ * \param task   The task used to notify the end of the operation.
+ * \return 0 if the operation was queued, -1 if the range is outside the
+ *   flash.
+ */
+int pi_spiflash_program_async(struct pi_device *device, uint32_t addr,
+			      const void *data, uint32_t size, pi_task_t *task);
+
+/** \brief Erase a sector of the flash asynchronously.
+ *
+ * \param device A pointer to the device structure.
+ * \param addr   Address of the sector, aligned on the sector size.
+ * \param task   The task used to notify the end of the operation.
+ * \return 0 if the operation was queued, -1 if the address is not a sector
+ *   of the flash.
+ */
+int pi_spiflash_erase_sector_async(struct pi_device *device, uint32_t addr,
+				   pi_task_t *task);
+
+/**
+ * @}
+ */
+
+#endif /* __SPIFLASH_H__ */
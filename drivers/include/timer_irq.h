@@ -21,11 +21,19 @@
 #ifndef __TIMER_IRQ_H__
 #define __TIMER_IRQ_H__
 #include <stdint.h>
+#include <stdbool.h>
 
 int timer_irq_init(uint32_t ticks);
 
+/* Periodic interrupt every ticks timer counts, or with idle a single one ticks
+ * counts after the start of the current period. */
 int timer_irq_set_timeout(uint32_t ticks, bool idle);
 
+/* Return to the periodic interrupt after an idle timeout, elapsed counts of the
+ * new period are already gone. */
+int timer_irq_resume(uint32_t ticks, uint32_t elapsed);
+
+/* Timer counts since the start of the current period. */
 uint32_t timer_irq_clock_elapsed();
 
 uint32_t timer_irq_cycle_get_32();
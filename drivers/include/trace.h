@@ -0,0 +1,152 @@
+/*
+ * Copyright 2021 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+/**
+ * Run-time statistics and task switch trace
+ *
+ * Include this header at the end of FreeRTOSConfig.h. With
+ * configGENERATE_RUN_TIME_STATS set to 1 the kernel measures the run time of
+ * each task in micro-seconds of the hrtimer clock, trace_print_task_stats()
+ * prints it along with the stack high watermarks. The kernel keeps 32-bit
+ * run times, they wrap after about 71 minutes and the shares printed after
+ * that are wrong.
+ *
+ * The hrtimer claims the high half of the FC timer and its interrupt
+ * (IRQ_FC_EVT_TIMER0_HI). It is set up by the kernel through
+ * portCONFIGURE_TIMER_FOR_RUN_TIME_STATS, or by trace_start(), the high half
+ * must not be used for anything else then.
+ *
+ * With CONFIG_TRACE=y the task switches and interrupt handlers are also
+ * recorded in trace_buf, a ring buffer in L2. Dump it over stdio with
+ * trace_dump() or read the trace_buf symbol from the simulator memory, then
+ * convert it with scripts/trace2perfetto. Needs configUSE_TRACE_FACILITY.
+ */
+
+#ifndef TRACE_NB_RECORDS
+#define TRACE_NB_RECORDS 1024
+#endif
+
+#ifndef TRACE_NB_TASKS
+#define TRACE_NB_TASKS 16
+#endif
+
+#define TRACE_NAME_LEN 16
+#define TRACE_MAGIC    0x45435254 /* "TRCE" */
+
+/* record types */
+#define TRACE_TASK_IN	1
+#define TRACE_TASK_OUT	2
+#define TRACE_IRQ_ENTER 3
+#define TRACE_IRQ_EXIT	4
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+/* The layout is read by scripts/trace2perfetto. */
+struct trace_record {
+	uint32_t time; /* low half of the hrtimer cycles */
+	uint16_t type;
+	uint16_t id;   /* task number or interrupt line */
+};
+
+struct trace_buf {
+	uint32_t magic;
+	uint32_t freq;
+	uint32_t nb_records;
+	uint32_t nb_tasks;
+	uint32_t count; /* records written so far, the ring wraps */
+	char names[TRACE_NB_TASKS][TRACE_NAME_LEN];
+	struct trace_record records[TRACE_NB_RECORDS];
+};
+
+/**
+ * \brief Set up the hrtimer for the run time counter.
+ */
+void trace_runtime_init(void);
+
+/**
+ * \brief Run time counter of the kernel, in micro-seconds.
+ *
+ * The low 32 bits of hrtimer_get_us().
+ */
+uint32_t trace_runtime_counter(void);
+
+/**
+ * \brief Print the run time share and stack high watermark of each task.
+ */
+void trace_print_task_stats(void);
+
+#ifdef CONFIG_TRACE
+
+/**
+ * \brief Clear the trace and start recording.
+ */
+void trace_start(void);
+
+/**
+ * \brief Stop recording.
+ */
+void trace_stop(void);
+
+/**
+ * \brief Print the trace buffer in hex, between "trace begin" and "trace end"
+ * lines. Recording stops meanwhile.
+ */
+void trace_dump(void);
+
+/* kernel and interrupt hooks */
+void trace_task_create(void *task);
+void trace_task_switched_in(void);
+void trace_task_switched_out(void);
+void trace_irq_enter(int id);
+void trace_irq_exit(int id);
+
+#else
+
+static inline void trace_irq_enter(int id)
+{
+}
+
+static inline void trace_irq_exit(int id)
+{
+}
+
+#endif /* CONFIG_TRACE */
+
+#endif /* __ASSEMBLER__ */
+
+#if defined(configGENERATE_RUN_TIME_STATS) && (configGENERATE_RUN_TIME_STATS == 1)
+#ifndef portCONFIGURE_TIMER_FOR_RUN_TIME_STATS
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() trace_runtime_init()
+#endif
+#ifndef portGET_RUN_TIME_COUNTER_VALUE
+#define portGET_RUN_TIME_COUNTER_VALUE() trace_runtime_counter()
+#endif
+#endif
+
+#ifdef CONFIG_TRACE
+#define traceTASK_CREATE(xTask)	 trace_task_create(xTask)
+#define traceTASK_SWITCHED_IN()	 trace_task_switched_in()
+#define traceTASK_SWITCHED_OUT() trace_task_switched_out()
+#endif
+
+#endif /* __TRACE_H__ */
@@ -62,6 +62,18 @@ struct pi_uart_conf {
 	uint8_t is_usart;      /*!< 1 to activate usart */
 };
 
+/**
+ * \struct pi_uart_iovec
+ *
+ * \brief UART scatter-gather element.
+ *
+ * This structure describes one buffer of a vectored write.
+ */
+struct pi_uart_iovec {
+	void *iov_base;	  /*!< Pointer to data buffer. */
+	uint32_t iov_len; /*!< Size of data buffer in bytes. */
+};
+
 /**
  * \enum pi_uart_stop_bits
  *
@@ -306,6 +318,9 @@ int pi_uart_write_async(struct pi_device *device, void *buffer, uint32_t size,
  * notified when the transfer is finished.
  * Depending on the chip, there may be some restrictions on the memory which
  * can be used. Check the chip-specific documentation for more details.
+ * A read queued behind others which cannot be started when its turn comes,
+ * because no bounce buffer is free, is completed with pi_task_status_get()
+ * returning -11.
  *
  * \param device         Pointer to device descriptor of the UART device.
  * \param buffer         Pointer to data buffer.
@@ -338,6 +353,126 @@ int pi_uart_write_byte_async(struct pi_device *device, uint8_t *byte,
 			     pi_task_t *callback);
 
 
+/**
+ * \brief Write several buffers to an UART.
+ *
+ * This writes the buffers described by the iovec array, in order, to the
+ * specified UART. The caller is blocked until all buffers are sent.
+ *
+ * \param device         Pointer to device descriptor of the UART device.
+ * \param iov            Pointer to the array of buffers.
+ * \param iovcnt         Number of buffers in the array.
+ *
+ * \retval 0             If operation is successfull.
+ * \retval ERRNO         An error code otherwise.
+ */
+int pi_uart_writev(struct pi_device *device, const struct pi_uart_iovec *iov,
+		   uint32_t iovcnt);
+
+/**
+ * \brief Write several buffers to an UART asynchronously.
+ *
+ * This writes the buffers described by the iovec array, in order, to the
+ * specified UART asynchronously. The task is triggered once all the buffers
+ * have been sent.
+ *
+ * Small buffers, from this request or from other pending writes, are packed
+ * together into an internal L2 buffer and sent with a single transfer.
+ * Buffers bigger than UART_TX_COALESCE_MAX are sent directly when they are in
+ * L2 and chunked through the uDMA bounce pool otherwise.
+ *
+ * \param device         Pointer to device descriptor of the UART device.
+ * \param iov            Pointer to the array of buffers.
+ * \param iovcnt         Number of buffers in the array.
+ * \param callback       Event task used to notify the end of transfer. See the
+ *                       documentation of pi_task_t for more details.
+ *
+ * \retval 0             If operation is successfull.
+ * \retval ERRNO         An error code otherwise.
+ *
+ * \note The iovec array must be kept alive until the transfer is finished.
+ */
+int pi_uart_writev_async(struct pi_device *device,
+			 const struct pi_uart_iovec *iov, uint32_t iovcnt,
+			 pi_task_t *callback);
+
+/**
+ * \brief Start continuous reception into a ring buffer.
+ *
+ * This starts reception on the specified UART into a ring buffer which is
+ * split in two halves. The halves are alternately filled by the uDMA in
+ * continuous mode, so that no byte is lost between two transfers. Completed
+ * halves are handed to the caller by pointer with pi_uart_rx_ring_read(),
+ * without any copy.
+ *
+ * While the ring is running, pi_uart_read() and pi_uart_read_async() can not
+ * be used on the same device.
+ *
+ * \param device         Pointer to device descriptor of the UART device.
+ * \param buffer         Pointer to the ring buffer, which must be in L2.
+ * \param size           Size of the ring buffer in bytes, must be even.
+ *
+ * \retval 0             If operation is successfull.
+ * \retval ERRNO         An error code otherwise.
+ *
+ * \note A completed half is handed to the caller while the uDMA fills the
+ *       other half. It is queued again right away, so the caller must be done
+ *       with it before the other half is full, i.e. within the time needed to
+ *       receive size/2 bytes. A half which is not read yet when the uDMA
+ *       starts filling it again is dropped and counted as an overrun.
+ */
+int pi_uart_rx_ring_start(struct pi_device *device, void *buffer,
+			  uint32_t size);
+
+/**
+ * \brief Stop continuous reception.
+ *
+ * This stops the ring started with pi_uart_rx_ring_start(). A task waiting
+ * for a half is released with a NULL chunk.
+ *
+ * \param device         Pointer to device descriptor of the UART device.
+ */
+void pi_uart_rx_ring_stop(struct pi_device *device);
+
+/**
+ * \brief Get the next completed half of the ring.
+ *
+ * This returns a pointer to the oldest completed half of the ring. The caller
+ * is blocked until a half is available.
+ *
+ * \param device         Pointer to device descriptor of the UART device.
+ * \param chunk          Pointer where the address of the half is stored.
+ *
+ * \return Size of the half in bytes, or 0 if the ring has been stopped.
+ */
+int pi_uart_rx_ring_read(struct pi_device *device, uint8_t **chunk);
+
+/**
+ * \brief Get the next completed half of the ring asynchronously.
+ *
+ * This stores a pointer to the oldest completed half of the ring in chunk
+ * and triggers the task as soon as a half is available. Only one request can
+ * be pending at a time.
+ *
+ * \param device         Pointer to device descriptor of the UART device.
+ * \param chunk          Pointer where the address of the half is stored.
+ * \param callback       Event task used to notify that a half is available.
+ *
+ * \retval 0             If operation is successfull.
+ * \retval ERRNO         An error code otherwise.
+ */
+int pi_uart_rx_ring_read_async(struct pi_device *device, uint8_t **chunk,
+			       pi_task_t *callback);
+
+/**
+ * \brief Get the number of halves overwritten before being read.
+ *
+ * \param device         Pointer to device descriptor of the UART device.
+ *
+ * \return Number of lost halves since the ring has been started.
+ */
+uint32_t pi_uart_rx_ring_overrun_get(struct pi_device *device);
+
 /**
  * \brief Write data to an UART from cluster side.
  *
@@ -345,6 +480,9 @@ int pi_uart_write_byte_async(struct pi_device *device, uint8_t *byte,
  * from cluster side in order to expose the feature on the cluster.
  * A pointer to a request structure must be provided so that the runtime can
  * properly do the remote call.
+ * Requests issued by several cores at the same time are handed to the FC in a
+ * single delegation. The buffer can be in the cluster L1, it is then copied
+ * through the uDMA bounce buffers by the FC.
  *
  * \param device         Pointer to device descriptor of the UART device.
  * \param buffer         Pointer to data buffer.
@@ -383,7 +521,7 @@ int pi_cl_uart_write_byte(pi_device_t *device, uint8_t *byte,
  *
  * \param req            Request structure used for termination.
  */
-static inline void pi_cl_uart_write_wait(pi_cl_uart_req_t *req);
+void pi_cl_uart_write_wait(pi_cl_uart_req_t *req);
 
 /**
  * \brief Read a byte from an UART from cluster side.
@@ -428,10 +566,28 @@ int pi_cl_uart_read_byte(pi_device_t *device, uint8_t *byte,
  *
  * \param req            Request structure used for termination.
  */
-static inline void pi_cl_uart_read_wait(pi_cl_uart_req_t *req);
+void pi_cl_uart_read_wait(pi_cl_uart_req_t *req);
 
 /**
  * @}
  */
 
+/// @cond IMPLEM
+
+#ifdef CONFIG_CLUSTER
+#include "cl_to_fc_delegate.h"
+
+struct pi_cl_uart_req_s {
+	struct cl_fc_req fc_req; /* must be first */
+	struct pi_device *device;
+	void *buffer;
+	uint32_t size;
+	pi_task_t task; /* FC side transfer */
+	uint8_t is_read;
+	volatile uint8_t done; /* set once the FC no longer uses the request */
+};
+#endif /* CONFIG_CLUSTER */
+
+/// @endcond
+
 #endif /* __UART_H__ */
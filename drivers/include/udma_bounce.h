@@ -0,0 +1,111 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __UDMA_BOUNCE_H__
+#define __UDMA_BOUNCE_H__
+
+/**
+ * Pool of L2 bounce buffers shared by the uDMA drivers
+ *
+ * The uDMA can only access L2. Transfers from or to other memories (e.g. FC
+ * TCDM) are copied through buffers of this pool. Large buffers are chunked
+ * through two pool buffers: while the uDMA works on one chunk, the next one
+ * is already queued in the channel.
+ */
+
+#include <stdint.h>
+
+/* Number of buffers in the pool. */
+#ifndef UDMA_BOUNCE_NB_BUF
+#define UDMA_BOUNCE_NB_BUF (8)
+#endif
+
+/* Size of each buffer of the pool, in bytes. */
+#ifndef UDMA_BOUNCE_BUF_SIZE
+#define UDMA_BOUNCE_BUF_SIZE (256)
+#endif
+
+#if UDMA_BOUNCE_NB_BUF > 32
+#error "UDMA_BOUNCE_NB_BUF must not exceed 32"
+#endif
+
+/* Chunked transfer through two bounce buffers. */
+struct udma_bounce_pipe {
+	uint32_t user;	    /*!< Next user address to queue. */
+	uint32_t left;	    /*!< Bytes left to queue. */
+	uint8_t *buf[2];    /*!< Bounce buffers, buf[1] may be NULL. */
+	uint32_t dst[2];    /*!< User address of the chunk in each buffer. */
+	uint32_t size[2];   /*!< Size of the chunk in each buffer. */
+	uint8_t head;	    /*!< Buffer of the oldest queued chunk. */
+	uint8_t inflight;   /*!< Number of queued chunks. */
+	uint8_t is_rx;	    /*!< Copy out on completion instead of copy in. */
+};
+
+/* Check whether the uDMA can access this address. */
+static inline int udma_bounce_is_l2(uint32_t addr)
+{
+	return (addr & 0xFFF00000) == 0x1C000000;
+}
+
+/* Get a buffer from the pool, NULL if the pool is empty. */
+uint8_t *udma_bounce_alloc(void);
+
+/* Give a buffer back to the pool. */
+void udma_bounce_free(uint8_t *buf);
+
+/* Number of free buffers in the pool. */
+uint32_t udma_bounce_available(void);
+
+/*
+ * Set up a chunked transfer of size bytes at user address. Returns 0 on
+ * success, -1 if no buffer could be taken from the pool.
+ */
+int udma_bounce_pipe_start(struct udma_bounce_pipe *pipe, uint32_t user,
+			   uint32_t size, int is_rx);
+
+/*
+ * Get the next chunk to queue in the uDMA channel. For TX, the chunk is
+ * copied into the bounce buffer. Returns the L2 address of the chunk and
+ * stores its size, or returns 0 if no chunk can be queued now.
+ */
+uint32_t udma_bounce_pipe_next(struct udma_bounce_pipe *pipe, uint32_t *size);
+
+/*
+ * Complete the oldest queued chunk. For RX, the chunk is copied to the user
+ * buffer. Returns 1 once the whole transfer is done, in which case the
+ * buffers are given back to the pool.
+ */
+int udma_bounce_pipe_done(struct udma_bounce_pipe *pipe);
+
+/* Drop a chunked transfer and give its buffers back to the pool. */
+void udma_bounce_pipe_abort(struct udma_bounce_pipe *pipe);
+
+/* Check whether a chunked transfer is running. */
+static inline int udma_bounce_pipe_busy(struct udma_bounce_pipe *pipe)
+{
+	return pipe->buf[0] != NULL;
+}
+
+/* Check whether udma_bounce_pipe_next() would return a chunk now. */
+static inline int udma_bounce_pipe_ready(struct udma_bounce_pipe *pipe)
+{
+	uint8_t nb_buf = (pipe->buf[1] != NULL) ? 2 : 1;
+	return (pipe->left != 0) && (pipe->inflight < nb_buf);
+}
+
+#endif /* __UDMA_BOUNCE_H__ */
@@ -0,0 +1,303 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __UDMA_QUEUE_H__
+#define __UDMA_QUEUE_H__
+
+/**
+ * Transfer queue of a uDMA channel
+ *
+ * A single-producer/single-consumer ring. The first task which pushes becomes
+ * the producer of the queue: it writes the slots and the tail, the owner of
+ * the channel reads them and writes the head. The FC is a single core, each
+ * index is one aligned word store and neither side masks interrupts.
+ *
+ * Pushes from interrupt handlers, from other tasks, or while the ring is full
+ * are parked on an overflow list with interrupts masked. The owner takes them
+ * once the ring is empty, so the producer also parks its tasks while the list
+ * is not empty to keep them in order.
+ *
+ * The channel is owned by the code that starts its transfers: the submitter
+ * which claimed it, then the end of transfer handler. The owner starts the
+ * task at the head, pops it once it is done and hands the channel to the next
+ * one with udma_queue_next(). When the queue runs empty the ownership is
+ * dropped and the next push claims it again. The producer claims without
+ * masking interrupts, the others claim with interrupts masked and leave it to
+ * the producer if it is claiming meanwhile.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "riscv.h"
+#include "irq.h"
+#include "pmsis_types.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* Number of slots of each queue, must be a power of 2. */
+#ifndef UDMA_QUEUE_SIZE
+#define UDMA_QUEUE_SIZE (16)
+#endif
+
+#if (UDMA_QUEUE_SIZE & (UDMA_QUEUE_SIZE - 1)) != 0
+#error "UDMA_QUEUE_SIZE must be a power of 2"
+#endif
+
+/* Masks interrupts on the overflow path, tests/udma_queue measures it. */
+#ifndef udma_queue_irq_disable
+#define udma_queue_irq_disable()    __disable_irq()
+#define udma_queue_irq_restore(irq) __restore_irq(irq)
+#endif
+
+/* Orders the slot and index accesses, a single core needs no fence. */
+#define udma_queue_barrier() __asm volatile("" ::: "memory")
+
+struct udma_queue {
+	struct pi_task *slot[UDMA_QUEUE_SIZE];
+	volatile uint32_t head;	    /*!< Next slot to take, owner only. */
+	volatile uint32_t tail;	    /*!< Next free slot, producer only. */
+	volatile uint32_t owned;    /*!< Set while a task runs. */
+	volatile uint32_t claiming; /*!< Producer is in udma_queue_claim(). */
+	void *volatile producer;    /*!< Task pushing into the ring. */
+	struct pi_task *volatile overflow; /*!< Parked, interrupts masked. */
+	struct pi_task *overflow_last;	   /*!< Last task of overflow. */
+	struct pi_task *first; /*!< Tasks taken by the owner, in order. */
+	struct pi_task *last;  /*!< Last task of first. */
+};
+
+static inline void udma_queue_init(struct udma_queue *q)
+{
+	for (uint32_t i = 0; i < (uint32_t)UDMA_QUEUE_SIZE; i++) {
+		q->slot[i] = NULL;
+	}
+	q->head = 0;
+	q->tail = 0;
+	q->owned = 0;
+	q->claiming = 0;
+	q->producer = NULL;
+	q->overflow = NULL;
+	q->overflow_last = NULL;
+	q->first = NULL;
+	q->last = NULL;
+}
+
+/* The calling task, NULL in an interrupt handler. */
+static inline void *udma_queue_self(void)
+{
+	if (irq_in_isr()) {
+		return NULL;
+	}
+	return xTaskGetCurrentTaskHandle();
+}
+
+static inline int udma_queue_is_producer(struct udma_queue *q, void *self)
+{
+	return (self != NULL) && (self == q->producer);
+}
+
+static inline int udma_queue_empty(struct udma_queue *q)
+{
+	return (q->first == NULL) && (q->head == q->tail) &&
+	       (q->overflow == NULL);
+}
+
+/* Append a task to the ring. Producer only. */
+static inline int __udma_queue_ring_push(struct udma_queue *q,
+					 struct pi_task *task)
+{
+	uint32_t tail = q->tail;
+	if ((tail - q->head) >= (uint32_t)UDMA_QUEUE_SIZE) {
+		return -1;
+	}
+	task->next = NULL;
+	q->slot[tail & (UDMA_QUEUE_SIZE - 1)] = task;
+	udma_queue_barrier();
+	/* Publishes the slot to the owner. */
+	q->tail = tail + 1;
+	return 0;
+}
+
+/*
+ * Push from anyone but the producer, or with tasks parked. The first task to
+ * push becomes the producer. Parks the task, unless defer is 0 and the ring is
+ * full. Returns 0 on success, -1 if the task was not pushed.
+ */
+static inline int __udma_queue_push_masked(struct udma_queue *q,
+					   struct pi_task *task, int defer)
+{
+	void *self = udma_queue_self();
+	int ret = 0;
+
+	uint32_t irq = udma_queue_irq_disable();
+	if ((q->producer == NULL) && (self != NULL)) {
+		q->producer = self;
+	}
+	if (udma_queue_is_producer(q, self) && (q->overflow == NULL) &&
+	    (__udma_queue_ring_push(q, task) == 0)) {
+		/* pushed into the ring */
+	} else if (!defer &&
+		   ((q->tail - q->head) >= (uint32_t)UDMA_QUEUE_SIZE)) {
+		ret = -1;
+	} else {
+		task->next = NULL;
+		if (q->overflow == NULL) {
+			q->overflow = task;
+		} else {
+			q->overflow_last->next = task;
+		}
+		q->overflow_last = task;
+	}
+	udma_queue_irq_restore(irq);
+	return ret;
+}
+
+/* Append a task. Returns 0 on success, -1 if the queue is full. */
+static inline int udma_queue_push(struct udma_queue *q, struct pi_task *task)
+{
+	if (udma_queue_is_producer(q, udma_queue_self()) &&
+	    (q->overflow == NULL)) {
+		return __udma_queue_ring_push(q, task);
+	}
+	return __udma_queue_push_masked(q, task, 0);
+}
+
+/* Append a task, to the overflow list if the queue is full. */
+static inline void udma_queue_push_defer(struct udma_queue *q,
+					 struct pi_task *task)
+{
+	if (udma_queue_is_producer(q, udma_queue_self()) &&
+	    (q->overflow == NULL) && (__udma_queue_ring_push(q, task) == 0)) {
+		return;
+	}
+	__udma_queue_push_masked(q, task, 1);
+}
+
+/* Take the next pushed task into the owner's list, ring first. Owner only. */
+static inline struct pi_task *__udma_queue_take(struct udma_queue *q)
+{
+	struct pi_task *task = NULL;
+	uint32_t head = q->head;
+
+	if (head != q->tail) {
+		udma_queue_barrier();
+		task = q->slot[head & (UDMA_QUEUE_SIZE - 1)];
+		q->slot[head & (UDMA_QUEUE_SIZE - 1)] = NULL;
+		/* Frees the slot for the producer. */
+		q->head = head + 1;
+	} else if (q->overflow != NULL) {
+		uint32_t irq = udma_queue_irq_disable();
+		task = q->overflow;
+		q->overflow = task->next;
+		udma_queue_irq_restore(irq);
+	} else {
+		return NULL;
+	}
+	task->next = NULL;
+	if (q->first == NULL) {
+		q->first = task;
+	} else {
+		q->last->next = task;
+	}
+	q->last = task;
+	return task;
+}
+
+/* Get the n-th task from the head, NULL if there is none. Owner only. */
+static inline struct pi_task *udma_queue_at(struct udma_queue *q, uint32_t n)
+{
+	struct pi_task *task = q->first;
+	for (uint32_t i = 0;; i++) {
+		if ((task == NULL) && ((task = __udma_queue_take(q)) == NULL)) {
+			return NULL;
+		}
+		if (i == n) {
+			return task;
+		}
+		task = task->next;
+	}
+}
+
+static inline struct pi_task *udma_queue_head(struct udma_queue *q)
+{
+	return udma_queue_at(q, 0);
+}
+
+/* Remove the task at the head. Owner only. */
+static inline struct pi_task *udma_queue_pop(struct udma_queue *q)
+{
+	struct pi_task *task = udma_queue_head(q);
+	if (task != NULL) {
+		q->first = task->next;
+		task->next = NULL;
+	}
+	return task;
+}
+
+/*
+ * Take the ownership of the channel if it is idle and a task is waiting at
+ * the head. Returns that task, which the caller must start, or NULL.
+ */
+static inline struct pi_task *udma_queue_claim(struct udma_queue *q)
+{
+	uint32_t claimed = 0;
+
+	if (!udma_queue_is_producer(q, udma_queue_self())) {
+		uint32_t irq = udma_queue_irq_disable();
+		/* A claiming producer will see our task. */
+		if (!q->claiming && !q->owned && !udma_queue_empty(q)) {
+			q->owned = 1;
+			claimed = 1;
+		}
+		udma_queue_irq_restore(irq);
+		return claimed ? udma_queue_head(q) : NULL;
+	}
+
+	/* The others do not claim while claiming is set, check again after
+	 * clearing it for the tasks they pushed meanwhile. */
+	do {
+		q->claiming = 1;
+		udma_queue_barrier();
+		if (!q->owned && !udma_queue_empty(q)) {
+			q->owned = 1;
+			claimed = 1;
+		}
+		udma_queue_barrier();
+		q->claiming = 0;
+		udma_queue_barrier();
+	} while (!claimed && !q->owned && !udma_queue_empty(q));
+	return claimed ? udma_queue_head(q) : NULL;
+}
+
+/*
+ * Hand the channel to the next task once the head has been popped. Returns
+ * the task to start, or NULL when the queue is empty and the ownership is
+ * dropped. Owner only.
+ */
+static inline struct pi_task *udma_queue_next(struct udma_queue *q)
+{
+	struct pi_task *task = udma_queue_head(q);
+	if (task != NULL) {
+		return task;
+	}
+	q->owned = 0;
+	udma_queue_barrier();
+	/* A task pushed after the check above could not claim. */
+	return udma_queue_claim(q);
+}
+
+#endif /* __UDMA_QUEUE_H__ */
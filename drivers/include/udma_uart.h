@@ -23,19 +23,65 @@
 #include "uart_periph.h"
 #include "udma_core.h"
 #include "udma_ctrl.h"
+#include "udma_bounce.h"
+#include "udma_queue.h"
 #include "bits.h"
 
+/* Size of the L2 buffer used to coalesce small TX fragments. */
+#ifndef UART_TX_STAGING_SIZE
+#define UART_TX_STAGING_SIZE (256)
+#endif
+
+/* TX fragments up to this size are copied into the staging buffer. */
+#ifndef UART_TX_COALESCE_MAX
+#define UART_TX_COALESCE_MAX (32)
+#endif
+
+#if UART_TX_COALESCE_MAX > UART_TX_STAGING_SIZE
+#error "UART_TX_COALESCE_MAX must not exceed UART_TX_STAGING_SIZE"
+#endif
+
 /*
- * pi_task:
+ * pi_task (RX):
  * data[0] = l2_buf
  * data[1] = size
  * data[2] = channel
  * data[3] = repeat_size
  * data[4] = device_id (used for delegation)
+ *
+ * pi_task (TX):
+ * data[0] = current iovec
+ * data[1] = number of iovec left
+ * data[2] = channel
+ * data[4] = device_id (used for delegation)
+ * data[5] = offset in current iovec
+ * data[6] = iovec for single buffer writes (base)
+ * data[7] = iovec for single buffer writes (len)
+ */
+
+/*
+ * RX ring (continuous mode):
+ * The ring is split in two halves which are alternately programmed in the
+ * uDMA RX channel with the continuous bit set. Once a half is complete, the
+ * other half is already running and the completed half is queued again so
+ * that the channel never goes idle.
  */
+struct uart_rx_ring_s {
+	uint32_t l2_buf;	/*!< Ring base address in L2. */
+	uint32_t half_size;	/*!< Size of one half, 0 if ring is disabled. */
+	uint32_t overrun;	/*!< Halves overwritten before being read. */
+	uint8_t next;		/*!< Index of the next half to complete. */
+	uint8_t head;		/*!< Index of the oldest unread half. */
+	uint8_t count;		/*!< Number of completed unread halves. */
+	uint8_t **chunk;	/*!< Where to store the chunk for the waiter. */
+	struct pi_task *waiter; /*!< Task waiting for a completed half. */
+};
+
 struct uart_itf_data_s {
-	struct pi_task *fifo_head[2]; /*!< 0 = RX | 1 = TX. */
-	struct pi_task *fifo_tail[2]; /*!< 0 = RX | 1 = TX. */
+	struct udma_queue queue[2]; /*!< Pending transfers, 0 = RX | 1 = TX. */
+	struct uart_rx_ring_s rx_ring; /*!< Continuous RX ring state. */
+	uint8_t *tx_staging; /*!< L2 buffer for coalesced TX fragments. */
+	struct udma_bounce_pipe bounce[2]; /*!< Non-L2 transfers, RX + TX. */
 	uint32_t nb_open;   /*!< Number of times device has been opened. */
 	uint32_t device_id; /*!< Device ID. */
 };
@@ -184,6 +230,15 @@ static inline void hal_uart_enqueue(uint32_t device_id, uint32_t l2_buf,
 	uart_udma_channel_set(device_id, l2_buf, size, cfg, channel);
 }
 
+/* Enqueue a RX buffer which is reloaded by the uDMA when it is done. */
+static inline void hal_uart_rx_enqueue_continuous(uint32_t device_id,
+						  uint32_t l2_buf,
+						  uint32_t size)
+{
+	hal_uart_enqueue(device_id, l2_buf, size,
+			 REG_SET(UDMA_CORE_RX_CFG_CONTINOUS, 1), RX_CHANNEL);
+}
+
 static inline void hal_uart_rx_clear(uint32_t device_id)
 {
 	udma_channel_clear(&(uart(device_id)->rx));
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2021 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Interrupt latency instrumentation, see irq_latency.h */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "pulp_mem_map.h"
+#include "properties.h"
+#include "io.h"
+#include "csr.h"
+#include "irq.h"
+#include "riscv.h"
+#include "timer.h"
+#include "system.h"
+#include "irq_latency.h"
+
+static struct {
+	struct {
+		struct irq_latency_stat entry;
+		struct irq_latency_stat handler;
+		uint32_t raised;
+		uint32_t pending; /* raised is valid */
+	} lines[IRQ_LATENCY_NB_LINES];
+	struct irq_latency_stat soc_event;
+	struct irq_latency_stat wake;
+	/* tasks woken from an interrupt handler which did not run yet */
+	struct {
+		TaskHandle_t task;
+		uint32_t at;
+	} woken[IRQ_LATENCY_NB_WAKES];
+	uint32_t wakes_lost;
+} lat;
+
+static inline uint32_t lat_now(void)
+{
+	return csr_read(CSR_MCYCLE);
+}
+
+/* Cycles since the FC timer low half matched its compare. The kernel tick
+ * counts the 32 kHz reference clock, so this has the resolution of a timer
+ * count converted to core cycles. */
+static uint32_t lat_timer_lo_late(void)
+{
+	uint32_t cfg = readw((uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CFG_LO_OFFSET));
+	uint32_t cnt = readw((uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CNT_LO_OFFSET));
+	uint32_t cmp = readw((uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CMP_LO_OFFSET));
+	/* in cycle mode the counter restarts from 0 on the match */
+	uint64_t late = (cfg & TIMER_CFG_LO_MODE_MASK) ? cnt : cnt - cmp;
+
+	if (cfg & TIMER_CFG_LO_PEN_MASK)
+		late *= ((cfg & TIMER_CFG_LO_PVAL_MASK) >> TIMER_CFG_LO_PVAL_BIT) + 1;
+	if (cfg & TIMER_CFG_LO_CCFG_MASK)
+		late = late * system_core_clock_get() / ARCHI_REF_CLOCK;
+	return late > UINT32_MAX ? UINT32_MAX : (uint32_t)late;
+}
+
+static void lat_stat_init(struct irq_latency_stat *stat)
+{
+	memset(stat, 0, sizeof(*stat));
+	stat->min = UINT32_MAX;
+}
+
+static void lat_stat_add(struct irq_latency_stat *stat, uint32_t cycles)
+{
+	uint32_t bucket = cycles ? 31 - __builtin_clz(cycles) : 0;
+	if (bucket >= IRQ_LATENCY_NB_BUCKETS)
+		bucket = IRQ_LATENCY_NB_BUCKETS - 1;
+
+	stat->count++;
+	stat->hist[bucket]++;
+	if (cycles < stat->min || stat->count == 1)
+		stat->min = cycles;
+	if (cycles > stat->max)
+		stat->max = cycles;
+}
+
+static void lat_stat_print(const char *name, int id,
+			   const struct irq_latency_stat *stat)
+{
+	if (stat->count == 0)
+		return;
+
+	if (id >= 0)
+		printf("%s %d:", name, id);
+	else
+		printf("%s:", name);
+	printf(" n=%" PRIu32 " min=%" PRIu32 " max=%" PRIu32 "\n", stat->count,
+	       stat->min, stat->max);
+	for (int i = 0; i < IRQ_LATENCY_NB_BUCKETS; i++) {
+		if (stat->hist[i])
+			printf("  >=%" PRIu32 ": %" PRIu32 "\n",
+			       i ? (uint32_t)1 << i : 0, stat->hist[i]);
+	}
+}
+
+void irq_latency_reset(void)
+{
+	uint32_t irq = __disable_irq();
+
+	/* Enable the cycle counter. */
+	csr_write(CSR_MCOUNTINHIBIT, 0);
+
+	for (int i = 0; i < IRQ_LATENCY_NB_LINES; i++) {
+		lat_stat_init(&lat.lines[i].entry);
+		lat_stat_init(&lat.lines[i].handler);
+		lat.lines[i].pending = 0;
+	}
+	lat_stat_init(&lat.soc_event);
+	lat_stat_init(&lat.wake);
+	for (int i = 0; i < IRQ_LATENCY_NB_WAKES; i++)
+		lat.woken[i].task = NULL;
+	lat.wakes_lost = 0;
+	__restore_irq(irq);
+}
+
+void irq_latency_dump(void)
+{
+	struct irq_latency_stat stat;
+
+	for (int i = 0; i < IRQ_LATENCY_NB_LINES; i++) {
+		struct irq_latency_stat handler;
+		if (irq_latency_get(i, &stat, &handler))
+			continue;
+		lat_stat_print("irq entry", i, &stat);
+		lat_stat_print("irq handler", i, &handler);
+	}
+
+	uint32_t irq = __disable_irq();
+	stat = lat.soc_event;
+	__restore_irq(irq);
+	lat_stat_print("soc event handler", -1, &stat);
+
+	irq = __disable_irq();
+	stat = lat.wake;
+	uint32_t lost = lat.wakes_lost;
+	__restore_irq(irq);
+	lat_stat_print("isr to task", -1, &stat);
+	if (lost)
+		printf("isr to task: %" PRIu32 " wakes lost\n", lost);
+}
+
+int irq_latency_get(int id, struct irq_latency_stat *entry,
+		    struct irq_latency_stat *handler)
+{
+	if (id < 0 || id >= IRQ_LATENCY_NB_LINES)
+		return -1;
+
+	uint32_t irq = __disable_irq();
+	*entry = lat.lines[id].entry;
+	*handler = lat.lines[id].handler;
+	__restore_irq(irq);
+	return 0;
+}
+
+void irq_latency_raise(int id)
+{
+	if (id < 0 || id >= IRQ_LATENCY_NB_LINES)
+		return;
+
+	uint32_t irq = __disable_irq();
+	lat.lines[id].raised = lat_now();
+	lat.lines[id].pending = 1;
+	__restore_irq(irq);
+}
+
+/* called with interrupts disabled from vSystemIrqHandler */
+uint32_t irq_latency_enter(int id)
+{
+	uint32_t now = lat_now();
+
+	if (id >= IRQ_LATENCY_NB_LINES)
+		return now;
+
+	if (lat.lines[id].pending) {
+		lat.lines[id].pending = 0;
+		lat_stat_add(&lat.lines[id].entry, now - lat.lines[id].raised);
+	} else if (id == IRQ_FC_EVT_TIMER0_LO) {
+		lat_stat_add(&lat.lines[id].entry, lat_timer_lo_late());
+	}
+	return now;
+}
+
+void irq_latency_exit(int id, uint32_t start)
+{
+	if (id < IRQ_LATENCY_NB_LINES)
+		lat_stat_add(&lat.lines[id].handler, lat_now() - start);
+}
+
+uint32_t irq_latency_soc_event_enter(void)
+{
+	return lat_now();
+}
+
+void irq_latency_soc_event_exit(uint32_t start)
+{
+	lat_stat_add(&lat.soc_event, lat_now() - start);
+}
+
+/* From an interrupt handler. Repeated wakes of a task keep the first time.
+ * When all slots are taken the oldest wake is dropped, its task may never
+ * call irq_latency_woken(). */
+void irq_latency_wake(TaskHandle_t task)
+{
+	uint32_t now = lat_now();
+	int slot = 0;
+
+	for (int i = 0; i < IRQ_LATENCY_NB_WAKES; i++) {
+		if (lat.woken[i].task == task)
+			return;
+	}
+	/* a free slot, else the oldest wake */
+	for (int i = 0; i < IRQ_LATENCY_NB_WAKES; i++) {
+		if (lat.woken[i].task == NULL) {
+			slot = i;
+			break;
+		}
+		if (now - lat.woken[i].at > now - lat.woken[slot].at)
+			slot = i;
+	}
+	if (lat.woken[slot].task != NULL)
+		lat.wakes_lost++;
+	lat.woken[slot].task = task;
+	lat.woken[slot].at = now;
+}
+
+/* From a task right after it was woken up. */
+void irq_latency_woken(void)
+{
+	uint32_t now = lat_now();
+	TaskHandle_t self = xTaskGetCurrentTaskHandle();
+	uint32_t irq = __disable_irq();
+
+	for (int i = 0; i < IRQ_LATENCY_NB_WAKES; i++) {
+		if (lat.woken[i].task == self) {
+			lat.woken[i].task = NULL;
+			lat_stat_add(&lat.wake, now - lat.woken[i].at);
+			break;
+		}
+	}
+	__restore_irq(irq);
+}
@@ -17,7 +17,9 @@
 
 SRCS += $(dir)/uart.c
 SRCS += $(dir)/spi.c
+SRCS += $(dir)/spiflash.c
 SRCS += $(dir)/i2c.c
+SRCS += $(dir)/udma_bounce.c
 ifeq ($(CONFIG_UDMA_I2C_ACK),y)
 CV_CPPFLAGS += -DCONFIG_UDMA_I2C_ACK
 endif
@@ -39,6 +41,7 @@ SRCS += $(dir)/cluster/fc_to_cl_delegate.c
 endif
 
 SRCS += $(dir)/timer_irq.c
+SRCS += $(dir)/hrtimer.c
 ifeq ($(CONFIG_DRIVER_INT),pclint)
 SRCS += $(dir)/pclint.c
 else ifeq ($(CONFIG_DRIVER_INT),clic)
@@ -52,8 +55,17 @@ SRCS += $(dir)/soc_eu.c
 SRCS += $(dir)/gpio.c
 SRCS += $(dir)/pinmux.c
 SRCS += $(dir)/fc_event.c
+ifeq ($(CONFIG_IRQ_LATENCY),y)
+SRCS += $(dir)/irq_latency.c
+CV_CPPFLAGS += -DCONFIG_IRQ_LATENCY
+endif
+SRCS += $(dir)/trace.c
+ifeq ($(CONFIG_TRACE),y)
+CV_CPPFLAGS += -DCONFIG_TRACE
+endif
 
 SRCS += $(dir)/pmsis_task.c
+SRCS += $(dir)/event_kernel.c
 SRCS += $(dir)/device.c
 
 CV_CPPFLAGS += -I"$(FREERTOS_PROJ_ROOT)/$(dir)/include"
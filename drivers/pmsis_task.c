@@ -20,14 +20,93 @@
 #include "pmsis_task.h"
 #include "debug.h"
 #include "os.h"
+#include "event_kernel.h"
+#include "irq_latency.h"
+#include "hrtimer.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Stored in waiter by pi_task_release(), a waiter arriving late returns. */
+#define TASK_RELEASED ((void *)1)
+/* Set in waiter when it points to the group the task is attached to. */
+#define TASK_GROUP_TAG ((uintptr_t)2)
+/* Bit of the task in its group. */
+#define TASK_GROUP_INDEX(task) ((task)->arg[3])
+
+/* Waits sleep on their own notification index, index 0 stays free for the
+ * application and stdio. With a single notification entry they share index 0:
+ * waits still loop until their event is done, but they consume notifications
+ * the application sends to the waiting task. */
+#ifndef PI_TASK_NOTIFY_INDEX
+#if configTASK_NOTIFICATION_ARRAY_ENTRIES > 1
+#define PI_TASK_NOTIFY_INDEX 1
+#else
+#define PI_TASK_NOTIFY_INDEX 0
+#endif
+#endif
+
+#if PI_TASK_NOTIFY_INDEX >= configTASK_NOTIFICATION_ARRAY_ENTRIES
+#error "configTASK_NOTIFICATION_ARRAY_ENTRIES must be above PI_TASK_NOTIFY_INDEX"
+#endif
+
+/* Interrupt handlers and main() before the scheduler starts can only poll. */
+static inline int task_can_block(void)
+{
+	return !irq_in_isr() &&
+	       (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+}
+
+static void task_notify(TaskHandle_t waiter)
+{
+	if (irq_in_isr()) {
+		BaseType_t woken = pdFALSE;
+		irq_latency_wake(waiter);
+		vTaskNotifyGiveIndexedFromISR(waiter, PI_TASK_NOTIFY_INDEX,
+					      &woken);
+		portYIELD_FROM_ISR(woken);
+	} else {
+		xTaskNotifyGiveIndexed(waiter, PI_TASK_NOTIFY_INDEX);
+	}
+}
+
+/* The waiter and the releaser, possibly a handler, both write waiter and each
+ * must see what the other stored. A short masked exchange, once per wait and
+ * once per release. */
+static inline void *task_waiter_swap(pi_task_t *task, void *waiter)
+{
+	uint32_t irq = __disable_irq();
+	void *prev = task->waiter;
+	task->waiter = waiter;
+	__restore_irq(irq);
+	return prev;
+}
+
+/* Set and clear released tasks of a group, interrupts masked. */
+static inline void task_group_done_set(pi_task_group_t *group, uint32_t bits)
+{
+	uint32_t irq = __disable_irq();
+	group->done |= bits;
+	__restore_irq(irq);
+}
+
+static inline void task_group_done_clear(pi_task_group_t *group,
+					 uint32_t bits)
+{
+	uint32_t irq = __disable_irq();
+	group->done &= ~bits;
+	__restore_irq(irq);
+}
 
 pi_task_t *__pi_task_block(pi_task_t *callback_task)
 {
 	callback_task->id = PI_TASK_NONE_ID;
 	callback_task->done = 0;
-	pi_sem_init(&(callback_task->wait_on));
-	/* lock the mutex so that task may be descheduled while waiting on it */
-	callback_task->destroy = 1;
+	/* the waiter is woken up with a task notification, no semaphore */
+	callback_task->wait_on.sem_object = (void *)NULL;
+	callback_task->waiter = NULL;
+	callback_task->destroy = 0;
+	callback_task->status = 0;
 	callback_task->core_id = -1;
 	return callback_task;
 }
@@ -40,7 +119,9 @@ pi_task_t *__pi_task_callback(pi_task_t *callback_task, void (*func)(void *),
 	callback_task->arg[1] = (uintptr_t)arg;
 	callback_task->done = 0;
 	callback_task->wait_on.sem_object = (void *)NULL;
+	callback_task->waiter = NULL;
 	callback_task->destroy = 0;
+	callback_task->status = 0;
 	callback_task->core_id = -1;
 	return callback_task;
 }
@@ -62,22 +143,32 @@ void __pi_task_destroy(pi_task_t *task)
 
 void __pi_task_wait_on(pi_task_t *task)
 {
-	while (!task->done) {
-		/* if the underlying scheduler support it, deschedule the task
-		 */
-		//if (task->wait_on.sem_object != NULL) {
-		//	pi_sem_take(&task->wait_on);
-		//}
-		DEBUG_PRINTF("[%s] waited on sem %p\n", __func__,
-			     &(task->wait_on));
+	if (!task_can_block()) {
+		while (!task->done) {
+			hal_compiler_barrier();
+		}
+		hal_compiler_barrier();
+		__pi_task_destroy(task);
+		return;
 	}
+	void *self = xTaskGetCurrentTaskHandle();
+	if (task_waiter_swap(task, self) != TASK_RELEASED) {
+		/* a late notification of an earlier task may wake us up */
+		while (__atomic_load_n(&task->waiter, __ATOMIC_ACQUIRE) !=
+		       TASK_RELEASED) {
+			ulTaskNotifyTakeIndexed(PI_TASK_NOTIFY_INDEX, pdTRUE,
+						portMAX_DELAY);
+			irq_latency_woken();
+		}
+	}
+	DEBUG_PRINTF("[%s] waited on task %p\n", __func__, task);
 	hal_compiler_barrier();
 	__pi_task_destroy(task);
 }
 
 void __pi_task_push(pi_task_t *task)
 {
-	pi_task_push_delayed_us(task, 0);
+	pi_event_kernel_push(task);
 }
 
 pi_task_t *pi_task_callback_no_mutex(pi_task_t *callback_task,
@@ -91,9 +182,10 @@ pi_task_t *pi_task_block_no_mutex(pi_task_t *callback_task)
 	callback_task->id = PI_TASK_NONE_ID;
 	callback_task->done = 0;
 	callback_task->wait_on.sem_object = (void *)NULL;
+	callback_task->waiter = NULL;
 	callback_task->destroy = 0;
+	callback_task->status = 0;
 	callback_task->core_id = -1;
-	/* lock the mutex so that task may be descheduled while waiting on it */
 	return callback_task;
 }
 
@@ -108,7 +200,20 @@ void pi_task_release(pi_task_t *task)
 	}
 	hal_compiler_barrier();
 	task->done = 1;
-	hal_compiler_barrier();
+	void *waiter = task_waiter_swap(task, TASK_RELEASED);
+	if ((waiter == NULL) || (waiter == TASK_RELEASED)) {
+		return;
+	}
+	if ((uintptr_t)waiter & TASK_GROUP_TAG) {
+		pi_task_group_t *group =
+			(pi_task_group_t *)((uintptr_t)waiter & ~TASK_GROUP_TAG);
+		task_group_done_set(group, 1u << TASK_GROUP_INDEX(task));
+		waiter = __atomic_load_n(&group->waiter, __ATOMIC_SEQ_CST);
+		if (waiter == NULL) {
+			return;
+		}
+	}
+	task_notify((TaskHandle_t)waiter);
 }
 
 void pi_cl_pi_task_wait(pi_task_t *task)
@@ -132,9 +237,112 @@ void pi_task_wait_on_no_mutex(pi_task_t *task)
 
 void pi_task_push_delayed_us(pi_task_t *task, uint32_t delay)
 {
-	pi_time_wait_us((int)delay);
-	uint32_t irq = disable_irq();
-	/* TODO: unimplemented callback */
-	/* pmsis_event_push(pmsis_event_get_default_scheduler(), task); */
-	restore_irq(irq);
+	pi_event_kernel_push_delayed(task, delay);
+}
+
+void pi_task_group_init(pi_task_group_t *group)
+{
+	group->mask = 0;
+	group->done = 0;
+	group->waiter = NULL;
+}
+
+int pi_task_group_add(pi_task_group_t *group, pi_task_t *task)
+{
+	if (group->mask == 0xFFFFFFFFu) {
+		return -1;
+	}
+	uint32_t index = __builtin_ctz(~group->mask);
+	group->mask |= 1u << index;
+	TASK_GROUP_INDEX(task) = index;
+	void *tagged = (void *)((uintptr_t)group | TASK_GROUP_TAG);
+	if (task_waiter_swap(task, tagged) == TASK_RELEASED) {
+		/* released before being attached */
+		__atomic_store_n(&task->waiter, TASK_RELEASED, __ATOMIC_SEQ_CST);
+		task_group_done_set(group, 1u << index);
+	}
+	return (int)index;
+}
+
+/* Sleep until any (or all) attached tasks are released, returns the released
+ * ones or 0 on timeout. */
+static uint32_t task_group_wait(pi_task_group_t *group, int all,
+				uint32_t timeout_us)
+{
+	int can_sleep = task_can_block();
+	int forever = (timeout_us == PI_TASK_WAIT_FOREVER);
+	TickType_t start = 0;
+	TickType_t ticks = 0;
+	uint64_t deadline = 0;
+	if (forever) {
+		ticks = portMAX_DELAY;
+	} else if (can_sleep) {
+		start = xTaskGetTickCount();
+		ticks = (TickType_t)(((uint64_t)timeout_us * configTICK_RATE_HZ +
+				      999999) / 1000000);
+	} else {
+		/* the tick count does not advance before the scheduler starts
+		 * nor within an interrupt handler */
+		deadline = hrtimer_get_us() + timeout_us;
+	}
+	if (can_sleep) {
+		__atomic_store_n(&group->waiter, xTaskGetCurrentTaskHandle(),
+				 __ATOMIC_SEQ_CST);
+	}
+	uint32_t done;
+	for (;;) {
+		done = __atomic_load_n(&group->done, __ATOMIC_SEQ_CST) &
+		       group->mask;
+		if (all ? (done == group->mask) : (done != 0)) {
+			break;
+		}
+		if (!can_sleep) {
+			if (!forever && (hrtimer_get_us() >= deadline)) {
+				done = 0;
+				break;
+			}
+			continue;
+		}
+		TickType_t wait = portMAX_DELAY;
+		if (!forever) {
+			TickType_t elapsed = xTaskGetTickCount() - start;
+			if (elapsed >= ticks) {
+				done = 0;
+				break;
+			}
+			wait = ticks - elapsed;
+		}
+		ulTaskNotifyTakeIndexed(PI_TASK_NOTIFY_INDEX, pdTRUE, wait);
+		irq_latency_woken();
+	}
+	__atomic_store_n(&group->waiter, NULL, __ATOMIC_SEQ_CST);
+	return done;
+}
+
+int pi_task_wait_any(pi_task_group_t *group, uint32_t timeout_us)
+{
+	if (group->mask == 0) {
+		return -1;
+	}
+	uint32_t done = task_group_wait(group, 0, timeout_us);
+	if (done == 0) {
+		return -1;
+	}
+	uint32_t index = __builtin_ctz(done);
+	group->mask &= ~(1u << index);
+	task_group_done_clear(group, 1u << index);
+	return (int)index;
+}
+
+int pi_task_wait_all(pi_task_group_t *group, uint32_t timeout_us)
+{
+	if (group->mask == 0) {
+		return 0;
+	}
+	if (task_group_wait(group, 1, timeout_us) == 0) {
+		return -1;
+	}
+	task_group_done_clear(group, group->mask);
+	group->mask = 0;
+	return 0;
 }
@@ -33,6 +33,9 @@
 #include "spi.h"
 #include "udma_spim.h"
 #include "udma_ctrl.h"
+#include "udma_core.h"
+#include "udma_bounce.h"
+#include "udma_queue.h"
 
 #ifdef DEBUG
 #define DEBUG_PRINTF printf
@@ -44,19 +47,45 @@
 
 #define SPIM_CS_DATA_GET_DRV_DATA(cs_data) (cs_data->drv_data)
 
+/* Largest data stream of one SPI command, in bytes (64 Kbits). */
+#define SPIM_CHUNK_SIZE (8192)
+
+/* Largest data stream of one SPI command with 8-bit words, in bytes. */
+#define SPIM_BATCH_MAX_LEN (1 << SPI_CMD_RX_DATA_SIZE_WIDTH)
+
+/* Kind of a queued transfer in task->data[5], any other value is the send
+ * buffer of a full duplex transfer. */
+#define SPIM_TRANSFER_RX    0
+#define SPIM_TRANSFER_TX    1
+#define SPIM_TRANSFER_BATCH 2
+
 struct spim_driver_data *__g_spim_drv_data[UDMA_NB_SPIM] = {0};
 
-struct spim_drv_fifo {
-	pi_task_t *fifo_head;
-	pi_task_t *fifo_tail;
+/* Precompiled command program of a chip select, replayed by pointer. It is
+ * stored twice so that the next chunk can be patched while one runs. */
+struct spim_ucode {
+	uint32_t *cmd;	    /* cfg, SOT, user ucode, data, EOT (x2) */
+	uint32_t nb_words;  /* user ucode words */
+	int32_t addr_idx;   /* word receiving the address, -1 if none */
+	uint32_t addr_shift; /* the address is sent msb first from bit 31 */
 };
 
+#define SPIM_UCODE_RX 0
+#define SPIM_UCODE_TX 1
+
+/* Words of one copy of a program. */
+#define SPIM_UCODE_STRIDE(ucode) ((ucode)->nb_words + 4)
+
+/* Number of chip selects of an interface */
+#define SPIM_NB_CS (1 << SPI_CMD_SOT_CS_WIDTH)
+
 /* Structure holding infos for each chip selects (itf, cs, polarity etc...) */
 struct spim_cs_data {
-	struct spim_cs_data *next;
 	struct spim_driver_data *drv_data;
 	uint32_t cfg;
+	/* two command streams, cfg and SOT are written at open */
 	uint32_t udma_cmd[8];
+	struct spim_ucode *ucode[2]; /* receive and send programs */
 	uint32_t max_baudrate;
 	uint32_t polarity;
 	uint32_t phase;
@@ -65,14 +94,41 @@ struct spim_cs_data {
 	uint8_t big_endian;
 };
 
+/* Data streams of a transfer */
+#define SPIM_DIR_TX (1 << 0)
+#define SPIM_DIR_RX (1 << 1)
+
+struct spim_stream {
+	uint32_t addr;			/* next chunk, L2 buffers only */
+	struct udma_bounce_pipe bounce; /* non-L2 buffers */
+};
+
+/* Running transfer, split in chunks queued back to back in the uDMA */
+struct spim_chunks {
+	struct spim_cs_data *cs_data;
+	uint32_t left;	       /* bits not queued yet */
+	uint8_t inflight;      /* chunks queued in the uDMA */
+	uint8_t cmd_idx;       /* udma_cmd half used by the next chunk */
+	uint8_t dir;	       /* SPIM_DIR_TX and/or SPIM_DIR_RX */
+	uint32_t data_cmd;     /* data command of one word */
+	uint8_t cs_keep;       /* keep CS asserted after the last chunk */
+	uint8_t first;	       /* next chunk is the first one */
+	struct spim_ucode *ucode; /* program of the transfer, may be NULL */
+	uint32_t ext_addr;	  /* device address of the next chunk */
+	struct spim_stream tx;
+	struct spim_stream rx;
+};
+
 /* Structure holding info for each interfaces
  * most notably the fifo of enqueued transfers and meta to know whether
  * interface is free or not */
 struct spim_driver_data {
-	struct spim_drv_fifo *drv_fifo;
-	struct spim_cs_data *cs_list;
-	pi_task_t *repeat_transfer;
+	struct udma_queue queue; /* transfers, head is the running one */
+	struct spim_cs_data *cs[SPIM_NB_CS];
 	pi_task_t *end_of_transfer;
+	struct spim_chunks chunks;
+	pi_spi_batch_t *batch; /* running batch, received data is scattered at
+				  the end */
 	uint32_t nb_open;
 	uint8_t device_id;
 };
@@ -81,9 +137,9 @@ struct spim_transfer {
 	pi_spi_flags_e flags;
 	void *data;
 	uint32_t len;
-	uint32_t cfg_cmd;
-	uint32_t byte_align;
 	uint32_t is_send;
+	struct spim_ucode *ucode;
+	uint32_t addr;
 };
 
 void __spim_execute_callback(void *arg);
@@ -93,10 +149,9 @@ void spim_rx_handler(void *arg);
 int __pi_spi_open(struct spim_cs_data **cs_data, struct pi_spi_conf *conf);
 int __pi_spi_close(struct spim_cs_data *cs_data);
 
-static int32_t __pi_spim_drv_fifo_enqueue(struct spim_cs_data *data,
-					  struct spim_transfer *transfer,
-					  pi_task_t *end_task);
-static inline pi_task_t *__pi_spim_drv_fifo_pop(struct spim_driver_data *data);
+static void __pi_spim_transfer_enqueue(struct spim_cs_data *cs_data,
+				       struct spim_transfer *transfer,
+				       pi_task_t *end_task);
 /* static inline void __pi_spim_exec_transfer(pi_task_t *task); */
 
 void __pi_spi_send_async(struct spim_cs_data *cs_data, void *data, size_t len,
@@ -114,17 +169,28 @@ void __pi_spi_send_async_with_ucode(struct spim_cs_data *cs_data, void *data,
 void __pi_spi_xfer_async(struct spim_cs_data *cs_data, void *tx_data,
 			 void *rx_data, size_t len, pi_spi_flags_e flags,
 			 pi_task_t *task);
+static void __pi_spim_exec_next_transfer(pi_task_t *task);
+static void __pi_spi_send_exec(struct spim_cs_data *cs_data, void *data,
+			       size_t len, pi_spi_flags_e flags,
+			       pi_task_t *task);
+static void __pi_spi_receive_exec(struct spim_cs_data *cs_data, void *data,
+				  size_t len, pi_spi_flags_e flags,
+				  pi_task_t *task);
+static void __pi_spi_xfer_exec(struct spim_cs_data *cs_data, void *tx_data,
+			       void *rx_data, size_t len, pi_spi_flags_e flags,
+			       pi_task_t *task);
+static void __pi_spi_batch_exec(pi_spi_batch_t *batch, pi_task_t *task);
 
 static inline uint32_t __pi_spi_get_config(struct spim_cs_data *cs_data)
 {
 	return cs_data->cfg;
 }
 
-static inline int32_t __pi_spim_drv_fifo_enqueue(struct spim_cs_data *cs_data,
-						 struct spim_transfer *transfer,
-						 pi_task_t *end_task)
+/* Queue a transfer and start it right away if the interface is idle. */
+static void __pi_spim_transfer_enqueue(struct spim_cs_data *cs_data,
+				       struct spim_transfer *transfer,
+				       pi_task_t *end_task)
 {
-	uint32_t irq = __disable_irq();
 	struct spim_driver_data *drv_data = cs_data->drv_data;
 	/* Callback args. */
 	end_task->data[0] = (uintptr_t)cs_data;
@@ -133,69 +199,35 @@ static inline int32_t __pi_spim_drv_fifo_enqueue(struct spim_cs_data *cs_data,
 	end_task->data[3] = (uintptr_t)transfer->flags;
 	end_task->data[4] = (uintptr_t)end_task;
 	end_task->data[5] = (uintptr_t)transfer->is_send;
-	end_task->next = NULL;
-	/* Enqueue transfer in drv fifo. */
-	if (drv_data->drv_fifo->fifo_head == NULL) {
-		/* Empty fifo. */
-		drv_data->drv_fifo->fifo_head = end_task;
-		drv_data->drv_fifo->fifo_tail = drv_data->drv_fifo->fifo_head;
-	} else {
-		/* Enqueue to tail. */
-		drv_data->drv_fifo->fifo_tail->next = end_task;
-		drv_data->drv_fifo->fifo_tail =
-			drv_data->drv_fifo->fifo_tail->next;
-	}
-	__restore_irq(irq);
-	return 0;
-}
-
-static inline pi_task_t *__pi_spim_drv_fifo_pop(struct spim_driver_data *data)
-{
-
-	pi_task_t *task_return = NULL;
-	uint32_t irq = __disable_irq();
-	if (data->drv_fifo->fifo_head != NULL) {
-		task_return = data->drv_fifo->fifo_head;
-		data->drv_fifo->fifo_head = data->drv_fifo->fifo_head->next;
-		if (data->drv_fifo->fifo_head == NULL) {
-			data->drv_fifo->fifo_tail = NULL;
-		}
+	end_task->data[6] = (uintptr_t)transfer->ucode;
+	end_task->data[7] = (uintptr_t)transfer->addr;
+	pi_task_status_set(end_task, 0);
+	/* Parked while the queue is full, this may run in an interrupt
+	 * handler or a completion callback. */
+	udma_queue_push_defer(&drv_data->queue, end_task);
+	pi_task_t *task = udma_queue_claim(&drv_data->queue);
+	if (task) {
+		__pi_spim_exec_next_transfer(task);
 	}
-	__restore_irq(irq);
-	return task_return;
 }
 
 static inline struct spim_cs_data *
 __pi_spim_get_cs_data(struct spim_driver_data *drv_data, int cs)
 {
-	struct spim_cs_data *cs_cur = drv_data->cs_list;
-	while (cs_cur != NULL && cs_cur->cs != cs) {
-		cs_cur = cs_cur->next;
-	}
-	return cs_cur;
+	return drv_data->cs[cs];
 }
 
 static inline void __pi_spim_cs_data_del(struct spim_driver_data *drv_data,
 					 int cs)
 {
-	struct spim_cs_data *cs_cur = drv_data->cs_list;
-	struct spim_cs_data *cs_prev = cs_cur;
-	while (cs_cur != NULL && cs_cur->cs != cs) {
-		cs_prev = cs_cur;
-		cs_cur = cs_cur->next;
-	}
-	if (cs_cur) {
-		cs_prev->next = cs_cur->next;
-		cs_cur->next = NULL;
-	}
+	drv_data->cs[cs] = NULL;
 }
+
 static inline void __pi_spim_cs_data_add(struct spim_driver_data *drv_data,
 					 struct spim_cs_data *cs_data)
 {
-	// head insert, most recently allocated should be most recently used
 	cs_data->drv_data = drv_data;
-	cs_data->next = drv_data->cs_list;
-	drv_data->cs_list = cs_data->next;
+	drv_data->cs[cs_data->cs] = cs_data;
 }
 
 static uint32_t __pi_spi_clk_div_get(uint32_t spi_freq)
@@ -233,64 +265,323 @@ void __pi_spim_execute_callback(void *arg)
 	return;
 }
 
-void __pi_spim_exec_next_transfer(pi_task_t *task)
+/* Start the transfer at the head of the queue, the caller owns the interface. */
+static void __pi_spim_exec_next_transfer(pi_task_t *task)
 {
-	if (task->data[5] == 1) { // if is send
+	if (task->data[5] == SPIM_TRANSFER_TX) {
 		// cs data | data buffer | len | flags | end of transfer task
-		__pi_spi_send_async((struct spim_cs_data *)task->data[0],
-				    (void *)task->data[1], task->data[2],
-				    task->data[3], (pi_task_t *)task->data[4]);
-	} else if (task->data[5] == 0) {
+		__pi_spi_send_exec((struct spim_cs_data *)task->data[0],
+				   (void *)task->data[1], task->data[2],
+				   task->data[3], (pi_task_t *)task->data[4]);
+	} else if (task->data[5] == SPIM_TRANSFER_RX) {
 		// cs data | data buffer | len | flags | end of transfer task
-		__pi_spi_receive_async((struct spim_cs_data *)task->data[0],
-				       (void *)task->data[1], task->data[2],
-				       task->data[3],
-				       (pi_task_t *)task->data[4]);
-	} else { // task->data[5] contains rx data addr
+		__pi_spi_receive_exec((struct spim_cs_data *)task->data[0],
+				      (void *)task->data[1], task->data[2],
+				      task->data[3],
+				      (pi_task_t *)task->data[4]);
+	} else if (task->data[5] == SPIM_TRANSFER_BATCH) {
+		__pi_spi_batch_exec((pi_spi_batch_t *)task->data[1],
+				    (pi_task_t *)task->data[4]);
+	} else { // task->data[5] contains tx data addr
 		// cs data | tx buffer | rx buffer| len | flags | end of
 		// transfer task
-		__pi_spi_xfer_async((struct spim_cs_data *)task->data[0],
-				    (void *)task->data[5],
-				    (void *)task->data[1], task->data[2],
-				    task->data[3], (pi_task_t *)task->data[4]);
+		__pi_spi_xfer_exec((struct spim_cs_data *)task->data[0],
+				   (void *)task->data[5], (void *)task->data[1],
+				   task->data[2], task->data[3],
+				   (pi_task_t *)task->data[4]);
 	}
 }
 
-extern struct pmsis_event_kernel_wrap *default_sched;
+/* Data command of one 32-bit word, by direction and quad mode. The number of
+ * words minus one goes in the low bits. */
+static const uint32_t __pi_spim_data_cmd[4][2] = {
+	[SPIM_DIR_TX] = {SPI_CMD_TX_DATA(1ul, SPI_CMD_1_WORD_PER_TRANSF, 32ul,
+					 SPI_CMD_QPI_DIS, SPI_CMD_MSB_FIRST),
+			 SPI_CMD_TX_DATA(1ul, SPI_CMD_1_WORD_PER_TRANSF, 32ul,
+					 SPI_CMD_QPI_ENA, SPI_CMD_MSB_FIRST)},
+	[SPIM_DIR_RX] = {SPI_CMD_RX_DATA(1ul, SPI_CMD_1_WORD_PER_TRANSF, 32ul,
+					 SPI_CMD_QPI_DIS, SPI_CMD_MSB_FIRST),
+			 SPI_CMD_RX_DATA(1ul, SPI_CMD_1_WORD_PER_TRANSF, 32ul,
+					 SPI_CMD_QPI_ENA, SPI_CMD_MSB_FIRST)},
+	/* full duplex is single line only, quad transfers are rejected */
+	[SPIM_DIR_TX | SPIM_DIR_RX] = {
+		SPI_CMD_FUL(1ul, SPI_CMD_1_WORD_PER_TRANSF, 32ul,
+			    SPI_CMD_MSB_FIRST)},
+};
 
-void spim_eot_handler(void *arg)
+/* Data command of a chunk in 32-bit words, or in bytes when its size is not
+ * a multiple of 32 bits. The uDMA moves the data streams with the word size.
+ * The word size field is at the same place in the TX, RX and full duplex
+ * commands. */
+static uint32_t __pi_spim_data_words(uint32_t data_cmd, uint32_t bits,
+				     uint32_t *datasize)
+{
+	if (bits & 31) {
+		*datasize = UDMA_CORE_CFG_DATASIZE_8;
+		data_cmd &= ~(((1ul << SPI_CMD_TX_DATA_BITSWORD_WIDTH) - 1)
+			      << SPI_CMD_TX_DATA_BITSWORD_OFFSET);
+		data_cmd |= (8ul - 1) << SPI_CMD_TX_DATA_BITSWORD_OFFSET;
+		return data_cmd | ((bits / 8) - 1);
+	}
+	*datasize = UDMA_CORE_CFG_DATASIZE_32;
+	return data_cmd | ((bits / 32) - 1);
+}
+
+/* Clamp the size of the next chunk to what the stream can take now, returns
+ * 0 if the stream cannot take a chunk yet. */
+static int __pi_spim_stream_fit(struct spim_stream *stream, uint32_t *size)
+{
+	if (!udma_bounce_pipe_busy(&stream->bounce)) {
+		return 1;
+	}
+	if (!udma_bounce_pipe_ready(&stream->bounce)) {
+		/* only one bounce buffer */
+		return 0;
+	}
+	if (*size > UDMA_BOUNCE_BUF_SIZE) {
+		*size = UDMA_BOUNCE_BUF_SIZE;
+	}
+	return 1;
+}
+
+/* L2 address of the next chunk of a stream. */
+static uint32_t __pi_spim_stream_next(struct spim_stream *stream,
+				      uint32_t size)
+{
+	if (udma_bounce_pipe_busy(&stream->bounce)) {
+		return udma_bounce_pipe_next(&stream->bounce, &size);
+	}
+	uint32_t addr = stream->addr;
+	stream->addr += size;
+	return addr;
+}
+
+/* Returns -1 if the buffer needs a bounce buffer and the pool is empty. */
+static int __pi_spim_stream_start(struct spim_stream *stream, void *data,
+				  uint32_t size, int is_rx)
+{
+	stream->addr = (uint32_t)data;
+	/* The uDMA only reaches L2, copy other buffers through the bounce
+	 * pool. */
+	if (!udma_bounce_is_l2((uint32_t)data) && (size != 0) &&
+	    udma_bounce_pipe_start(&stream->bounce, (uint32_t)data, size,
+				   is_rx)) {
+		DBG_PRINTF("%s:%d: bounce pool empty\n", __func__, __LINE__);
+		return -1;
+	}
+	return 0;
+}
+
+/* Queue chunks of the running transfer until both uDMA slots are used. Each
+ * chunk has its own command stream, the two halves of udma_cmd alternate.
+ * The end of transfer handler pushes too, so interrupts are masked. */
+static void __pi_spim_chunks_push(struct spim_driver_data *drv_data)
+{
+	struct spim_chunks *chunks = &drv_data->chunks;
+	struct spim_cs_data *cs_data = chunks->cs_data;
+	int device_id = drv_data->device_id;
+	uint32_t conf = UDMA_CORE_TX_CFG_EN(1) |
+			UDMA_CORE_TX_CFG_DATASIZE(UDMA_CORE_CFG_DATASIZE_32);
+	uint32_t irq = __disable_irq();
+
+	/* A program is sent even without data, e.g. a flash command. */
+	while (((chunks->left != 0) ||
+		(chunks->first && (chunks->ucode != NULL))) &&
+	       (chunks->inflight < 2)) {
+		uint32_t tx_addr = 0, rx_addr = 0;
+		uint32_t size = (chunks->left + 7) >> 3;
+		if (size > SPIM_CHUNK_SIZE) {
+			size = SPIM_CHUNK_SIZE;
+		}
+		if (((chunks->dir & SPIM_DIR_TX) &&
+		     !__pi_spim_stream_fit(&chunks->tx, &size)) ||
+		    ((chunks->dir & SPIM_DIR_RX) &&
+		     !__pi_spim_stream_fit(&chunks->rx, &size))) {
+			break;
+		}
+		if (chunks->dir & SPIM_DIR_TX) {
+			tx_addr = __pi_spim_stream_next(&chunks->tx, size);
+		}
+		if (chunks->dir & SPIM_DIR_RX) {
+			rx_addr = __pi_spim_stream_next(&chunks->rx, size);
+		}
+		uint32_t bits = size << 3;
+		if (bits > chunks->left) {
+			bits = chunks->left;
+		}
+		chunks->left -= bits;
+
+		struct spim_ucode *ucode = chunks->ucode;
+		int replay = (ucode != NULL) && (ucode->addr_idx >= 0);
+		uint32_t cs_keep = chunks->cs_keep;
+		/* CS stays asserted between the chunks of a transfer, unless
+		 * each chunk is a new command to the device. */
+		if ((chunks->left != 0) && !replay) {
+			cs_keep = 1;
+		}
+		uint32_t *cmd, nb_cmd;
+		if ((ucode != NULL) && (chunks->first || replay)) {
+			/* cfg and SOT are already in the program */
+			nb_cmd = SPIM_UCODE_STRIDE(ucode);
+			cmd = &ucode->cmd[nb_cmd * chunks->cmd_idx];
+			if (replay) {
+				cmd[ucode->addr_idx] = chunks->ext_addr
+						       << ucode->addr_shift;
+				chunks->ext_addr += size;
+			}
+		} else {
+			/* cfg and SOT are written at open */
+			nb_cmd = 4;
+			cmd = &cs_data->udma_cmd[4 * chunks->cmd_idx];
+		}
+		uint32_t datasize = UDMA_CORE_CFG_DATASIZE_32;
+		if (bits != 0) {
+			cmd[nb_cmd - 2] = __pi_spim_data_words(chunks->data_cmd,
+							       bits, &datasize);
+		} else {
+			nb_cmd--;
+		}
+		cmd[nb_cmd - 1] = SPI_CMD_EOT(1ul, cs_keep);
+		chunks->cmd_idx ^= 1;
+		chunks->first = 0;
+		chunks->inflight++;
+		DBG_PRINTF("%s:%d: chunk tx=%lx rx=%lx size=%ld left=%ld\n",
+			   __func__, __LINE__, tx_addr, rx_addr, size,
+			   chunks->left);
+
+		/* receive data stream, command stream, then send data
+		 * stream */
+		uint32_t data_conf = UDMA_CORE_TX_CFG_EN(1) |
+				     UDMA_CORE_TX_CFG_DATASIZE(datasize);
+		if ((chunks->dir & SPIM_DIR_RX) && (size != 0)) {
+			spim_enqueue_channel(SPIM(device_id), rx_addr, size,
+					     data_conf, RX_CHANNEL);
+		}
+		spim_enqueue_channel(SPIM(device_id), (uint32_t)cmd,
+				     nb_cmd * sizeof(uint32_t), conf,
+				     COMMAND_CHANNEL);
+		if ((chunks->dir & SPIM_DIR_TX) && (size != 0)) {
+			spim_enqueue_channel(SPIM(device_id), tx_addr, size,
+					     data_conf, TX_CHANNEL);
+		}
+	}
+	__restore_irq(irq);
+}
+
+/* Start a transfer, the caller owns the interface. tx_data and rx_data may
+ * be NULL for half duplex transfers. The program and device address of the
+ * transfer are in the task, see __pi_spim_transfer_enqueue(). */
+static void __pi_spim_chunks_start(struct spim_cs_data *cs_data,
+				   void *tx_data, void *rx_data, size_t len,
+				   pi_spi_flags_e flags, pi_task_t *task)
 {
-	uint32_t event = (uint32_t)arg;
-	/* TODO: remove is garbage */
-	// EOT is simply 22 + id in GAP8
-	uint32_t periph_id = (event - SOC_EVENT_UDMA_SPIM_EOT(0));
+	struct spim_driver_data *drv_data = SPIM_CS_DATA_GET_DRV_DATA(cs_data);
+	struct spim_chunks *chunks = &drv_data->chunks;
+	uint32_t buffer_size = (len + 7) >> 3;
+	uint32_t quad = (flags & (0x3 << 2)) == PI_SPI_LINES_QUAD;
+	/* The end of transfer handler of the first chunk must not run before
+	 * the transfer is fully set up. */
+	uint32_t irq = __disable_irq();
 
-	struct spim_driver_data *drv_data = __g_spim_drv_data[periph_id];
+	chunks->cs_data = cs_data;
+	chunks->left = len;
+	chunks->inflight = 0;
+	chunks->cmd_idx = 0;
+	chunks->dir = 0;
+	chunks->cs_keep = ((flags >> 0) & 0x3) == PI_SPI_CS_KEEP;
+	chunks->first = 1;
+	chunks->ucode = (struct spim_ucode *)task->data[6];
+	chunks->ext_addr = task->data[7];
+	drv_data->end_of_transfer = task;
+
+	/* the data streams are moved in bytes at least, full duplex has no
+	 * quad mode */
+	if ((len & 7) || (quad && (tx_data != NULL) && (rx_data != NULL)) ||
+	    ((tx_data != NULL) &&
+	     __pi_spim_stream_start(&chunks->tx, tx_data, buffer_size, 0)) ||
+	    ((rx_data != NULL) &&
+	     __pi_spim_stream_start(&chunks->rx, rx_data, buffer_size, 1))) {
+		/* fail the transfer without sending anything */
+		udma_bounce_pipe_abort(&chunks->tx.bounce);
+		udma_bounce_pipe_abort(&chunks->rx.bounce);
+		pi_task_status_set(task, -1);
+		chunks->left = 0;
+		spim_eot_handler(drv_data);
+		__restore_irq(irq);
+		return;
+	}
+	if (tx_data != NULL) {
+		chunks->dir |= SPIM_DIR_TX;
+	}
+	if (rx_data != NULL) {
+		chunks->dir |= SPIM_DIR_RX;
+	}
+	chunks->data_cmd = __pi_spim_data_cmd[chunks->dir][quad];
+	__pi_spim_chunks_push(drv_data);
+	if (chunks->inflight == 0) {
+		/* nothing to send, complete right away */
+		spim_eot_handler(drv_data);
+	}
+	__restore_irq(irq);
+}
 
-	if (drv_data->repeat_transfer) {
-		DBG_PRINTF("%s:%d\n", __func__, __LINE__);
-		// TODO: reenqueue the rest of the transfer
-		DBG_PRINTF("Large transfers (>8k) are not implemented yet\n");
+/* Account for a completed chunk, returns 1 once the transfer is done. */
+static int __pi_spim_chunks_done(struct spim_driver_data *drv_data)
+{
+	struct spim_chunks *chunks = &drv_data->chunks;
+	if (chunks->inflight != 0) {
+		chunks->inflight--;
+		if (udma_bounce_pipe_busy(&chunks->tx.bounce)) {
+			udma_bounce_pipe_done(&chunks->tx.bounce);
+		}
+		if (udma_bounce_pipe_busy(&chunks->rx.bounce)) {
+			udma_bounce_pipe_done(&chunks->rx.bounce);
+		}
+	}
+	if ((chunks->left == 0) && (chunks->inflight == 0)) {
+		return 1;
+	}
+	__pi_spim_chunks_push(drv_data);
+	return 0;
+}
+
+/* Copy the received data of a batch to the user buffers. */
+static void __pi_spi_batch_scatter(pi_spi_batch_t *batch)
+{
+	uint8_t *rx = batch->rx_buf;
+	for (int i = 0; i < batch->nb_reqs; i++) {
+		pi_spi_batch_req_t *req = &batch->reqs[i];
+		if (req->rx_data != NULL) {
+			memcpy(req->rx_data, rx, req->len >> 3);
+			rx += req->len >> 3;
+		}
+	}
+}
+
+void spim_eot_handler(void *arg)
+{
+	struct spim_driver_data *drv_data = arg;
+
+	if (!__pi_spim_chunks_done(drv_data)) {
+		DBG_PRINTF("%s:%d: next chunk queued\n", __func__, __LINE__);
 		return;
 	}
+	if (drv_data->batch != NULL) {
+		__pi_spi_batch_scatter(drv_data->batch);
+		drv_data->batch = NULL;
+	}
 	pi_task_t *task = drv_data->end_of_transfer;
 	DBG_PRINTF("%s:%d\n", __func__, __LINE__);
 	if (task != NULL) {
+		udma_queue_pop(&drv_data->queue);
 		if (task->id == PI_TASK_NONE_ID) {
 			DBG_PRINTF("%s:%d release task %p\n", __func__,
 				   __LINE__, task);
 			pi_task_release(task);
 		} else {
-			/* TODO: hacked away */
-			/* DBG_PRINTF("%s:%d push task %p with id:%x in
-			 * sched%p\n", */
-			/* 	   __func__, __LINE__, task, task->id, */
-			/* 	   default_sched); */
-			DBG_PRINTF("%s:%d periph id:%"PRIu32"\n", __func__, __LINE__,
-				   periph_id);
-			/* TODO: hacked away */
-			/* pmsis_event_push(default_sched, task); */
-			DBG_PRINTF("%s:%d\n", __func__, __LINE__);
+			DBG_PRINTF("%s:%d push task %p with id:%x\n", __func__,
+				   __LINE__, task, task->id);
+			pi_task_push(task);
 		}
 		drv_data->end_of_transfer = NULL;
 	}
@@ -299,7 +590,7 @@ void spim_eot_handler(void *arg)
 		DBG_PRINTF("%s:%d null task %p\n", __func__, __LINE__, task);
 	}
 #endif
-	task = __pi_spim_drv_fifo_pop(drv_data);
+	task = udma_queue_next(&drv_data->queue);
 	if (task) {
 		__pi_spim_exec_next_transfer(task);
 	}
@@ -308,97 +599,143 @@ void spim_eot_handler(void *arg)
 /* TODO: REMOVE THOSE */
 void spim_tx_handler(void *arg)
 { // if we're here, it's cs keep related
-	uint32_t event = (uint32_t)arg;
-	uint32_t periph_id =
-		(event >> UDMA_CHANNEL_NB_EVENTS_LOG2) - UDMA_SPIM_ID(0);
-	hal_soc_eu_clear_fc_mask((int)SOC_EVENT_UDMA_SPIM_TX(periph_id));
-	arg = (void *)(SOC_EVENT_UDMA_SPIM_EOT(0) + periph_id);
-	DBG_PRINTF("%s:%d periph_id %"PRIu32" arg:%p\n", __func__, __LINE__, periph_id,
-		   arg);
-	spim_eot_handler(arg);
+	struct spim_driver_data *drv_data = arg;
+	hal_soc_eu_clear_fc_mask((int)SOC_EVENT_UDMA_SPIM_TX(drv_data->device_id));
+	DBG_PRINTF("%s:%d periph_id %d\n", __func__, __LINE__,
+		   drv_data->device_id);
+	spim_eot_handler(drv_data);
 	DBG_PRINTF("%s:%d\n", __func__, __LINE__);
 }
 
 /* TODO: REMOVE THOSE and the handler */
 void spim_rx_handler(void *arg)
 { // if we're here, it's cs keep related
-	uint32_t event = (uint32_t)arg;
-	uint32_t periph_id =
-		(event >> UDMA_CHANNEL_NB_EVENTS_LOG2) - UDMA_SPIM_ID(0);
-	hal_soc_eu_clear_fc_mask((int)SOC_EVENT_UDMA_SPIM_RX(periph_id));
-	arg = (void *)(SOC_EVENT_UDMA_SPIM_EOT(0ul) + periph_id);
-	DBG_PRINTF("%s:%d periph_id %"PRIu32" arg:%p\n", __func__, __LINE__, periph_id,
-		   arg);
-	spim_eot_handler(arg);
+	struct spim_driver_data *drv_data = arg;
+	hal_soc_eu_clear_fc_mask((int)SOC_EVENT_UDMA_SPIM_RX(drv_data->device_id));
+	DBG_PRINTF("%s:%d periph_id %d\n", __func__, __LINE__,
+		   drv_data->device_id);
+	spim_eot_handler(drv_data);
 	DBG_PRINTF("%s:%d\n", __func__, __LINE__);
 }
 
 
+static void __pi_spi_receive_exec(struct spim_cs_data *cs_data, void *data,
+				  size_t len, pi_spi_flags_e flags,
+				  pi_task_t *task)
+{
+	__pi_spim_chunks_start(cs_data, NULL, data, len, flags, task);
+}
+
 void __pi_spi_receive_async(struct spim_cs_data *cs_data, void *data,
 			    size_t len, pi_spi_flags_e flags, pi_task_t *task)
 {
-	struct spim_driver_data *drv_data = SPIM_CS_DATA_GET_DRV_DATA(cs_data);
-	int qspi = (flags & (0x3 << 2)) == PI_SPI_LINES_QUAD;
-	int cs_mode = (flags >> 0) & 0x3;
-
-	int device_id = drv_data->device_id;
-	uint32_t cfg = cs_data->cfg;
 	DBG_PRINTF(
 		"%s:%d: core clock:%"PRIu32", baudrate:%"PRIu32", div=%"PRIu32", udma_cmd cfg =%lx, qpi=%d\n",
 		__func__, __LINE__, system_core_clock_get(),
 		cs_data->max_baudrate,
-		system_core_clock_get() / cs_data->max_baudrate, cfg, qspi);
-	uint32_t byte_align = (cs_data->wordsize == PI_SPI_WORDSIZE_32) &&
-			      cs_data->big_endian;
-	size_t buffer_size = (len + 7) >> 3;
+		system_core_clock_get() / cs_data->max_baudrate, cs_data->cfg,
+		(flags & (0x3 << 2)) == PI_SPI_LINES_QUAD);
+
+	struct spim_transfer transfer;
+	transfer.data = data;
+	transfer.flags = flags;
+	transfer.len = len;
+	transfer.is_send = 0;
+	transfer.ucode = NULL;
+	transfer.addr = 0;
+	__pi_spim_transfer_enqueue(cs_data, &transfer, task);
+}
 
-	if (len > 8192 * 8) {
-		DBG_PRINTF(
-			"%s:%d: Transaction splitting unimplemented, too large",
-			__func__, __LINE__);
-		abort(); /* TODO: unimplemented transaction splitting */
+static void __pi_spim_ucode_free(struct spim_cs_data *cs_data, int dir)
+{
+	struct spim_ucode *prog = cs_data->ucode[dir];
+	if (prog != NULL) {
+		pi_data_free(prog, sizeof(struct spim_ucode) +
+					   2 * SPIM_UCODE_STRIDE(prog) *
+						   sizeof(uint32_t));
+		cs_data->ucode[dir] = NULL;
 	}
+}
 
-	uint32_t irq = __disable_irq();
+/* Compile the program of a chip select: the user ucode is placed between SOT
+ * and the data command. Returns the user ucode inside the program, NULL if
+ * it could not be allocated. */
+static void *__pi_spim_ucode_set(struct spim_cs_data *cs_data, int dir,
+				 uint8_t *ucode, uint32_t ucode_size)
+{
+	struct spim_ucode *prog = cs_data->ucode[dir];
+	uint32_t nb_words = (ucode_size + 3) >> 2;
+	if ((prog == NULL) || (prog->nb_words != nb_words)) {
+		__pi_spim_ucode_free(cs_data, dir);
+		/* programs are read by the uDMA */
+		prog = pi_data_malloc(sizeof(struct spim_ucode) +
+				      2 * (nb_words + 4) * sizeof(uint32_t));
+		if (prog == NULL) {
+			DBG_PRINTF("[%s] ucode alloc failed\n", __func__);
+			return NULL;
+		}
+		prog->cmd = (uint32_t *)(prog + 1);
+		prog->nb_words = nb_words;
+		cs_data->ucode[dir] = prog;
+	}
+	prog->addr_idx = -1;
+	prog->addr_shift = 0;
+	for (int i = 0; i < 2; i++) {
+		uint32_t *cmd = &prog->cmd[SPIM_UCODE_STRIDE(prog) * i];
+		cmd[0] = cs_data->cfg;
+		cmd[1] = SPI_CMD_SOT((uint32_t)cs_data->cs);
+		if (nb_words != 0) {
+			cmd[1 + nb_words] = 0;
+			memcpy(&cmd[2], ucode, ucode_size);
+		}
+	}
+	return &prog->cmd[2];
+}
 
-	if (!drv_data->end_of_transfer) {
-		cs_data->udma_cmd[0] = cfg;
-		cs_data->udma_cmd[1] = SPI_CMD_SOT((uint32_t)cs_data->cs);
-		cs_data->udma_cmd[2] =
-			SPI_CMD_RX_DATA((uint32_t)len / 32, SPI_CMD_1_WORD_PER_TRANSF, 32,
-					(uint32_t)qspi, SPI_CMD_MSB_FIRST);
-		cs_data->udma_cmd[3] =
-			SPI_CMD_EOT(1ul, (uint32_t)(cs_mode == PI_SPI_CS_KEEP));
-		drv_data->end_of_transfer = task;
-		drv_data->repeat_transfer = NULL;
-
-		uint32_t rx_conf =
-			UDMA_CORE_TX_CFG_EN(1) |
-			UDMA_CORE_TX_CFG_DATASIZE(UDMA_CORE_CFG_DATASIZE_32);
+/* Mark the word of the program which receives the device address. */
+static void __pi_spim_ucode_set_addr_info(struct spim_cs_data *cs_data,
+					  int dir, uint8_t *ucode,
+					  uint32_t ucode_size)
+{
+	struct spim_ucode *prog = cs_data->ucode[dir];
+	if (prog == NULL) {
+		return;
+	}
+	int32_t idx = (int32_t)((uint32_t *)ucode - prog->cmd);
+	if ((idx < 2) || (idx >= (int32_t)(2 + prog->nb_words)) ||
+	    (ucode_size == 0)) {
+		DBG_PRINTF("[%s] address not in ucode\n", __func__);
+		return;
+	}
+	prog->addr_idx = idx;
+	prog->addr_shift = (ucode_size >= 4) ? 0 : 32 - 8 * ucode_size;
+}
 
-		/* receive data stream with 32-bit data size */
-		spim_enqueue_channel(SPIM(device_id), (uint32_t)data,
-				     (uint32_t)buffer_size, rx_conf, RX_CHANNEL);
+/* Queue a transfer preceded by a program. */
+static void __pi_spim_program_enqueue(struct spim_cs_data *cs_data,
+				      void *data, size_t len,
+				      pi_spi_flags_e flags, int dir,
+				      uint32_t addr, pi_task_t *task)
+{
+	struct spim_transfer transfer;
+	transfer.data = data;
+	transfer.flags = flags;
+	transfer.len = len;
+	transfer.is_send = (dir == SPIM_UCODE_TX);
+	transfer.ucode = cs_data->ucode[dir];
+	transfer.addr = addr;
+	__pi_spim_transfer_enqueue(cs_data, &transfer, task);
+}
 
-		uint32_t cmd_conf =
-			UDMA_CORE_TX_CFG_EN(1) |
-			UDMA_CORE_TX_CFG_DATASIZE(UDMA_CORE_CFG_DATASIZE_32);
-		/* send command stream with 32-bit data size */
-		spim_enqueue_channel(SPIM(device_id),
-				     (uint32_t)cs_data->udma_cmd,
-				     4 * sizeof(uint32_t), cmd_conf,
-				     COMMAND_CHANNEL);
-	} else {
-		struct spim_transfer transfer;
-		transfer.data = data;
-		transfer.flags = flags;
-		transfer.len = len;
-		transfer.cfg_cmd = cfg;
-		transfer.byte_align = byte_align;
-		transfer.is_send = 0;
-		__pi_spim_drv_fifo_enqueue(cs_data, &transfer, task);
-	}
+static void __pi_spim_ucode_transfer(struct spim_cs_data *cs_data, void *data,
+				     size_t len, pi_spi_flags_e flags,
+				     int ucode_size, void *ucode,
+				     pi_task_t *task, int dir)
+{
+	uint32_t irq = __disable_irq();
+	__pi_spim_ucode_set(cs_data, dir, ucode, (uint32_t)ucode_size);
 	restore_irq(irq);
+	__pi_spim_program_enqueue(cs_data, data, len, flags, dir, 0, task);
 }
 
 void __pi_spi_receive_async_with_ucode(struct spim_cs_data *cs_data, void *data,
@@ -406,64 +743,8 @@ void __pi_spi_receive_async_with_ucode(struct spim_cs_data *cs_data, void *data,
 				       int ucode_size, void *ucode,
 				       pi_task_t *task)
 {
-	/* TODO: port spi_async with ucode */
-	abort();
-#if 0
-    struct spim_driver_data *drv_data = SPIM_CS_DATA_GET_DRV_DATA(cs_data);
-    int qspi    = ((flags >> 2) & 0x3) == ((PI_SPI_LINES_QUAD>>2) & 0x03);
-    int cs_mode = (flags >> 0) & 0x3;
-
-    int device_id = drv_data->device_id;
-    uint32_t byte_align = (cs_data->wordsize == PI_SPI_WORDSIZE_32)
-        && cs_data->big_endian;
-    uint32_t cfg = cs_data->cfg;
-    DBG_PRINTF("%s:%d: core clock:%d, baudrate:%d, div=%d,  byte_align =%lx, cfg= %lx, qspi=%lx\n",
-            __func__,__LINE__,system_core_clock_get(),cs_data->max_baudrate,
-            system_core_clock_get() / cs_data->max_baudrate,byte_align,cfg,qspi);
-    int size = (len + 7) >> 3;
-
-    int cmd_id = 0;
-
-    uint32_t irq = __disable_irq();
-    if(!drv_data->end_of_transfer)
-    {
-        if(cs_mode != PI_SPI_CS_AUTO)
-        {
-            hal_soc_eu_set_fc_mask(SOC_EVENT_UDMA_SPIM_RX(device_id));
-        }
-        drv_data->end_of_transfer = task;
-        drv_data->repeat_transfer = NULL;
-        if(((0xFFF00000 & (uint32_t)ucode)!= 0x1c000000))
-        {
-            memcpy(&(cs_data->udma_cmd[0]), ucode, ucode_size);
-            spim_enqueue_channel(SPIM(device_id), (uint32_t)data, size,
-                    UDMA_CORE_RX_CFG_EN(1) | (2<<1), RX_CHANNEL);
-            spim_enqueue_channel(SPIM(device_id), (uint32_t)cs_data->udma_cmd,
-                    ucode_size, UDMA_CORE_TX_CFG_EN(1), TX_CHANNEL);
-        }
-        else
-        {
-            spim_enqueue_channel(SPIM(device_id), (uint32_t)data, size,
-                    UDMA_CORE_RX_CFG_EN(1) | (2<<1), RX_CHANNEL);
-            spim_enqueue_channel(SPIM(device_id), (uint32_t)ucode,
-                    ucode_size, UDMA_CORE_TX_CFG_EN(1), TX_CHANNEL);
-        }
-    }
-    else
-    {
-#if 0
-        struct spim_transfer transfer;
-        transfer.data = data;
-        transfer.flags = flags;
-        transfer.len = len;
-        transfer.cfg_cmd = cfg;
-        transfer.byte_align = byte_align;
-        transfer.is_send = 0;
-        __pi_spim_drv_fifo_enqueue(cs_data, &transfer, task);
-#endif
-    }
-    restore_irq(irq);
-#endif
+	__pi_spim_ucode_transfer(cs_data, data, len, flags, ucode_size, ucode,
+				 task, SPIM_UCODE_RX);
 }
 
 void __pi_spi_send_async_with_ucode(struct spim_cs_data *cs_data, void *data,
@@ -471,236 +752,219 @@ void __pi_spi_send_async_with_ucode(struct spim_cs_data *cs_data, void *data,
 				    int ucode_size, void *ucode,
 				    pi_task_t *task)
 {
-	/* TODO: port spi_async with ucode */
-	abort();
-#if 0
-    struct spim_driver_data *drv_data = SPIM_CS_DATA_GET_DRV_DATA(cs_data);
-    int qspi    = ((flags >> 2) & 0x3) == ((PI_SPI_LINES_QUAD>>2) & 0x03);
-    int cs_mode = (flags >> 0) & 0x3;
-
-    int device_id = drv_data->device_id;
-    uint32_t byte_align = (cs_data->wordsize == PI_SPI_WORDSIZE_32)
-        && cs_data->big_endian;
-    uint32_t cfg = cs_data->cfg;
-    DBG_PRINTF("%s:%d: core clock:%d, baudrate:%d, div=%d,  byte_align =%lx, cfg= %lx, qspi=%lx\n",
-            __func__,__LINE__,system_core_clock_get(),cs_data->max_baudrate,
-            system_core_clock_get() / cs_data->max_baudrate,byte_align,cfg,qspi);
-    int size = (len + 7) >> 3;
-
-    int cmd_id = 0;
-
-    uint32_t irq = __disable_irq();
-    if(!drv_data->end_of_transfer)
-    {
-        if(cs_mode != PI_SPI_CS_AUTO)
-        {
-            hal_soc_eu_set_fc_mask(SOC_EVENT_UDMA_SPIM_TX(device_id));
-        }
-        drv_data->end_of_transfer = task;
-        drv_data->repeat_transfer = NULL;
-
-        spim_enqueue_channel(SPIM(device_id), (uint32_t)ucode,
-                ucode_size, UDMA_CORE_TX_CFG_EN(1), TX_CHANNEL);
-        pi_time_wait_us(1000);
-        spim_enqueue_channel(SPIM(device_id), (uint32_t)data,
-                size, UDMA_CORE_TX_CFG_EN(1), TX_CHANNEL);
-        if(cs_mode == PI_SPI_CS_AUTO)
-        {
-            // wait until channel is free
-            while((hal_read32((void*)&(SPIM(device_id)->udma.tx_cfg))
-                        & (1<<5))>>5)
-            {
-                DBG_PRINTF("%s:%d\n",__func__,__LINE__);
-            }
-
-            // enqueue EOT
-            cs_data->udma_cmd[0] = SPI_CMD_EOT(1);
-            spim_enqueue_channel(SPIM(device_id),
-                    (uint32_t)&cs_data->udma_cmd[0], 1*(sizeof(uint32_t)),
-                    UDMA_CORE_TX_CFG_EN(1), TX_CHANNEL);
-        }
-    }
-    else
-    {
-#if 0
-        struct spim_transfer transfer;
-        transfer.data = data;
-        transfer.flags = flags;
-        transfer.len = len;
-        transfer.cfg_cmd = cfg;
-        transfer.byte_align = byte_align;
-        transfer.is_send = 0;
-        __pi_spim_drv_fifo_enqueue(cs_data, &transfer, task);
-#endif
-    }
-    restore_irq(irq);
-#endif
+	__pi_spim_ucode_transfer(cs_data, data, len, flags, ucode_size, ucode,
+				 task, SPIM_UCODE_TX);
+}
+
+static void __pi_spi_send_exec(struct spim_cs_data *cs_data, void *data,
+			       size_t len, pi_spi_flags_e flags,
+			       pi_task_t *task)
+{
+	__pi_spim_chunks_start(cs_data, data, NULL, len, flags, task);
 }
 
 void __pi_spi_send_async(struct spim_cs_data *cs_data, void *data, size_t len,
 			 pi_spi_flags_e flags, pi_task_t *task)
 {
-	struct spim_driver_data *drv_data = SPIM_CS_DATA_GET_DRV_DATA(cs_data);
-	int qspi = (flags & (0x3 << 2)) == PI_SPI_LINES_QUAD;
-	int cs_mode = (flags >> 0) & 0x3;
-
-	int device_id = drv_data->device_id;
-	uint32_t cfg = cs_data->cfg;
 	DBG_PRINTF(
 		"%s:%d: core clock:%"PRIu32", baudrate:%"PRIu32", div=%"PRIu32", udma_cmd cfg =%lx, qpi=%d\n",
 		__func__, __LINE__, system_core_clock_get(),
 		cs_data->max_baudrate,
-		system_core_clock_get() / cs_data->max_baudrate, cfg, qspi);
-	uint32_t byte_align = (cs_data->wordsize == PI_SPI_WORDSIZE_32) &&
-			      cs_data->big_endian;
-
-	/* buffer size */
-	size_t buffer_size = (len + 7) >> 3;
-
-	if (len > 8192 * 8) {
-		DBG_PRINTF(
-			"%s:%d: Transaction splitting unimplemented, too large",
-			__func__, __LINE__);
-		abort(); /* TODO: unimplemented transaction splitting */
-	}
-
-	DBG_PRINTF("%s:%d: udma_cmd=%p\n", __func__, __LINE__,
-		   &(cs_data->udma_cmd[0]));
-	uint32_t irq = disable_irq();
-	/* check if we already have a transfer ongoing */
-	if (!drv_data->end_of_transfer) { /* enqueue the transfer */
-		cs_data->udma_cmd[0] = cfg;
-		cs_data->udma_cmd[1] = SPI_CMD_SOT((uint32_t)cs_data->cs);
-		cs_data->udma_cmd[2] =
-			SPI_CMD_TX_DATA(len / 32, SPI_CMD_1_WORD_PER_TRANSF, 32,
-					(uint32_t)qspi, SPI_CMD_MSB_FIRST);
-		cs_data->udma_cmd[3] =
-			SPI_CMD_EOT(1ul, (uint32_t)(cs_mode == PI_SPI_CS_KEEP));
-		DBG_PRINTF("%s:%d\n", __func__, __LINE__);
-		drv_data->end_of_transfer = task;
-		drv_data->repeat_transfer = NULL;
-
-		/* First enqueue the header with SPI config, cs, and send
-		 * command. The rest will be sent by the assembly code. First
-		 * the user data and finally an epilogue with the EOT command.
-		 */
-		uint32_t cmd_conf =
-			UDMA_CORE_TX_CFG_EN(1) |
-			UDMA_CORE_TX_CFG_DATASIZE(UDMA_CORE_CFG_DATASIZE_32);
-		/* send command stream with 32-bit data size */
-		spim_enqueue_channel(SPIM(device_id),
-				     (uint32_t)cs_data->udma_cmd,
-				     4 * sizeof(uint32_t), cmd_conf,
-				     COMMAND_CHANNEL);
-
-		uint32_t tx_conf =
-			UDMA_CORE_TX_CFG_EN(1) |
-			UDMA_CORE_TX_CFG_DATASIZE(UDMA_CORE_CFG_DATASIZE_32);
+		system_core_clock_get() / cs_data->max_baudrate, cs_data->cfg,
+		(flags & (0x3 << 2)) == PI_SPI_LINES_QUAD);
+
+	/* started now if no transfer is ongoing, queued otherwise */
+	struct spim_transfer transfer;
+	transfer.data = data;
+	transfer.flags = flags;
+	transfer.len = len;
+	transfer.is_send = 1;
+	transfer.ucode = NULL;
+	transfer.addr = 0;
+	__pi_spim_transfer_enqueue(cs_data, &transfer, task);
+}
 
-		/* send data stream with 32-bit data size */
-		spim_enqueue_channel(SPIM(device_id), (uint32_t)data,
-				     (uint32_t)buffer_size, tx_conf, TX_CHANNEL);
-	} else { /* a transfer is running, append to pending transfers queue */
-		struct spim_transfer transfer;
-		transfer.data = data;
-		transfer.flags = flags;
-		transfer.len = len;
-		transfer.cfg_cmd = cfg;
-		transfer.byte_align = byte_align;
-		transfer.is_send = 1;
-		__pi_spim_drv_fifo_enqueue(cs_data, &transfer, task);
-	}
-	__restore_irq(irq);
+static void __pi_spi_xfer_exec(struct spim_cs_data *cs_data, void *tx_data,
+			       void *rx_data, size_t len, pi_spi_flags_e flags,
+			       pi_task_t *task)
+{
+	__pi_spim_chunks_start(cs_data, tx_data, rx_data, len, flags, task);
 }
 
 void __pi_spi_xfer_async(struct spim_cs_data *cs_data, void *tx_data,
 			 void *rx_data, size_t len, pi_spi_flags_e flags,
 			 pi_task_t *task)
 {
-	/* TODO: port spi_xfer async */
-	abort();
-#if 0
-    struct spim_driver_data *drv_data = SPIM_CS_DATA_GET_DRV_DATA(cs_data);
-    int qspi    = (flags & (0x3 << 2)) == PI_SPI_LINES_QUAD;
-    int cs_mode = (flags >> 0) & 0x3;
-
-    int device_id = drv_data->device_id;
-    uint32_t cfg = cs_data->cfg;
-    DBG_PRINTF("%s:%d: core clock:%"PRIu32", baudrate:%"PRIu32", div=%"PRIu32", udma_cmd cfg =%d\n",
-            __func__,__LINE__,system_core_clock_get(),cs_data->max_baudrate,
-            system_core_clock_get() / cs_data->max_baudrate,cfg);
-    uint32_t byte_align = (cs_data->wordsize == PI_SPI_WORDSIZE_32)
-        && cs_data->big_endian;
-    int size = (len + 7) >> 3;
-
-    int cmd_id = 0;
-
-    uint32_t irq = __disable_irq();
-    if(!drv_data->end_of_transfer)
-    {
-        cs_data->udma_cmd[0] = cfg;
-        cs_data->udma_cmd[1] = SPI_CMD_SOT(cs_data->cs);
-        cs_data->udma_cmd[2] = SPI_CMD_FULL_DUPL(len, byte_align);
-        drv_data->end_of_transfer = task;
-        drv_data->repeat_transfer = NULL;
-        if(cs_mode == PI_SPI_CS_AUTO)
-        {
-            spim_enqueue_channel(SPIM(device_id), (uint32_t)cs_data->udma_cmd,
-                    3*(sizeof(uint32_t)), UDMA_CORE_TX_CFG_EN(1),
-                    TX_CHANNEL);
-            spim_enqueue_channel(SPIM(device_id), (uint32_t)rx_data, size,
-                    UDMA_CORE_RX_CFG_EN(1) | (2<<1), RX_CHANNEL);
-            spim_enqueue_channel(SPIM(device_id), (uint32_t)tx_data,
-                    size, UDMA_CORE_TX_CFG_EN(1),
-                    TX_CHANNEL);
-            // wait until TX channel is free
-            while((hal_read32((void*)&(SPIM(device_id)->udma.tx_cfg))
-                        & (1<<5))>>5)
-            {
-                DBG_PRINTF("%s:%d\n",__func__,__LINE__);
-            }
-            // send EOT
-            cs_data->udma_cmd[3] = SPI_CMD_EOT(1);
-            spim_enqueue_channel(SPIM(device_id),
-                    (uint32_t)&cs_data->udma_cmd[3], sizeof(uint32_t),
-                    UDMA_CORE_TX_CFG_EN(1), TX_CHANNEL);
-        }
-        else
-        {
-            spim_enqueue_channel(SPIM(device_id), (uint32_t)cs_data->udma_cmd,
-                    3*(sizeof(uint32_t)), UDMA_CORE_TX_CFG_EN(1),
-                    TX_CHANNEL);
-            // wait until TX channel is free
-            while((hal_read32((void*)&(SPIM(device_id)->udma.tx_cfg))
-                        & (1<<5))>>5)
-            {
-                DBG_PRINTF("%s:%d\n",__func__,__LINE__);
-            }
-            // activate rx event
-            hal_soc_eu_set_fc_mask(SOC_EVENT_UDMA_SPIM_RX(device_id));
-            // NOTE: both transfers have the same size
-            // does not matter which one we wait
-            spim_enqueue_channel(SPIM(device_id), (uint32_t)rx_data, size,
-                    UDMA_CORE_RX_CFG_EN(1) | (2<<1), RX_CHANNEL);
-            spim_enqueue_channel(SPIM(device_id), (uint32_t)tx_data,
-                    size, UDMA_CORE_TX_CFG_EN(1),
-                    TX_CHANNEL);
-        }
-
-    }
-    else
-    {
-        struct spim_transfer transfer;
-        transfer.data = rx_data;
-        transfer.flags = flags;
-        transfer.len = len;
-        transfer.cfg_cmd = cfg;
-        transfer.byte_align = byte_align;
-        transfer.is_send = (uint32_t) tx_data; // sending a pointer means xfer
-        __pi_spim_drv_fifo_enqueue(cs_data, &transfer, task);
-    }
-    restore_irq(irq);
-#endif
+	DBG_PRINTF(
+		"%s:%d: core clock:%"PRIu32", baudrate:%"PRIu32", div=%"PRIu32", udma_cmd cfg =%lx\n",
+		__func__, __LINE__, system_core_clock_get(),
+		cs_data->max_baudrate,
+		system_core_clock_get() / cs_data->max_baudrate, cs_data->cfg);
+
+	/* started now if no transfer is ongoing, queued otherwise */
+	struct spim_transfer transfer;
+	transfer.data = rx_data;
+	transfer.flags = flags;
+	transfer.len = len;
+	transfer.is_send = (uint32_t)tx_data; // sending a pointer means xfer
+	transfer.ucode = NULL;
+	transfer.addr = 0;
+	__pi_spim_transfer_enqueue(cs_data, &transfer, task);
+}
+
+int pi_spi_batch_init(pi_spi_batch_t *batch, pi_spi_batch_req_t *reqs,
+		      int nb_reqs)
+{
+	struct spim_driver_data *drv_data = NULL;
+	struct spim_cs_data *prev = NULL;
+	uint32_t nb_cmd = 0, tx_size = 0, rx_size = 0;
+
+	if (nb_reqs <= 0) {
+		return -1;
+	}
+	for (int i = 0; i < nb_reqs; i++) {
+		struct spim_cs_data *cs_data = reqs[i].device->data;
+		uint32_t size = reqs[i].len >> 3;
+		if (drv_data == NULL) {
+			drv_data = cs_data->drv_data;
+		}
+		if ((cs_data->drv_data != drv_data) || (reqs[i].len & 7) ||
+		    (size > SPIM_BATCH_MAX_LEN) ||
+		    (((reqs[i].flags & (0x3 << 2)) == PI_SPI_LINES_QUAD) &&
+		     (reqs[i].tx_data != NULL) && (reqs[i].rx_data != NULL)) ||
+		    ((size != 0) && (reqs[i].tx_data == NULL) &&
+		     (reqs[i].rx_data == NULL))) {
+			DBG_PRINTF("[%s] invalid request %d\n", __func__, i);
+			return -1;
+		}
+		/* cfg, SOT, data, EOT */
+		nb_cmd += (cs_data != prev) + 2 + (size != 0);
+		prev = cs_data;
+		if (reqs[i].tx_data != NULL) {
+			tx_size += size;
+		}
+		if (reqs[i].rx_data != NULL) {
+			rx_size += size;
+		}
+	}
+	if ((tx_size > UDMA_MAX_SIZE) || (rx_size > UDMA_MAX_SIZE)) {
+		return -1;
+	}
+
+	/* command stream and data buffers are read by the uDMA */
+	uint32_t cmd_size = nb_cmd * sizeof(uint32_t);
+	uint32_t *cmd = pi_data_malloc(cmd_size + tx_size + rx_size);
+	if (cmd == NULL) {
+		return -1;
+	}
+	batch->reqs = reqs;
+	batch->nb_reqs = nb_reqs;
+	batch->drv_data = drv_data;
+	batch->cmd = cmd;
+	batch->cmd_size = cmd_size;
+	batch->tx_buf = (uint8_t *)cmd + cmd_size;
+	batch->tx_size = tx_size;
+	batch->rx_buf = batch->tx_buf + tx_size;
+	batch->rx_size = rx_size;
+
+	prev = NULL;
+	for (int i = 0; i < nb_reqs; i++) {
+		pi_spi_batch_req_t *req = &reqs[i];
+		struct spim_cs_data *cs_data = req->device->data;
+		uint32_t size = req->len >> 3;
+		uint32_t qspi = (req->flags & (0x3 << 2)) == PI_SPI_LINES_QUAD;
+		uint32_t cs_keep = (req->flags & 0x3) == PI_SPI_CS_KEEP;
+		if (cs_data != prev) {
+			*cmd++ = cs_data->cfg;
+		}
+		prev = cs_data;
+		*cmd++ = SPI_CMD_SOT((uint32_t)cs_data->cs);
+		if ((size != 0) && (req->tx_data != NULL) &&
+		    (req->rx_data != NULL)) {
+			*cmd++ = SPI_CMD_FUL(size, SPI_CMD_1_WORD_PER_TRANSF, 8,
+					     SPI_CMD_MSB_FIRST);
+		} else if ((size != 0) && (req->tx_data != NULL)) {
+			*cmd++ = SPI_CMD_TX_DATA(size, SPI_CMD_1_WORD_PER_TRANSF,
+						 8, qspi, SPI_CMD_MSB_FIRST);
+		} else if (size != 0) {
+			*cmd++ = SPI_CMD_RX_DATA(size, SPI_CMD_1_WORD_PER_TRANSF,
+						 8, qspi, SPI_CMD_MSB_FIRST);
+		}
+		/* only the last transfer raises the end of transfer event */
+		*cmd++ = SPI_CMD_EOT((uint32_t)(i == nb_reqs - 1), cs_keep);
+	}
+	return 0;
+}
+
+void pi_spi_batch_deinit(pi_spi_batch_t *batch)
+{
+	pi_data_free(batch->cmd,
+		     batch->cmd_size + batch->tx_size + batch->rx_size);
+	batch->cmd = NULL;
+}
+
+/* Start a batch, the caller owns the interface. */
+static void __pi_spi_batch_exec(pi_spi_batch_t *batch, pi_task_t *task)
+{
+	struct spim_driver_data *drv_data = batch->drv_data;
+	struct spim_chunks *chunks = &drv_data->chunks;
+	int device_id = drv_data->device_id;
+	uint32_t conf = UDMA_CORE_TX_CFG_EN(1) |
+			UDMA_CORE_TX_CFG_DATASIZE(UDMA_CORE_CFG_DATASIZE_8);
+
+	/* gather the data to send */
+	uint8_t *tx = batch->tx_buf;
+	for (int i = 0; i < batch->nb_reqs; i++) {
+		pi_spi_batch_req_t *req = &batch->reqs[i];
+		if (req->tx_data != NULL) {
+			memcpy(tx, req->tx_data, req->len >> 3);
+			tx += req->len >> 3;
+		}
+	}
+
+	/* a single chunk as far as the end of transfer handler is concerned */
+	chunks->left = 0;
+	chunks->inflight = 1;
+	chunks->first = 0;
+	chunks->ucode = NULL;
+	drv_data->batch = batch;
+	drv_data->end_of_transfer = task;
+
+	if (batch->rx_size != 0) {
+		spim_enqueue_channel(SPIM(device_id), (uint32_t)batch->rx_buf,
+				     batch->rx_size, conf, RX_CHANNEL);
+	}
+	spim_enqueue_channel(
+		SPIM(device_id), (uint32_t)batch->cmd, batch->cmd_size,
+		UDMA_CORE_TX_CFG_EN(1) |
+			UDMA_CORE_TX_CFG_DATASIZE(UDMA_CORE_CFG_DATASIZE_32),
+		COMMAND_CHANNEL);
+	if (batch->tx_size != 0) {
+		spim_enqueue_channel(SPIM(device_id), (uint32_t)batch->tx_buf,
+				     batch->tx_size, conf, TX_CHANNEL);
+	}
+}
+
+void pi_spi_batch_async(pi_spi_batch_t *batch, pi_task_t *task)
+{
+	struct spim_transfer transfer;
+	transfer.data = batch;
+	transfer.flags = 0;
+	transfer.len = 0;
+	transfer.is_send = SPIM_TRANSFER_BATCH;
+	transfer.ucode = NULL;
+	transfer.addr = 0;
+	__pi_spim_transfer_enqueue(batch->reqs[0].device->data, &transfer,
+				   task);
+}
+
+void pi_spi_batch(pi_spi_batch_t *batch)
+{
+	pi_task_t task_block;
+	pi_task_block(&task_block);
+	pi_spi_batch_async(batch, &task_block);
+	pi_task_wait_on(&task_block);
+	pi_task_destroy(&task_block);
 }
 
 int pi_spi_open(struct pi_device *device)
@@ -713,17 +977,15 @@ int pi_spi_open(struct pi_device *device)
 	/* TODO: hacked */
 	int status = 0;
 	struct spim_cs_data **cs_data = (struct spim_cs_data **)(&device->data);
+	if ((conf->cs < 0) || (conf->cs >= SPIM_NB_CS)) {
+		DBG_PRINTF("[%s] invalid cs %d\n", __func__, conf->cs);
+		restore_irq(irq);
+		return -1;
+	}
 	/* struct pi_spi_conf *conf = conf; */
 	/* TODO: paste beg */
 	// disable clock gating for said device
 	udma_ctrl_cg_disable(UDMA_SPIM_ID((uint32_t)conf->itf));
-	hal_soc_eu_set_fc_mask(SOC_EVENT_UDMA_SPIM_EOT((int)conf->itf));
-	pi_fc_event_handler_set((uint32_t)SOC_EVENT_UDMA_SPIM_EOT((int)conf->itf),
-				spim_eot_handler);
-	pi_fc_event_handler_set((uint32_t)SOC_EVENT_UDMA_SPIM_TX((int)conf->itf),
-				spim_tx_handler);
-	pi_fc_event_handler_set((uint32_t)SOC_EVENT_UDMA_SPIM_RX((int)conf->itf),
-				spim_rx_handler);
 
 	// Take care of driver data
 	struct spim_driver_data *drv_data;
@@ -735,14 +997,19 @@ int pi_spi_open(struct pi_device *device)
 		memset(__g_spim_drv_data[conf->itf], 0,
 		       sizeof(struct spim_driver_data));
 		drv_data = __g_spim_drv_data[conf->itf];
-		drv_data->drv_fifo =
-			pi_default_malloc(sizeof(struct spim_drv_fifo));
-		memset(drv_data->drv_fifo, 0, sizeof(struct spim_drv_fifo));
-		if (!drv_data->drv_fifo) {
-			restore_irq(irq);
-			return -1;
-		}
+		udma_queue_init(&drv_data->queue);
 		drv_data->device_id = (uint8_t)conf->itf;
+		/* handlers get the driver data */
+		pi_fc_event_handler_set(
+			(uint32_t)SOC_EVENT_UDMA_SPIM_EOT((int)conf->itf),
+			spim_eot_handler, drv_data);
+		pi_fc_event_handler_set(
+			(uint32_t)SOC_EVENT_UDMA_SPIM_TX((int)conf->itf),
+			spim_tx_handler, drv_data);
+		pi_fc_event_handler_set(
+			(uint32_t)SOC_EVENT_UDMA_SPIM_RX((int)conf->itf),
+			spim_rx_handler, drv_data);
+		hal_soc_eu_set_fc_mask(SOC_EVENT_UDMA_SPIM_EOT((int)conf->itf));
 	}
 	drv_data->nb_open++;
 
@@ -774,6 +1041,12 @@ int pi_spi_open(struct pi_device *device)
 		_cs_data->cs = (uint8_t)conf->cs;
 		_cs_data->cfg = SPI_CMD_CFG(clk_div, _cs_data->phase,
 					    _cs_data->polarity);
+		/* header of both command streams */
+		for (int i = 0; i < 2; i++) {
+			_cs_data->udma_cmd[4 * i] = _cs_data->cfg;
+			_cs_data->udma_cmd[4 * i + 1] =
+				SPI_CMD_SOT((uint32_t)_cs_data->cs);
+		}
 		*cs_data = _cs_data;
 		__pi_spim_cs_data_add(drv_data, _cs_data);
 	}
@@ -792,6 +1065,8 @@ void pi_spi_close(struct pi_device *device)
 	struct spim_cs_data *cs_data = device->data;
 	struct spim_driver_data *drv_data = cs_data->drv_data;
 	__pi_spim_cs_data_del(drv_data, cs_data->cs);
+	__pi_spim_ucode_free(cs_data, SPIM_UCODE_RX);
+	__pi_spim_ucode_free(cs_data, SPIM_UCODE_TX);
 	drv_data->nb_open--;
 	if (drv_data->nb_open == 0) {
 		/* reactivate clock gating for said device */
@@ -799,8 +1074,11 @@ void pi_spi_close(struct pi_device *device)
 		hal_soc_eu_clear_fc_mask(SOC_EVENT_UDMA_SPIM_EOT((int)drv_data->device_id));
 		pi_fc_event_handler_clear((uint32_t)
 			SOC_EVENT_UDMA_SPIM_EOT((int)drv_data->device_id));
+		pi_fc_event_handler_clear((uint32_t)
+			SOC_EVENT_UDMA_SPIM_TX((int)drv_data->device_id));
+		pi_fc_event_handler_clear((uint32_t)
+			SOC_EVENT_UDMA_SPIM_RX((int)drv_data->device_id));
 		__g_spim_drv_data[drv_data->device_id] = NULL;
-		pi_default_free(drv_data->drv_fifo, sizeof(drv_data->drv_fifo));
 		pi_default_free(drv_data, sizeof(drv_data));
 
 		restore_irq(irq);
@@ -890,7 +1168,6 @@ uint32_t pi_spi_get_config(struct pi_device *device)
 void pi_spi_transfer(struct pi_device *device, void *tx_data, void *rx_data,
 		     size_t len, pi_spi_flags_e flag)
 {
-	/* TODO */
 	pi_task_t task_block;
 	pi_task_block(&task_block);
 	DEBUG_PRINTF("%s:%d\n", __func__, __LINE__);
@@ -906,6 +1183,57 @@ void pi_spi_transfer_async(struct pi_device *device, void *tx_data,
 			   void *rx_data, size_t len, pi_spi_flags_e flag,
 			   pi_task_t *task)
 {
-	/* TODO */
 	__pi_spi_xfer_async(device->data, tx_data, rx_data, len, flag, task);
 }
+
+void *pi_spi_receive_ucode_set(struct pi_device *device, uint8_t *ucode,
+			       uint32_t ucode_size)
+{
+	uint32_t irq = __disable_irq();
+	void *prog = __pi_spim_ucode_set(device->data, SPIM_UCODE_RX, ucode,
+					 ucode_size);
+	restore_irq(irq);
+	return prog;
+}
+
+void pi_spi_receive_ucode_set_addr_info(struct pi_device *device,
+					uint8_t *ucode, uint32_t ucode_size)
+{
+	__pi_spim_ucode_set_addr_info(device->data, SPIM_UCODE_RX, ucode,
+				      ucode_size);
+}
+
+void *pi_spi_send_ucode_set(struct pi_device *device, uint8_t *ucode,
+			    uint32_t ucode_size)
+{
+	uint32_t irq = __disable_irq();
+	void *prog = __pi_spim_ucode_set(device->data, SPIM_UCODE_TX, ucode,
+					 ucode_size);
+	restore_irq(irq);
+	return prog;
+}
+
+void pi_spi_send_ucode_set_addr_info(struct pi_device *device, uint8_t *ucode,
+				     uint32_t ucode_size)
+{
+	__pi_spim_ucode_set_addr_info(device->data, SPIM_UCODE_TX, ucode,
+				      ucode_size);
+}
+
+void pi_spi_copy(struct pi_device *device, uint32_t addr, void *data,
+		 uint32_t size, pi_spi_flags_e flags)
+{
+	pi_task_t task_block;
+	pi_task_block(&task_block);
+	pi_spi_copy_async(device, addr, data, size, flags, &task_block);
+	pi_task_wait_on(&task_block);
+	pi_task_destroy(&task_block);
+}
+
+void pi_spi_copy_async(struct pi_device *device, uint32_t addr, void *data,
+		       uint32_t size, pi_spi_flags_e flags, pi_task_t *task)
+{
+	int dir = (flags & PI_SPI_COPY_EXT2LOC) ? SPIM_UCODE_RX : SPIM_UCODE_TX;
+	__pi_spim_program_enqueue(device->data, data, size * 8, flags, dir,
+				  addr, task);
+}
@@ -0,0 +1,688 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * SPI NOR flash
+ *
+ * Reads use a precompiled SPI program (fast read, address, dummy cycles)
+ * replayed by pi_spi_copy(), so a read is a single uDMA transaction and large
+ * reads are split by the SPI driver. The short commands (write enable, status,
+ * program, erase) are SPI batches compiled at open.
+ *
+ * Program and erase hold the device lock while the flash is busy and sleep
+ * between status polls. The asynchronous variants are run by a worker task,
+ * close completes the ones still queued with an error.
+ *
+ * Reads into buffers the uDMA cannot reach directly (unaligned or outside L2)
+ * go through the cache lines, or a word aligned L2 bounce buffer without a
+ * cache.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "pmsis_types.h"
+#include "pmsis_task.h"
+#include "implementation_specific_defines.h"
+#include "device.h"
+#include "spi.h"
+#include "spiflash.h"
+#include "udma_bounce.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#ifdef DEBUG
+#define DBG_PRINTF printf
+#else
+#define DBG_PRINTF(...) ((void)0)
+#endif /* DEBUG */
+
+/* Standard SPI NOR commands */
+#define SPIFLASH_CMD_WREN	0x06 /* write enable */
+#define SPIFLASH_CMD_RDSR	0x05 /* read status register */
+#define SPIFLASH_CMD_RDID	0x9F /* read JEDEC ID */
+#define SPIFLASH_CMD_PP		0x02 /* page program */
+#define SPIFLASH_CMD_SE		0x20 /* 4 KiB sector erase */
+#define SPIFLASH_CMD_FAST_READ	0x0B /* single line, 8 dummy cycles */
+#define SPIFLASH_CMD_QUAD_READ	0x6B /* quad output, 8 dummy cycles */
+
+#define SPIFLASH_SR_WIP 0x01 /* write in progress */
+
+#define SPIFLASH_PAGE_SIZE   256
+#define SPIFLASH_SECTOR_SIZE 4096
+#define SPIFLASH_ADDR_SIZE   3 /* bytes */
+
+#ifndef SPIFLASH_WORKER_PRIORITY
+#define SPIFLASH_WORKER_PRIORITY (tskIDLE_PRIORITY + 1)
+#endif
+
+#ifndef SPIFLASH_QUEUE_DEPTH
+#define SPIFLASH_QUEUE_DEPTH 4
+#endif
+
+/* the worker runs program and erase, down to the SPI batches */
+#ifndef SPIFLASH_WORKER_STACK_SIZE
+#define SPIFLASH_WORKER_STACK_SIZE (2 * configMINIMAL_STACK_SIZE)
+#endif
+
+#define SPIFLASH_BOUNCE_SIZE 64 /* bytes, reads without a cache */
+
+/* Operations of the worker task, in task->data[0]. */
+#define SPIFLASH_OP_PROGRAM 0
+#define SPIFLASH_OP_ERASE   1
+
+#define SPIFLASH_LINE_INVALID 0
+#define SPIFLASH_LINE_VALID   1
+#define SPIFLASH_LINE_FILLING 2 /* read ahead in progress */
+
+struct spiflash_line {
+	uint32_t addr;
+	uint32_t stamp; /* last use, for LRU replacement */
+	uint8_t state;
+	uint8_t *data;
+	pi_task_t task; /* read ahead */
+};
+
+struct spiflash {
+	struct pi_device spi;
+	struct pi_spiflash_info info;
+	uint32_t read_flags;
+	SemaphoreHandle_t lock;
+	QueueHandle_t queue;
+	TaskHandle_t worker;
+
+	/* command batches */
+	pi_spi_batch_req_t wren_req[1];
+	pi_spi_batch_req_t rdsr_req[2];
+	pi_spi_batch_req_t se_req[1];
+	pi_spi_batch_req_t pp_req[2];
+	pi_spi_batch_t wren;
+	pi_spi_batch_t rdsr;
+	pi_spi_batch_t se;
+	pi_spi_batch_t pp;
+	uint8_t cmd_wren;
+	uint8_t cmd_rdsr;
+	uint8_t sr;
+	uint8_t se_hdr[1 + SPIFLASH_ADDR_SIZE];
+	uint8_t pp_hdr[1 + SPIFLASH_ADDR_SIZE];
+	uint8_t page[SPIFLASH_PAGE_SIZE];
+	uint32_t *bounce; /* L2, for reads without a cache */
+
+	/* read cache */
+	struct spiflash_line *lines;
+	uint8_t *cache;
+	uint32_t nb_lines;
+	uint32_t line_size;
+	uint32_t clock;
+	uint32_t last_line; /* address of the last line read */
+};
+
+static inline void __spiflash_hdr(uint8_t *hdr, uint8_t cmd, uint32_t addr)
+{
+	hdr[0] = cmd;
+	hdr[1] = (uint8_t)(addr >> 16);
+	hdr[2] = (uint8_t)(addr >> 8);
+	hdr[3] = (uint8_t)addr;
+}
+
+static inline void __spiflash_req(pi_spi_batch_req_t *req,
+				  struct spiflash *flash, void *tx, void *rx,
+				  size_t len, pi_spi_flags_e flags)
+{
+	req->device = &flash->spi;
+	req->tx_data = tx;
+	req->rx_data = rx;
+	req->len = len;
+	req->flags = flags;
+}
+
+static int __spiflash_batches_init(struct spiflash *flash)
+{
+	flash->cmd_wren = SPIFLASH_CMD_WREN;
+	flash->cmd_rdsr = SPIFLASH_CMD_RDSR;
+	__spiflash_req(&flash->wren_req[0], flash, &flash->cmd_wren, NULL, 8,
+		       PI_SPI_CS_AUTO);
+	__spiflash_req(&flash->rdsr_req[0], flash, &flash->cmd_rdsr, NULL, 8,
+		       PI_SPI_CS_KEEP);
+	__spiflash_req(&flash->rdsr_req[1], flash, NULL, &flash->sr, 8,
+		       PI_SPI_CS_AUTO);
+	__spiflash_req(&flash->se_req[0], flash, flash->se_hdr, NULL,
+		       8 * sizeof(flash->se_hdr), PI_SPI_CS_AUTO);
+	/* whole pages, bytes outside the range are programmed to 0xFF which
+	 * leaves them unchanged */
+	__spiflash_req(&flash->pp_req[0], flash, flash->pp_hdr, NULL,
+		       8 * sizeof(flash->pp_hdr), PI_SPI_CS_KEEP);
+	__spiflash_req(&flash->pp_req[1], flash, flash->page, NULL,
+		       8 * SPIFLASH_PAGE_SIZE, PI_SPI_CS_AUTO);
+
+	if (pi_spi_batch_init(&flash->wren, flash->wren_req, 1) ||
+	    pi_spi_batch_init(&flash->rdsr, flash->rdsr_req, 2) ||
+	    pi_spi_batch_init(&flash->se, flash->se_req, 1) ||
+	    pi_spi_batch_init(&flash->pp, flash->pp_req, 2)) {
+		return -1;
+	}
+	return 0;
+}
+
+static void __spiflash_batches_deinit(struct spiflash *flash)
+{
+	if (flash->wren.cmd != NULL) {
+		pi_spi_batch_deinit(&flash->wren);
+	}
+	if (flash->rdsr.cmd != NULL) {
+		pi_spi_batch_deinit(&flash->rdsr);
+	}
+	if (flash->se.cmd != NULL) {
+		pi_spi_batch_deinit(&flash->se);
+	}
+	if (flash->pp.cmd != NULL) {
+		pi_spi_batch_deinit(&flash->pp);
+	}
+}
+
+static int __spiflash_probe(struct spiflash *flash)
+{
+	uint8_t cmd = SPIFLASH_CMD_RDID;
+	pi_spi_batch_req_t req[2];
+	pi_spi_batch_t rdid;
+
+	__spiflash_req(&req[0], flash, &cmd, NULL, 8, PI_SPI_CS_KEEP);
+	__spiflash_req(&req[1], flash, NULL, flash->info.jedec_id, 24,
+		       PI_SPI_CS_AUTO);
+	if (pi_spi_batch_init(&rdid, req, 2)) {
+		return -1;
+	}
+	pi_spi_batch(&rdid);
+	pi_spi_batch_deinit(&rdid);
+
+	uint8_t *id = flash->info.jedec_id;
+	DBG_PRINTF("[%s] jedec id %02x %02x %02x\n", __func__, id[0], id[1],
+		   id[2]);
+	/* no device answers all zeros or all ones */
+	if ((id[0] == 0x00) || (id[0] == 0xFF) || (id[2] < 0x10) ||
+	    (id[2] > 0x18)) {
+		return -1;
+	}
+	/* 3 bytes addresses, up to 16 MiB */
+	flash->info.size = 1u << id[2];
+	flash->info.sector_size = SPIFLASH_SECTOR_SIZE;
+	flash->info.page_size = SPIFLASH_PAGE_SIZE;
+	return 0;
+}
+
+static int __spiflash_read_prog_init(struct spiflash *flash, int quad)
+{
+	uint32_t ucode[4];
+	ucode[0] = SPI_UCODE_CMD_SEND_CMD(quad ? SPIFLASH_CMD_QUAD_READ :
+						 SPIFLASH_CMD_FAST_READ,
+					  8, 0);
+	ucode[1] = SPI_UCODE_CMD_SEND_ADDR(8 * SPIFLASH_ADDR_SIZE, 0);
+	ucode[2] = 0; /* address */
+	ucode[3] = SPI_UCODE_CMD_DUMMY(8);
+	uint32_t *prog = pi_spi_receive_ucode_set(&flash->spi,
+						  (uint8_t *)ucode,
+						  sizeof(ucode));
+	if (prog == NULL) {
+		return -1;
+	}
+	pi_spi_receive_ucode_set_addr_info(&flash->spi, (uint8_t *)&prog[2],
+					   SPIFLASH_ADDR_SIZE);
+	flash->read_flags = PI_SPI_COPY_EXT2LOC | PI_SPI_CS_AUTO |
+			    (quad ? PI_SPI_LINES_QUAD : PI_SPI_LINES_SINGLE);
+	return 0;
+}
+
+static void __spiflash_wait_ready(struct spiflash *flash)
+{
+	for (;;) {
+		pi_spi_batch(&flash->rdsr);
+		if (!(flash->sr & SPIFLASH_SR_WIP)) {
+			break;
+		}
+		/* let the other tasks run while the flash is busy */
+		vTaskDelay(1);
+	}
+}
+
+/* Read cache, called with the lock held */
+
+static void __spiflash_line_wait(struct spiflash_line *line)
+{
+	if (line->state == SPIFLASH_LINE_FILLING) {
+		pi_task_wait_on(&line->task);
+		pi_task_destroy(&line->task);
+		line->state = SPIFLASH_LINE_VALID;
+	}
+}
+
+static struct spiflash_line *__spiflash_line_find(struct spiflash *flash,
+						  uint32_t addr)
+{
+	for (uint32_t i = 0; i < flash->nb_lines; i++) {
+		struct spiflash_line *line = &flash->lines[i];
+		if ((line->state != SPIFLASH_LINE_INVALID) &&
+		    (line->addr == addr)) {
+			return line;
+		}
+	}
+	return NULL;
+}
+
+/* Least recently used line other than keep, which may be NULL. */
+static struct spiflash_line *__spiflash_line_victim(struct spiflash *flash,
+						    struct spiflash_line *keep)
+{
+	struct spiflash_line *victim = NULL;
+	for (uint32_t i = 0; i < flash->nb_lines; i++) {
+		struct spiflash_line *line = &flash->lines[i];
+		if (line == keep) {
+			continue;
+		}
+		if (line->state == SPIFLASH_LINE_INVALID) {
+			return line;
+		}
+		if ((victim == NULL) ||
+		    ((int32_t)(line->stamp - victim->stamp) < 0)) {
+			victim = line;
+		}
+	}
+	__spiflash_line_wait(victim);
+	return victim;
+}
+
+/* Fetches the line at addr in the background, in a line other than the one
+ * just returned to the reader. */
+static void __spiflash_readahead(struct spiflash *flash, uint32_t addr,
+				 struct spiflash_line *keep)
+{
+	if ((flash->nb_lines < 2) || (addr >= flash->info.size) ||
+	    (__spiflash_line_find(flash, addr) != NULL)) {
+		return;
+	}
+	struct spiflash_line *line = __spiflash_line_victim(flash, keep);
+	line->addr = addr;
+	line->stamp = flash->clock;
+	line->state = SPIFLASH_LINE_FILLING;
+	pi_task_block(&line->task);
+	pi_spi_copy_async(&flash->spi, addr, line->data, flash->line_size,
+			  flash->read_flags, &line->task);
+}
+
+static struct spiflash_line *__spiflash_line_get(struct spiflash *flash,
+						 uint32_t addr)
+{
+	struct spiflash_line *line = __spiflash_line_find(flash, addr);
+	if (line == NULL) {
+		line = __spiflash_line_victim(flash, NULL);
+		line->addr = addr;
+		line->state = SPIFLASH_LINE_VALID;
+		pi_spi_copy(&flash->spi, addr, line->data, flash->line_size,
+			    flash->read_flags);
+	} else {
+		__spiflash_line_wait(line);
+	}
+	line->stamp = ++flash->clock;
+	/* sequential access, hit or miss, fetch the next line in the
+	 * background so streaming reads find every line prefetched */
+	if (addr == flash->last_line + flash->line_size) {
+		__spiflash_readahead(flash, addr + flash->line_size, line);
+	}
+	flash->last_line = addr;
+	return line;
+}
+
+static void __spiflash_invalidate(struct spiflash *flash, uint32_t addr,
+				  uint32_t size)
+{
+	for (uint32_t i = 0; i < flash->nb_lines; i++) {
+		struct spiflash_line *line = &flash->lines[i];
+		if ((line->state != SPIFLASH_LINE_INVALID) &&
+		    (line->addr < addr + size) &&
+		    (addr < line->addr + flash->line_size)) {
+			__spiflash_line_wait(line);
+			line->state = SPIFLASH_LINE_INVALID;
+		}
+	}
+}
+
+static int __spiflash_cache_init(struct spiflash *flash,
+				 struct pi_spiflash_conf *conf)
+{
+	uint32_t line_size = conf->cache_line_size;
+	if ((conf->cache_lines == 0) || (line_size < 4) ||
+	    (line_size & (line_size - 1))) {
+		flash->nb_lines = 0;
+		return 0;
+	}
+	flash->lines =
+		pi_default_malloc(conf->cache_lines * sizeof(*flash->lines));
+	/* read by the uDMA */
+	flash->cache = pi_data_malloc(conf->cache_lines * line_size);
+	if ((flash->lines == NULL) || (flash->cache == NULL)) {
+		return -1;
+	}
+	memset(flash->lines, 0, conf->cache_lines * sizeof(*flash->lines));
+	for (uint32_t i = 0; i < conf->cache_lines; i++) {
+		flash->lines[i].data = &flash->cache[i * line_size];
+	}
+	flash->nb_lines = conf->cache_lines;
+	flash->line_size = line_size;
+	flash->last_line = (uint32_t)-1;
+	return 0;
+}
+
+/* Operations, called with the lock held */
+
+static void __spiflash_program(struct spiflash *flash, uint32_t addr,
+			       const uint8_t *data, uint32_t size)
+{
+	while (size != 0) {
+		uint32_t page = addr & ~(SPIFLASH_PAGE_SIZE - 1);
+		uint32_t offset = addr - page;
+		uint32_t chunk = SPIFLASH_PAGE_SIZE - offset;
+		if (chunk > size) {
+			chunk = size;
+		}
+		memset(flash->page, 0xFF, SPIFLASH_PAGE_SIZE);
+		memcpy(&flash->page[offset], data, chunk);
+		__spiflash_hdr(flash->pp_hdr, SPIFLASH_CMD_PP, page);
+		pi_spi_batch(&flash->wren);
+		pi_spi_batch(&flash->pp);
+		__spiflash_wait_ready(flash);
+		__spiflash_invalidate(flash, addr, chunk);
+		addr += chunk;
+		data += chunk;
+		size -= chunk;
+	}
+}
+
+static void __spiflash_erase_sector(struct spiflash *flash, uint32_t addr)
+{
+	__spiflash_hdr(flash->se_hdr, SPIFLASH_CMD_SE, addr);
+	pi_spi_batch(&flash->wren);
+	pi_spi_batch(&flash->se);
+	__spiflash_wait_ready(flash);
+	__spiflash_invalidate(flash, addr, SPIFLASH_SECTOR_SIZE);
+}
+
+static void __spiflash_task_end(pi_task_t *task, int32_t status)
+{
+	pi_task_status_set(task, status);
+	if (task->id == PI_TASK_NONE_ID) {
+		pi_task_release(task);
+	} else if (task->id == PI_TASK_CALLBACK_ID) {
+		pi_task_push(task);
+	}
+}
+
+static void __spiflash_worker(void *arg)
+{
+	struct spiflash *flash = arg;
+	pi_task_t *task;
+	for (;;) {
+		/* the task stays queued until it is done, so that close sees
+		 * every task which has not been completed */
+		xQueuePeek(flash->queue, &task, portMAX_DELAY);
+		xSemaphoreTake(flash->lock, portMAX_DELAY);
+		if (task->data[0] == SPIFLASH_OP_PROGRAM) {
+			__spiflash_program(flash, task->data[1],
+					   (const uint8_t *)task->data[2],
+					   task->data[3]);
+		} else {
+			__spiflash_erase_sector(flash, task->data[1]);
+		}
+		xQueueReceive(flash->queue, &task, 0);
+		__spiflash_task_end(task, 0);
+		xSemaphoreGive(flash->lock);
+	}
+}
+
+/* Reads straight from the flash, without the cache. */
+static void __spiflash_read_direct(struct spiflash *flash, uint32_t addr,
+				   uint8_t *dst, uint32_t size)
+{
+	/* the SPI transfers whole words to a word aligned L2 buffer */
+	if (!((uintptr_t)dst & 3) && udma_bounce_is_l2((uint32_t)dst)) {
+		uint32_t direct = size & ~3u;
+		if (direct != 0) {
+			pi_spi_copy(&flash->spi, addr, dst, direct,
+				    flash->read_flags);
+			addr += direct;
+			dst += direct;
+			size -= direct;
+		}
+	}
+	while (size != 0) {
+		uint32_t chunk = size;
+		if (chunk > SPIFLASH_BOUNCE_SIZE) {
+			chunk = SPIFLASH_BOUNCE_SIZE;
+		}
+		pi_spi_copy(&flash->spi, addr, flash->bounce, (chunk + 3) & ~3u,
+			    flash->read_flags);
+		memcpy(dst, flash->bounce, chunk);
+		addr += chunk;
+		dst += chunk;
+		size -= chunk;
+	}
+}
+
+static inline int __spiflash_range_check(struct spiflash *flash,
+					 uint32_t addr, uint32_t size)
+{
+	return (addr > flash->info.size) || (size > flash->info.size - addr);
+}
+
+static void __spiflash_free(struct spiflash *flash)
+{
+	if (flash->worker != NULL) {
+		vTaskDelete(flash->worker);
+	}
+	if (flash->queue != NULL) {
+		vQueueDelete(flash->queue);
+	}
+	if (flash->lock != NULL) {
+		vSemaphoreDelete(flash->lock);
+	}
+	__spiflash_batches_deinit(flash);
+	if (flash->bounce != NULL) {
+		pi_data_free(flash->bounce, SPIFLASH_BOUNCE_SIZE);
+	}
+	if (flash->cache != NULL) {
+		pi_data_free(flash->cache, flash->nb_lines * flash->line_size);
+	}
+	if (flash->lines != NULL) {
+		pi_default_free(flash->lines,
+				flash->nb_lines * sizeof(*flash->lines));
+	}
+	pi_default_free(flash, sizeof(*flash));
+}
+
+void pi_spiflash_conf_init(struct pi_spiflash_conf *conf)
+{
+	pi_spi_conf_init(&conf->spi);
+	conf->spi.cs = 0;
+	conf->spi.max_baudrate = 50000000;
+	conf->quad = 1;
+	conf->cache_lines = 4;
+	conf->cache_line_size = 256;
+}
+
+int pi_spiflash_open(struct pi_device *device)
+{
+	struct pi_spiflash_conf *conf = (struct pi_spiflash_conf *)device->config;
+	struct spiflash *flash = pi_default_malloc(sizeof(struct spiflash));
+	if (flash == NULL) {
+		return -1;
+	}
+	memset(flash, 0, sizeof(struct spiflash));
+
+	pi_open_from_conf(&flash->spi, &conf->spi);
+	if (pi_spi_open(&flash->spi)) {
+		pi_default_free(flash, sizeof(*flash));
+		return -1;
+	}
+	if (__spiflash_batches_init(flash) || __spiflash_probe(flash) ||
+	    __spiflash_read_prog_init(flash, conf->quad) ||
+	    __spiflash_cache_init(flash, conf)) {
+		DBG_PRINTF("[%s] flash init failed\n", __func__);
+		goto error;
+	}
+
+	flash->bounce = pi_data_malloc(SPIFLASH_BOUNCE_SIZE);
+	flash->lock = xSemaphoreCreateMutex();
+	flash->queue = xQueueCreate(SPIFLASH_QUEUE_DEPTH, sizeof(pi_task_t *));
+	if ((flash->bounce == NULL) || (flash->lock == NULL) ||
+	    (flash->queue == NULL) ||
+	    (xTaskCreate(__spiflash_worker, "spiflash",
+			 SPIFLASH_WORKER_STACK_SIZE, flash,
+			 SPIFLASH_WORKER_PRIORITY, &flash->worker) != pdPASS)) {
+		goto error;
+	}
+	device->data = flash;
+	return 0;
+
+error:
+	pi_spi_close(&flash->spi);
+	__spiflash_free(flash);
+	return -1;
+}
+
+void pi_spiflash_close(struct pi_device *device)
+{
+	struct spiflash *flash = device->data;
+	pi_task_t *task;
+	xSemaphoreTake(flash->lock, portMAX_DELAY);
+	/* the worker is idle or waits for the lock, nothing ran of the
+	 * operations still queued */
+	vTaskDelete(flash->worker);
+	flash->worker = NULL;
+	while (xQueueReceive(flash->queue, &task, 0) == pdTRUE) {
+		__spiflash_task_end(task, -1);
+	}
+	__spiflash_invalidate(flash, 0, flash->info.size);
+	xSemaphoreGive(flash->lock);
+	pi_spi_close(&flash->spi);
+	__spiflash_free(flash);
+}
+
+void pi_spiflash_info_get(struct pi_device *device,
+			  struct pi_spiflash_info *info)
+{
+	struct spiflash *flash = device->data;
+	*info = flash->info;
+}
+
+int pi_spiflash_read(struct pi_device *device, uint32_t addr, void *data,
+		     uint32_t size)
+{
+	struct spiflash *flash = device->data;
+	uint8_t *dst = data;
+	if (__spiflash_range_check(flash, addr, size)) {
+		return -1;
+	}
+
+	xSemaphoreTake(flash->lock, portMAX_DELAY);
+	if (flash->nb_lines == 0) {
+		__spiflash_read_direct(flash, addr, dst, size);
+		size = 0;
+	}
+	while (size != 0) {
+		if ((size >= 2 * flash->line_size) && !((uintptr_t)dst & 3) &&
+		    udma_bounce_is_l2((uint32_t)dst)) {
+			/* large reads bypass the cache */
+			uint32_t direct = size & ~(flash->line_size - 1);
+			__spiflash_read_direct(flash, addr, dst, direct);
+			addr += direct;
+			dst += direct;
+			size -= direct;
+			continue;
+		}
+		uint32_t line_addr = addr & ~(flash->line_size - 1);
+		uint32_t offset = addr - line_addr;
+		uint32_t chunk = flash->line_size - offset;
+		if (chunk > size) {
+			chunk = size;
+		}
+		struct spiflash_line *line = __spiflash_line_get(flash,
+								 line_addr);
+		memcpy(dst, &line->data[offset], chunk);
+		addr += chunk;
+		dst += chunk;
+		size -= chunk;
+	}
+	xSemaphoreGive(flash->lock);
+	return 0;
+}
+
+int pi_spiflash_program(struct pi_device *device, uint32_t addr,
+			const void *data, uint32_t size)
+{
+	struct spiflash *flash = device->data;
+	if (__spiflash_range_check(flash, addr, size)) {
+		return -1;
+	}
+	xSemaphoreTake(flash->lock, portMAX_DELAY);
+	__spiflash_program(flash, addr, data, size);
+	xSemaphoreGive(flash->lock);
+	return 0;
+}
+
+int pi_spiflash_erase_sector(struct pi_device *device, uint32_t addr)
+{
+	struct spiflash *flash = device->data;
+	if ((addr & (SPIFLASH_SECTOR_SIZE - 1)) || (addr >= flash->info.size)) {
+		return -1;
+	}
+	xSemaphoreTake(flash->lock, portMAX_DELAY);
+	__spiflash_erase_sector(flash, addr);
+	xSemaphoreGive(flash->lock);
+	return 0;
+}
+
+int pi_spiflash_program_async(struct pi_device *device, uint32_t addr,
+			      const void *data, uint32_t size, pi_task_t *task)
+{
+	struct spiflash *flash = device->data;
+	if (__spiflash_range_check(flash, addr, size)) {
+		return -1;
+	}
+	task->data[0] = SPIFLASH_OP_PROGRAM;
+	task->data[1] = addr;
+	task->data[2] = (uint32_t)data;
+	task->data[3] = size;
+	pi_task_status_set(task, 0);
+	xQueueSend(flash->queue, &task, portMAX_DELAY);
+	return 0;
+}
+
+int pi_spiflash_erase_sector_async(struct pi_device *device, uint32_t addr,
+				   pi_task_t *task)
+{
+	struct spiflash *flash = device->data;
+	if ((addr & (SPIFLASH_SECTOR_SIZE - 1)) || (addr >= flash->info.size)) {
+		return -1;
+	}
+	task->data[0] = SPIFLASH_OP_ERASE;
+	task->data[1] = addr;
+	pi_task_status_set(task, 0);
+	xQueueSend(flash->queue, &task, portMAX_DELAY);
+	return 0;
+}
@@ -30,10 +30,22 @@
 
 #include "timer.h"
 #include "timer_irq.h"
+#include "riscv.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define TIMER_IRQ_CFG_LO                                                       \
+	(TIMER_CFG_LO_ENABLE_MASK | TIMER_CFG_LO_CCFG_MASK |                   \
+	 TIMER_CFG_LO_IRQEN_MASK)
+
+/* timer counts per tick */
+static uint32_t timer_irq_period;
 
 int timer_irq_init(uint32_t ticks)
 {
 	/* TODO: enable soc_eu timer interrupt */
+	timer_irq_period = ticks;
 
 	/* set the interrupt interval */
 	timer_irq_set_timeout(ticks, false);
@@ -55,20 +67,85 @@ int timer_irq_init(uint32_t ticks)
 
 int timer_irq_set_timeout(uint32_t ticks, bool idle)
 {
-	(void)idle;
+	if (idle) {
+		/* Interrupt once, ticks after the start of the current period.
+		 * The counter keeps running past the compare value so that
+		 * timer_irq_clock_elapsed tells how long we were idle. */
+		writew(ticks, (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CMP_LO_OFFSET));
+		writew(TIMER_IRQ_CFG_LO,
+		       (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CFG_LO_OFFSET));
+		return 0;
+	}
 	/* fast reset, value doesn't matter */
 	writew(1, (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_RESET_LO_OFFSET));
 	writew(ticks, (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CMP_LO_OFFSET));
 	return 0;
 }
 
-/* TODO: implement */
-uint32_t timer_irq_clock_elapsed()
+int timer_irq_resume(uint32_t ticks, uint32_t elapsed)
 {
+	/* back to the periodic interrupt, elapsed counts into the period */
+	writew(elapsed, (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CNT_LO_OFFSET));
+	writew(ticks, (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CMP_LO_OFFSET));
+	writew(TIMER_IRQ_CFG_LO | TIMER_CFG_LO_MODE_MASK,
+	       (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CFG_LO_OFFSET));
 	return 0;
 }
 
+/* counts since the start of the current period */
+uint32_t timer_irq_clock_elapsed()
+{
+	return readw((uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CNT_LO_OFFSET));
+}
+
 uint32_t timer_irq_cycle_get_32()
 {
 	return readw((uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CNT_LO_OFFSET));
 }
+
+#if configUSE_TICKLESS_IDLE != 0
+/* Called by the idle task through portSUPPRESS_TICKS_AND_SLEEP with the
+ * scheduler suspended. Enable it in FreeRTOSConfig.h by setting
+ * configUSE_TICKLESS_IDLE to 2 and defining portSUPPRESS_TICKS_AND_SLEEP, see
+ * tests/tickless. */
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime)
+{
+	uint32_t period = timer_irq_period;
+
+	/* the 32-bit counter bounds the idle time */
+	if (xExpectedIdleTime > UINT32_MAX / period)
+		xExpectedIdleTime = UINT32_MAX / period;
+
+	/* MIE, a raised CLIC threshold would keep the tick from waking wfi */
+	uint32_t irq = __disable_mie();
+	if (eTaskConfirmSleepModeStatus() == eAbortSleep) {
+		__restore_mie(irq);
+		return;
+	}
+
+	/* A tick which comes in before this restarts the period and leaves its
+	 * interrupt pending, so we wake up right away. */
+	uint32_t timeout = xExpectedIdleTime * period;
+	timer_irq_set_timeout(timeout, true);
+
+	TickType_t idle = xExpectedIdleTime;
+	configPRE_SLEEP_PROCESSING(idle);
+	if (idle > 0) {
+		/* a pending interrupt wakes the core up even if they are
+		 * disabled */
+		asm volatile("wfi");
+	}
+	configPOST_SLEEP_PROCESSING(idle);
+
+	uint32_t elapsed = timer_irq_clock_elapsed();
+	timer_irq_resume(period, elapsed % period);
+
+	uint32_t ticks = elapsed / period;
+	if (elapsed >= timeout) {
+		/* the timer interrupt is pending and accounts for one tick */
+		ticks = xExpectedIdleTime - 1;
+	}
+	vTaskStepTick(ticks);
+	__restore_mie(irq);
+}
+#endif
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2021 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Run-time statistics and task switch trace, see trace.h */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "riscv.h"
+#include "hrtimer.h"
+#include "trace.h"
+
+void trace_runtime_init(void)
+{
+	hrtimer_init();
+}
+
+/* Truncating the 64-bit count wraps cleanly, the kernel only adds up the
+ * differences between two reads. */
+uint32_t trace_runtime_counter(void)
+{
+	return (uint32_t)hrtimer_get_us();
+}
+
+void trace_print_task_stats(void)
+{
+#if configUSE_TRACE_FACILITY == 1
+	UBaseType_t nb_tasks = uxTaskGetNumberOfTasks();
+	TaskStatus_t *tasks = pvPortMalloc(nb_tasks * sizeof(TaskStatus_t));
+	uint32_t total = 0;
+
+	if (tasks == NULL) {
+		printf("task stats: out of memory\n");
+		return;
+	}
+	nb_tasks = uxTaskGetSystemState(tasks, nb_tasks, &total);
+
+	printf("%-*s %10s %5s %6s\n", configMAX_TASK_NAME_LEN, "task",
+	       "run us", "cpu %", "stack");
+	for (UBaseType_t i = 0; i < nb_tasks; i++) {
+		uint32_t runtime = 0;
+		uint32_t share = 0;
+#if configGENERATE_RUN_TIME_STATS == 1
+		runtime = tasks[i].ulRunTimeCounter;
+		if (total / 100 != 0)
+			share = runtime / (total / 100);
+#endif
+		/* stack in words left at the lowest point */
+		printf("%-*s %10" PRIu32 " %5" PRIu32 " %6u\n",
+		       configMAX_TASK_NAME_LEN, tasks[i].pcTaskName, runtime,
+		       share, (unsigned)tasks[i].usStackHighWaterMark);
+	}
+	vPortFree(tasks);
+#else
+	printf("task stats: needs configUSE_TRACE_FACILITY\n");
+#endif
+}
+
+#ifdef CONFIG_TRACE
+
+struct trace_buf trace_buf;
+
+static uint32_t trace_enabled;
+static uint32_t trace_nb_tasks;
+
+static void trace_record(uint16_t type, uint16_t id)
+{
+	if (!trace_enabled)
+		return;
+
+	uint32_t irq = __disable_irq();
+	struct trace_record *rec =
+		&trace_buf.records[trace_buf.count % TRACE_NB_RECORDS];
+	rec->time = (uint32_t)hrtimer_get_cycles();
+	rec->type = type;
+	rec->id = id;
+	trace_buf.count++;
+	__restore_irq(irq);
+}
+
+void trace_start(void)
+{
+	uint32_t irq = __disable_irq();
+	trace_buf.magic = TRACE_MAGIC;
+	trace_buf.freq = hrtimer_get_freq();
+	trace_buf.nb_records = TRACE_NB_RECORDS;
+	trace_buf.nb_tasks = TRACE_NB_TASKS;
+	trace_buf.count = 0;
+	trace_enabled = 1;
+	__restore_irq(irq);
+	/* the running task */
+	trace_task_switched_in();
+}
+
+void trace_stop(void)
+{
+	trace_enabled = 0;
+}
+
+void trace_dump(void)
+{
+	uint32_t enabled = trace_enabled;
+	trace_enabled = 0;
+
+	const uint32_t *words = (const uint32_t *)&trace_buf;
+	uint32_t nb_words = sizeof(trace_buf) / sizeof(uint32_t);
+	/* leave out the records which were not written */
+	if (trace_buf.count < TRACE_NB_RECORDS)
+		nb_words -= (TRACE_NB_RECORDS - trace_buf.count) *
+			    sizeof(struct trace_record) / sizeof(uint32_t);
+
+	printf("trace begin\n");
+	for (uint32_t i = 0; i < nb_words; i += 8) {
+		for (uint32_t j = i; j < i + 8 && j < nb_words; j++)
+			printf("%08" PRIx32 "%c", words[j],
+			       (j + 1 == i + 8 || j + 1 == nb_words) ? '\n' :
+								      ' ');
+	}
+	printf("trace end\n");
+	trace_enabled = enabled;
+}
+
+/* Numbers the tasks in creation order and keeps their names. */
+void trace_task_create(void *task)
+{
+	uint32_t irq = __disable_irq();
+	uint32_t id = trace_nb_tasks++;
+	__restore_irq(irq);
+
+	vTaskSetTaskNumber((TaskHandle_t)task, id);
+	if (id < TRACE_NB_TASKS)
+		strncpy(trace_buf.names[id], pcTaskGetName((TaskHandle_t)task),
+			TRACE_NAME_LEN - 1);
+}
+
+void trace_task_switched_in(void)
+{
+	trace_record(TRACE_TASK_IN,
+		     uxTaskGetTaskNumber(xTaskGetCurrentTaskHandle()));
+}
+
+void trace_task_switched_out(void)
+{
+	trace_record(TRACE_TASK_OUT,
+		     uxTaskGetTaskNumber(xTaskGetCurrentTaskHandle()));
+}
+
+void trace_irq_enter(int id)
+{
+	trace_record(TRACE_IRQ_ENTER, id);
+}
+
+void trace_irq_exit(int id)
+{
+	trace_record(TRACE_IRQ_EXIT, id);
+}
+
+#endif /* CONFIG_TRACE */
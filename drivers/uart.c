@@ -39,26 +39,39 @@ static struct uart_itf_data_s *g_uart_itf_data[UDMA_NB_UART] = {0};
 
 static void __pi_uart_handle_end_of_task(struct pi_task *task);
 
-/* IRQ handler. */
-static void __pi_uart_handler(void *arg);
-
-/* Enqueue a task in fifo. */
-static uint32_t __pi_uart_task_fifo_enqueue(struct uart_itf_data_s *data,
-					    struct pi_task *task,
-					    udma_channel_e channel);
-/* Pop a task from fifo. */
-static struct pi_task *__pi_uart_task_fifo_pop(struct uart_itf_data_s *data,
-					       udma_channel_e channel);
+/* IRQ handlers. */
+static void __pi_uart_rx_handler(void *arg);
+static void __pi_uart_tx_handler(void *arg);
 
 /* Execute a transfer. */
-static void __pi_uart_copy_exec(struct uart_itf_data_s *data,
-				struct pi_task *task);
+static int32_t __pi_uart_copy_exec(struct uart_itf_data_s *data,
+				   struct pi_task *task);
+
+/* Start RX transfers from the head of the queue. */
+static int32_t __pi_uart_rx_start(struct uart_itf_data_s *data,
+				  struct pi_task *task, struct pi_task *own);
+
+/* Complete current RX task and start the next RX transfer. */
+static void __pi_uart_rx_next(struct uart_itf_data_s *data);
+
+/* Queue chunks of a transfer going through the bounce pool. */
+static void __pi_uart_bounce_push(struct uart_itf_data_s *data,
+				  udma_channel_e channel);
+
+/* Complete sent TX tasks and start the next TX transfer. */
+static void __pi_uart_tx_next(struct uart_itf_data_s *data);
 
 /* Abort current transfer and flush pending transfers. */
 static void __pi_uart_rx_abort(struct uart_itf_data_s *data);
 
 static void __pi_uart_tx_abort(struct uart_itf_data_s *data);
 
+/* Handle end of a ring half and hand it to the waiting task if any. */
+static void __pi_uart_rx_ring_handler(struct uart_itf_data_s *data);
+
+/* Reset ring state and release the waiting task. */
+static void __pi_uart_rx_ring_flush(struct uart_itf_data_s *data);
+
 /* Configure UART. */
 static void __pi_uart_conf_set(struct uart_itf_data_s *data,
 			       struct pi_uart_conf *conf);
@@ -120,6 +133,12 @@ int pi_uart_open(struct pi_device *device)
 			return -11;
 		}
 		memset((void *)data, 0, sizeof(struct uart_itf_data_s));
+		data->tx_staging = (uint8_t *)pi_l2_malloc(UART_TX_STAGING_SIZE);
+		if (!data->tx_staging) {
+			UART_TRACE_ERR("TX staging buffer alloc failed !\n");
+			pi_l2_free(data, sizeof(struct uart_itf_data_s));
+			return -11;
+		}
 		data->device_id = conf->uart_id;
 		data->nb_open = 1;
 
@@ -131,14 +150,14 @@ int pi_uart_open(struct pi_device *device)
 		UART_TRACE(
 			"Enable SoC events and set handlers : RX : %d -> %p | TX: %d -> %p\n",
 			SOC_EVENT_UDMA_UART_RX(data->device_id),
-			__pi_uart_handler,
+			__pi_uart_rx_handler,
 			SOC_EVENT_UDMA_UART_TX(data->device_id),
-			__pi_uart_handler);
+			__pi_uart_tx_handler);
 		/* Set handlers. */
 		pi_fc_event_handler_set(SOC_EVENT_UDMA_UART_RX(data->device_id),
-					__pi_uart_handler);
+					__pi_uart_rx_handler, data);
 		pi_fc_event_handler_set(SOC_EVENT_UDMA_UART_TX(data->device_id),
-					__pi_uart_handler);
+					__pi_uart_tx_handler, data);
 		/* Enable SOC events propagation to FC. */
 		hal_soc_eu_set_fc_mask(
 			(int)SOC_EVENT_UDMA_UART_RX(data->device_id));
@@ -202,6 +221,7 @@ void pi_uart_close(struct pi_device *device)
 			(int)SOC_EVENT_UDMA_UART_TX(data->device_id));
 
 		/* Free allocated data. */
+		pi_l2_free(data->tx_staging, UART_TX_STAGING_SIZE);
 		pi_l2_free(data, sizeof(struct uart_itf_data_s));
 		g_uart_itf_data[data->device_id] = NULL;
 	}
@@ -238,8 +258,9 @@ static void __pi_uart_rx_abort(struct uart_itf_data_s *data)
 		uart(device_id)->setup, uart(device_id)->status,
 		uart(device_id)->rx.saddr, uart(device_id)->rx.size,
 		uart(device_id)->rx.cfg);
-	data->fifo_head[RX_CHANNEL] = NULL;
-	data->fifo_tail[RX_CHANNEL] = NULL;
+	udma_queue_init(&(data->queue[RX_CHANNEL]));
+	udma_bounce_pipe_abort(&(data->bounce[RX_CHANNEL]));
+	__pi_uart_rx_ring_flush(data);
 }
 
 static void __pi_uart_tx_abort(struct uart_itf_data_s *data)
@@ -259,8 +280,8 @@ static void __pi_uart_tx_abort(struct uart_itf_data_s *data)
 		uart(device_id)->setup, uart(device_id)->status,
 		uart(device_id)->tx.saddr, uart(device_id)->tx.size,
 		uart(device_id)->tx.cfg);
-	data->fifo_head[TX_CHANNEL] = NULL;
-	data->fifo_tail[TX_CHANNEL] = NULL;
+	udma_queue_init(&(data->queue[TX_CHANNEL]));
+	udma_bounce_pipe_abort(&(data->bounce[TX_CHANNEL]));
 }
 
 
@@ -300,52 +321,90 @@ int pi_uart_ioctl(struct pi_device *device, uint32_t cmd, void *arg)
 	return 0;
 }
 
+/* Enqueue a TX task whose iovec cursor is set up. */
+static int32_t __pi_uart_tx_enqueue(struct uart_itf_data_s *data,
+				    struct pi_task *task)
+{
+	struct udma_queue *queue = &(data->queue[TX_CHANNEL]);
+	task->data[2] = TX_CHANNEL;
+	task->data[5] = 0;
+	pi_task_status_set(task, 0);
+	if (udma_queue_push(queue, task)) {
+		UART_TRACE_ERR("UART(%ld): TX queue is full !\n",
+			       data->device_id);
+		return -11;
+	}
+	/* Start sending if the channel was idle. */
+	if (udma_queue_claim(queue) != NULL) {
+		__pi_uart_tx_next(data);
+	}
+	return 0;
+}
+
 static int32_t __pi_uart_copy(struct uart_itf_data_s *data, uint32_t l2_buf,
 			      uint32_t size, udma_channel_e channel,
 			      struct pi_task *task)
 {
-	uint32_t irq = __disable_irq();
+	if (channel == TX_CHANNEL) {
+		struct pi_uart_iovec *iov =
+			(struct pi_uart_iovec *)&(task->data[6]);
+		iov->iov_base = (void *)l2_buf;
+		iov->iov_len = size;
+		task->data[0] = (uint32_t)iov;
+		task->data[1] = 1;
+		return __pi_uart_tx_enqueue(data, task);
+	}
+
+	struct udma_queue *queue = &(data->queue[RX_CHANNEL]);
 	// Due to udma restriction, we need to use an L2 address,
-	// Since the stack is probably in FC tcdm, we have to either ensure
-	// users gave us an L2 pointer or alloc ourselves
-	if ((l2_buf & 0xFFF00000) != 0x1C000000) {
-		UART_TRACE_ERR("UART(%ld): Error wrong buffer %lx !\n",
+	// Since the stack is probably in FC tcdm, other buffers are received
+	// through the bounce pool
+	if (!udma_bounce_is_l2(l2_buf) && (udma_bounce_available() == 0)) {
+		UART_TRACE_ERR("UART(%ld): No bounce buffer for %lx !\n",
 			       data->device_id, l2_buf);
-		__restore_irq(irq);
 		return -11;
 	}
+	/* RX channel is owned by the ring while it is running. */
+	if (data->rx_ring.half_size) {
+		UART_TRACE_ERR("UART(%ld): RX ring is running !\n",
+			       data->device_id);
+		return -1;
+	}
 
 	task->data[0] = l2_buf;
 	task->data[1] = size;
 	task->data[2] = channel;
 	task->data[3] = 0; /* Repeat size ? */
-	task->next = NULL;
-	uint8_t head =
-		(uint8_t)__pi_uart_task_fifo_enqueue(data, task, channel);
-	if (head == 0) {
-		/* Execute the transfer. */
-		UART_TRACE(
-			"UART(%ld): Execute %s transfer l2_buf=%lx size=%ld\n",
-			data->device_id,
-			((task->data[2] == RX_CHANNEL) ? "RX" : "TX"),
-			task->data[0], task->data[1]);
-		__pi_uart_copy_exec(data, task);
+	pi_task_status_set(task, 0);
+	if (udma_queue_push(queue, task)) {
+		UART_TRACE_ERR("UART(%ld): RX queue is full !\n",
+			       data->device_id);
+		return -11;
 	}
-	/* TODO: insert compiler barrier here */
-	__restore_irq(irq);
-	/* restore_irq(irq); */
-	return 0;
+	/* Execute the transfer if the channel was idle. */
+	return __pi_uart_rx_start(data, udma_queue_claim(queue), task);
 }
 
 /* Execute transfer. */
-static void __pi_uart_copy_exec(struct uart_itf_data_s *data,
-				struct pi_task *task)
+static int32_t __pi_uart_copy_exec(struct uart_itf_data_s *data,
+				   struct pi_task *task)
 {
 	uint32_t device_id = data->device_id;
 	uint32_t l2_buf = task->data[0];
 	uint32_t size = task->data[1];
 	udma_channel_e channel = task->data[2];
 	uint32_t max_size = (uint32_t)UDMA_MAX_SIZE - 4;
+	if (!udma_bounce_is_l2(l2_buf)) {
+		if (udma_bounce_pipe_start(&(data->bounce[channel]), l2_buf,
+					   size, channel == RX_CHANNEL)) {
+			UART_TRACE_ERR("UART(%ld): No bounce buffer for %lx !\n",
+				       device_id, l2_buf);
+			return -1;
+		}
+		__pi_uart_bounce_push(data, channel);
+		return 0;
+	}
+	task->data[3] = 0;
 	if (task->data[1] > max_size) {
 		task->data[3] = task->data[1] - max_size;
 		size = max_size;
@@ -354,6 +413,168 @@ static void __pi_uart_copy_exec(struct uart_itf_data_s *data,
 		   device_id, ((channel == RX_CHANNEL) ? "RX" : "TX"), l2_buf,
 		   size);
 	hal_uart_enqueue(device_id, l2_buf, size, 0, channel);
+	return 0;
+}
+
+static void __pi_uart_bounce_push(struct uart_itf_data_s *data,
+				  udma_channel_e channel)
+{
+	uint32_t size = 0;
+	uint32_t l2_buf = 0;
+	/* Up to two chunks are queued, the uDMA runs one and keeps the other
+	 * pending. */
+	while ((l2_buf = udma_bounce_pipe_next(&(data->bounce[channel]),
+					       &size)) != 0) {
+		UART_TRACE("UART(%ld): Queue bounce chunk l2_buf=%lx size=%ld\n",
+			   data->device_id, l2_buf, size);
+		hal_uart_enqueue(data->device_id, l2_buf, size, 0, channel);
+	}
+}
+
+/*
+ * Start the RX transfer of task, which the caller owns, or of the following
+ * ones if it cannot be started. Dropped tasks are completed with the status
+ * -11, except own which the caller reports instead.
+ */
+static int32_t __pi_uart_rx_start(struct uart_itf_data_s *data,
+				  struct pi_task *task, struct pi_task *own)
+{
+	struct udma_queue *queue = &(data->queue[RX_CHANNEL]);
+	int32_t status = 0;
+	while (task != NULL) {
+		UART_TRACE("UART(%ld): Execute RX transfer l2_buf=%lx "
+			   "size=%ld\n",
+			   data->device_id, task->data[0], task->data[1]);
+		if (__pi_uart_copy_exec(data, task) == 0) {
+			break;
+		}
+		/* Transfer could not be started, drop it. */
+		udma_queue_pop(queue);
+		if (task == own) {
+			status = -11;
+		} else {
+			pi_task_status_set(task, -11);
+			__pi_uart_handle_end_of_task(task);
+		}
+		task = udma_queue_next(queue);
+	}
+	return status;
+}
+
+static void __pi_uart_rx_next(struct uart_itf_data_s *data)
+{
+	struct udma_queue *queue = &(data->queue[RX_CHANNEL]);
+	struct pi_task *task = udma_queue_pop(queue);
+	__pi_uart_handle_end_of_task(task);
+	__pi_uart_rx_start(data, udma_queue_next(queue), NULL);
+}
+
+/* Move TX task cursor to next iovec. */
+static inline void __pi_uart_tx_iov_next(struct pi_task *task)
+{
+	task->data[0] += sizeof(struct pi_uart_iovec);
+	task->data[1]--;
+	task->data[5] = 0;
+}
+
+/*
+ * Build and start the next TX transfer from the pending tasks. Consecutive
+ * small fragments, possibly from several tasks, are copied into the staging
+ * buffer and sent at once. Bigger fragments are sent from the user buffer.
+ * Returns 0 if there was nothing left to send.
+ */
+static int __pi_uart_tx_exec(struct uart_itf_data_s *data)
+{
+	uint32_t max_size = (uint32_t)UDMA_MAX_SIZE - 4;
+	uint32_t staged = 0;
+	struct pi_task *task = NULL;
+	for (uint32_t n = 0;
+	     (task = udma_queue_at(&(data->queue[TX_CHANNEL]), n)) != NULL;
+	     n++) {
+		while (task->data[1] != 0) {
+			struct pi_uart_iovec *iov =
+				(struct pi_uart_iovec *)task->data[0];
+			uint32_t l2_buf = (uint32_t)iov->iov_base + task->data[5];
+			uint32_t size = iov->iov_len - task->data[5];
+			if (size == 0) {
+				__pi_uart_tx_iov_next(task);
+			} else if (size <= UART_TX_COALESCE_MAX) {
+				if (size > (UART_TX_STAGING_SIZE - staged)) {
+					goto flush;
+				}
+				memcpy(&(data->tx_staging[staged]),
+				       (void *)l2_buf, size);
+				staged += size;
+				__pi_uart_tx_iov_next(task);
+			} else if (staged) {
+				goto flush;
+			} else if (!udma_bounce_is_l2(l2_buf)) {
+				struct udma_bounce_pipe *pipe =
+					&(data->bounce[TX_CHANNEL]);
+				if (!udma_bounce_pipe_start(pipe, l2_buf, size,
+							    0)) {
+					/* Chunked through the bounce pool. */
+					__pi_uart_tx_iov_next(task);
+					__pi_uart_bounce_push(data, TX_CHANNEL);
+					return 1;
+				}
+				/* Pool is empty, use the staging buffer. */
+				if (size > UART_TX_STAGING_SIZE) {
+					size = UART_TX_STAGING_SIZE;
+				}
+				memcpy(data->tx_staging, (void *)l2_buf, size);
+				task->data[5] += size;
+				if (task->data[5] == iov->iov_len) {
+					__pi_uart_tx_iov_next(task);
+				}
+				hal_uart_enqueue(data->device_id,
+						 (uint32_t)data->tx_staging,
+						 size, 0, TX_CHANNEL);
+				return 1;
+			} else {
+				/* Large fragment, sent in place. */
+				if (size > max_size) {
+					size = max_size;
+				}
+				task->data[5] += size;
+				if (task->data[5] == iov->iov_len) {
+					__pi_uart_tx_iov_next(task);
+				}
+				UART_TRACE("UART(%ld): Execute TX transfer "
+					   "l2_buf=%lx size=%ld\n",
+					   data->device_id, l2_buf, size);
+				hal_uart_enqueue(data->device_id, l2_buf, size,
+						 0, TX_CHANNEL);
+				return 1;
+			}
+		}
+	}
+flush:
+	if (staged == 0) {
+		return 0;
+	}
+	UART_TRACE("UART(%ld): Execute coalesced TX transfer size=%ld\n",
+		   data->device_id, staged);
+	hal_uart_enqueue(data->device_id, (uint32_t)data->tx_staging, staged,
+			 0, TX_CHANNEL);
+	return 1;
+}
+
+static void __pi_uart_tx_next(struct uart_itf_data_s *data)
+{
+	struct udma_queue *queue = &(data->queue[TX_CHANNEL]);
+	struct pi_task *task;
+	do {
+		/* Tasks fully sent are at the head of the queue. */
+		while (((task = udma_queue_head(queue)) != NULL) &&
+		       (task->data[1] == 0)) {
+			udma_queue_pop(queue);
+			__pi_uart_handle_end_of_task(task);
+		}
+		if ((task != NULL) && __pi_uart_tx_exec(data)) {
+			return;
+		}
+	} while (udma_queue_next(queue) != NULL);
 }
 
 static void __pi_uart_handle_end_of_task(struct pi_task *task)
@@ -368,16 +589,26 @@ static void __pi_uart_handle_end_of_task(struct pi_task *task)
 }
 
 /* IRQ handler. */
-static void __pi_uart_handler(void *arg)
+static inline void __pi_uart_handler(struct uart_itf_data_s *data,
+				     uint32_t channel)
 {
-	uint32_t event = (uint32_t)arg;
-	uint32_t channel = event & 0x1;
-	uint32_t periph_id =
-		(event >> UDMA_CHANNEL_NB_EVENTS_LOG2) - UDMA_UART_ID(0);
-	UART_TRACE("Uart IRQ %d %d\n", periph_id, event);
+	UART_TRACE("Uart IRQ %d %d\n", data->device_id, channel);
 
-	struct uart_itf_data_s *data = g_uart_itf_data[periph_id];
-	struct pi_task *task = data->fifo_head[channel];
+	if ((channel == RX_CHANNEL) && data->rx_ring.half_size) {
+		__pi_uart_rx_ring_handler(data);
+		return;
+	}
+	struct udma_bounce_pipe *pipe = &(data->bounce[channel]);
+	if (udma_bounce_pipe_busy(pipe) && !udma_bounce_pipe_done(pipe)) {
+		UART_TRACE("Queue next bounce chunk of current transfer.\n");
+		__pi_uart_bounce_push(data, channel);
+		return;
+	}
+	if (channel == TX_CHANNEL) {
+		__pi_uart_tx_next(data);
+		return;
+	}
+	struct pi_task *task = udma_queue_head(&(data->queue[channel]));
 	/* Pending data on current transfer. */
 	if (task->data[3] != 0) {
 		UART_TRACE("Reenqueue pending data on current transfer.\n");
@@ -389,53 +620,68 @@ static void __pi_uart_handler(void *arg)
 		UART_TRACE(
 			"No pending data on current transfer.\n Handle end of "
 			"current transfer and pop and start a new transfer if there is.\n");
-		task = __pi_uart_task_fifo_pop(data, channel);
-		__pi_uart_handle_end_of_task(task);
-		task = data->fifo_head[channel];
-		if (task != NULL) {
-			__pi_uart_copy_exec(data, task);
-		}
+		__pi_uart_rx_next(data);
 	}
 }
 
-/* Enqueue a task in fifo. */
-static inline uint32_t __pi_uart_task_fifo_enqueue(struct uart_itf_data_s *data,
-						   struct pi_task *task,
-						   udma_channel_e channel)
+static void __pi_uart_rx_handler(void *arg)
 {
-	uint8_t head = 0;
-	uint32_t irq = __disable_irq();
-	if (data->fifo_head[channel] == NULL) {
-		/* Empty fifo. */
-		/* Execute the transfer. */
-		data->fifo_head[channel] = task;
-		data->fifo_tail[channel] = data->fifo_head[channel];
-		head = 0;
-	} else {
-		/* Transfer on going, enqueue this one to the list. */
-		data->fifo_tail[channel]->next = task;
-		data->fifo_tail[channel] = data->fifo_tail[channel]->next;
-		head = 1;
+	__pi_uart_handler(arg, RX_CHANNEL);
+}
+
+static void __pi_uart_tx_handler(void *arg)
+{
+	__pi_uart_handler(arg, TX_CHANNEL);
+}
+
+/* Hand the oldest completed half to the waiting task. */
+static void __pi_uart_rx_ring_deliver(struct uart_rx_ring_s *ring)
+{
+	struct pi_task *task = ring->waiter;
+	if ((task == NULL) || (ring->count == 0)) {
+		return;
 	}
-	__restore_irq(irq);
-	return head;
+	*(ring->chunk) = (uint8_t *)(ring->l2_buf + ring->head * ring->half_size);
+	ring->head ^= 1;
+	ring->count--;
+	ring->waiter = NULL;
+	__pi_uart_handle_end_of_task(task);
 }
 
-/* Pop a task from fifo. */
-static inline struct pi_task *
-__pi_uart_task_fifo_pop(struct uart_itf_data_s *data, udma_channel_e channel)
+static void __pi_uart_rx_ring_handler(struct uart_itf_data_s *data)
 {
-	uint32_t irq = __disable_irq();
-	struct pi_task *task_to_return = NULL;
-	if (data->fifo_head[channel] != NULL) {
-		task_to_return = data->fifo_head[channel];
-		data->fifo_head[channel] = data->fifo_head[channel]->next;
-		if (data->fifo_head[channel] == NULL) {
-			data->fifo_tail[channel] = NULL;
-		}
+	struct uart_rx_ring_s *ring = &(data->rx_ring);
+	uint8_t half = ring->next;
+	ring->next ^= 1;
+	/*
+	 * The uDMA is filling the other half now. If it was not read yet it is
+	 * lost, drop it so that it is never handed out while being written.
+	 */
+	if (ring->count != 0) {
+		UART_TRACE_ERR("UART(%ld): RX ring overrun\n", data->device_id);
+		ring->overrun++;
+		ring->head ^= 1;
+		ring->count--;
 	}
-	__restore_irq(irq);
-	return task_to_return;
+	/* Queue the completed half again so that the uDMA reloads it when the
+	 * running one is full. */
+	hal_uart_rx_enqueue_continuous(data->device_id,
+				       ring->l2_buf + half * ring->half_size,
+				       ring->half_size);
+	ring->count++;
+	__pi_uart_rx_ring_deliver(ring);
+}
+
+static void __pi_uart_rx_ring_flush(struct uart_itf_data_s *data)
+{
+	struct uart_rx_ring_s *ring = &(data->rx_ring);
+	struct pi_task *task = ring->waiter;
+	if (task != NULL) {
+		*(ring->chunk) = NULL;
+		ring->waiter = NULL;
+		__pi_uart_handle_end_of_task(task);
+	}
+	memset((void *)ring, 0, sizeof(struct uart_rx_ring_s));
 }
 
 int pi_uart_write(struct pi_device *device, void *buffer, uint32_t size)
@@ -444,6 +690,10 @@ int pi_uart_write(struct pi_device *device, void *buffer, uint32_t size)
 	pi_task_t task_block = {0};
 	pi_task_block(&task_block);
 	status = pi_uart_write_async(device, buffer, size, &task_block);
+	if (status) {
+		pi_task_destroy(&task_block);
+		return status;
+	}
 	pi_task_wait_on(&task_block);
 	pi_task_destroy(&task_block);
 	return status;
@@ -455,6 +705,10 @@ int pi_uart_write_byte(struct pi_device *device, uint8_t *byte)
 	pi_task_t task_block = {0};
 	pi_task_block(&task_block);
 	status = pi_uart_write_async(device, byte, 1, &task_block);
+	if (status) {
+		pi_task_destroy(&task_block);
+		return status;
+	}
 	pi_task_wait_on(&task_block);
 	pi_task_destroy(&task_block);
 	return status;
@@ -476,15 +730,47 @@ int pi_uart_write_async(struct pi_device *device, void *buffer, uint32_t size,
 	return __pi_uart_copy(data, l2_buf, size, TX_CHANNEL, callback);
 }
 
+int pi_uart_writev(struct pi_device *device, const struct pi_uart_iovec *iov,
+		   uint32_t iovcnt)
+{
+	int32_t status = 0;
+	pi_task_t task_block = {0};
+	pi_task_block(&task_block);
+	status = pi_uart_writev_async(device, iov, iovcnt, &task_block);
+	if (status) {
+		pi_task_destroy(&task_block);
+		return status;
+	}
+	pi_task_wait_on(&task_block);
+	pi_task_destroy(&task_block);
+	return status;
+}
+
+int pi_uart_writev_async(struct pi_device *device,
+			 const struct pi_uart_iovec *iov, uint32_t iovcnt,
+			 pi_task_t *callback)
+{
+	struct uart_itf_data_s *data = (struct uart_itf_data_s *)device->data;
+	UART_TRACE("UART(%ld): Writev iov=%p iovcnt=%ld\n", data->device_id,
+		   iov, iovcnt);
+	callback->data[0] = (uint32_t)iov;
+	callback->data[1] = iovcnt;
+	return __pi_uart_tx_enqueue(data, callback);
+}
+
 int pi_uart_read(struct pi_device *device, void *buffer, uint32_t size)
 {
 	int32_t status = 0;
 	pi_task_t task_block = {0};
 	pi_task_block(&task_block);
 	status = pi_uart_read_async(device, buffer, size, &task_block);
+	if (status) {
+		pi_task_destroy(&task_block);
+		return status;
+	}
 	pi_task_wait_on(&task_block);
 	pi_task_destroy(&task_block);
-	return status;
+	return pi_task_status_get(&task_block);
 }
 
 int pi_uart_read_byte(struct pi_device *device, uint8_t *byte)
@@ -493,9 +779,13 @@ int pi_uart_read_byte(struct pi_device *device, uint8_t *byte)
 	pi_task_t task_block = {0};
 	pi_task_block(&task_block);
 	status = pi_uart_read_async(device, byte, 1, &task_block);
+	if (status) {
+		pi_task_destroy(&task_block);
+		return status;
+	}
 	pi_task_wait_on(&task_block);
 	pi_task_destroy(&task_block);
-	return status;
+	return pi_task_status_get(&task_block);
 }
 
 int pi_uart_read_async(struct pi_device *device, void *buffer, uint32_t size,
@@ -508,13 +798,182 @@ int pi_uart_read_async(struct pi_device *device, void *buffer, uint32_t size,
 	return __pi_uart_copy(data, l2_buf, size, RX_CHANNEL, callback);
 }
 
-/* unimplemented cluster functions */
-static inline void pi_cl_uart_write_wait(pi_cl_uart_req_t *req)
+int pi_uart_rx_ring_start(struct pi_device *device, void *buffer,
+			  uint32_t size)
+{
+	struct uart_itf_data_s *data = (struct uart_itf_data_s *)device->data;
+	struct uart_rx_ring_s *ring = &(data->rx_ring);
+	uint32_t l2_buf = (uint32_t)buffer;
+	uint32_t half_size = size >> 1;
+	UART_TRACE("UART(%ld): Start RX ring l2_buf=%lx size=%ld\n",
+		   data->device_id, l2_buf, size);
+	if ((l2_buf & 0xFFF00000) != 0x1C000000) {
+		UART_TRACE_ERR("UART(%ld): Error wrong buffer %lx !\n",
+			       data->device_id, l2_buf);
+		return -11;
+	}
+	if ((half_size == 0) || (size & 0x1) ||
+	    (half_size > ((uint32_t)UDMA_MAX_SIZE - 4))) {
+		UART_TRACE_ERR("UART(%ld): Error wrong ring size %ld !\n",
+			       data->device_id, size);
+		return -1;
+	}
+
+	uint32_t irq = __disable_irq();
+	if (ring->half_size || !udma_queue_empty(&(data->queue[RX_CHANNEL]))) {
+		UART_TRACE_ERR("UART(%ld): RX channel is busy !\n",
+			       data->device_id);
+		__restore_irq(irq);
+		return -1;
+	}
+	memset((void *)ring, 0, sizeof(struct uart_rx_ring_s));
+	ring->l2_buf = l2_buf;
+	ring->half_size = half_size;
+	/* First half starts right away, second one is pending. */
+	hal_uart_rx_enqueue_continuous(data->device_id, l2_buf, half_size);
+	hal_uart_rx_enqueue_continuous(data->device_id, l2_buf + half_size,
+				       half_size);
+	__restore_irq(irq);
+	return 0;
+}
+
+void pi_uart_rx_ring_stop(struct pi_device *device)
+{
+	struct uart_itf_data_s *data = (struct uart_itf_data_s *)device->data;
+	UART_TRACE("UART(%ld): Stop RX ring\n", data->device_id);
+	uint32_t irq = __disable_irq();
+	if (data->rx_ring.half_size) {
+		hal_uart_rx_clear(data->device_id);
+		__pi_uart_rx_ring_flush(data);
+	}
+	__restore_irq(irq);
+}
+
+int pi_uart_rx_ring_read(struct pi_device *device, uint8_t **chunk)
+{
+	struct uart_itf_data_s *data = (struct uart_itf_data_s *)device->data;
+	uint32_t size = data->rx_ring.half_size;
+	pi_task_t task_block = {0};
+	pi_task_block(&task_block);
+	if (pi_uart_rx_ring_read_async(device, chunk, &task_block)) {
+		pi_task_destroy(&task_block);
+		return 0;
+	}
+	pi_task_wait_on(&task_block);
+	pi_task_destroy(&task_block);
+	return (*chunk != NULL) ? (int)size : 0;
+}
+
+int pi_uart_rx_ring_read_async(struct pi_device *device, uint8_t **chunk,
+			       pi_task_t *callback)
+{
+	struct uart_itf_data_s *data = (struct uart_itf_data_s *)device->data;
+	struct uart_rx_ring_s *ring = &(data->rx_ring);
+	uint32_t irq = __disable_irq();
+	if ((ring->half_size == 0) || (ring->waiter != NULL)) {
+		__restore_irq(irq);
+		return -1;
+	}
+	ring->chunk = chunk;
+	ring->waiter = callback;
+	__pi_uart_rx_ring_deliver(ring);
+	__restore_irq(irq);
+	return 0;
+}
+
+uint32_t pi_uart_rx_ring_overrun_get(struct pi_device *device)
+{
+	struct uart_itf_data_s *data = (struct uart_itf_data_s *)device->data;
+	return data->rx_ring.overrun;
+}
+
+#ifdef CONFIG_CLUSTER
+/* Runs on the FC from the event kernel, wakes the waiting cluster core. */
+static void __pi_cl_uart_done(void *arg)
+{
+	pi_cl_uart_req_t *req = (pi_cl_uart_req_t *)arg;
+	cl_notify_task_done((uint8_t *)&(req->done), 0);
+}
+
+/* Runs on the FC, from the cluster notification IRQ. */
+static void __pi_cl_uart_req_handler(struct cl_fc_req *fc_req)
+{
+	pi_cl_uart_req_t *req = (pi_cl_uart_req_t *)fc_req;
+	int status;
+	if (req->is_read) {
+		status = pi_uart_read_async(req->device, req->buffer, req->size,
+					    &(req->task));
+	} else {
+		status = pi_uart_write_async(req->device, req->buffer,
+					     req->size, &(req->task));
+	}
+	if (status) {
+		UART_TRACE_ERR("Cluster request %p failed: %d\n", req, status);
+		pi_task_status_set(&(req->task), status);
+		__pi_cl_uart_done(req);
+	}
+}
+
+static int __pi_cl_uart_copy(pi_device_t *device, void *buffer, uint32_t size,
+			     uint8_t is_read, pi_cl_uart_req_t *req)
+{
+	req->device = device;
+	req->buffer = buffer;
+	req->size = size;
+	req->is_read = is_read;
+	req->done = 0;
+	/* Completed by the uart driver with a callback, which signals the
+	 * cluster through its event unit. */
+	req->task.id = PI_TASK_CALLBACK_ID;
+	req->task.arg[0] = (uintptr_t)__pi_cl_uart_done;
+	req->task.arg[1] = (uintptr_t)req;
+	req->task.done = 0;
+	req->task.wait_on.sem_object = NULL;
+	req->task.waiter = NULL;
+	req->task.destroy = 0;
+	req->task.core_id = -1;
+	req->fc_req.handler = __pi_cl_uart_req_handler;
+	cl_fc_req_send(&(req->fc_req));
+	return 0;
+}
+
+static void __pi_cl_uart_wait(pi_cl_uart_req_t *req)
+{
+	/* the core sleeps until the FC triggers the notification event */
+	cl_wait_task((uint8_t *)&(req->done));
+}
+
+int pi_cl_uart_write(pi_device_t *device, void *buffer, uint32_t size,
+		     pi_cl_uart_req_t *req)
+{
+	return __pi_cl_uart_copy(device, buffer, size, 0, req);
+}
+
+int pi_cl_uart_write_byte(pi_device_t *device, uint8_t *byte,
+			  pi_cl_uart_req_t *req)
+{
+	return __pi_cl_uart_copy(device, byte, 1, 0, req);
+}
+
+void pi_cl_uart_write_wait(pi_cl_uart_req_t *req)
+{
+	__pi_cl_uart_wait(req);
+}
+
+int pi_cl_uart_read(pi_device_t *device, void *buffer, uint32_t size,
+		    pi_cl_uart_req_t *req)
+{
+	return __pi_cl_uart_copy(device, buffer, size, 1, req);
+}
+
+int pi_cl_uart_read_byte(pi_device_t *device, uint8_t *byte,
+			 pi_cl_uart_req_t *req)
 {
-	abort();
+	return __pi_cl_uart_copy(device, byte, 1, 1, req);
 }
 
-static inline void pi_cl_uart_read_wait(pi_cl_uart_req_t *req)
+void pi_cl_uart_read_wait(pi_cl_uart_req_t *req)
 {
-	abort();
+	__pi_cl_uart_wait(req);
 }
+#endif /* CONFIG_CLUSTER */
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "riscv.h"
+#include "udma_bounce.h"
+
+/* Pool buffers, placed in L2 along with the rest of .bss. */
+static uint8_t udma_bounce_pool[UDMA_BOUNCE_NB_BUF][UDMA_BOUNCE_BUF_SIZE]
+	__attribute__((aligned(4)));
+
+/* Bit i set means buffer i is free. */
+static uint32_t udma_bounce_free_mask =
+	(uint32_t)(((uint64_t)1 << UDMA_BOUNCE_NB_BUF) - 1);
+
+uint8_t *udma_bounce_alloc(void)
+{
+	uint8_t *buf = NULL;
+	uint32_t irq = __disable_irq();
+	if (udma_bounce_free_mask) {
+		uint32_t idx = (uint32_t)__builtin_ctz(udma_bounce_free_mask);
+		udma_bounce_free_mask &= ~(1ul << idx);
+		buf = udma_bounce_pool[idx];
+	}
+	__restore_irq(irq);
+	return buf;
+}
+
+void udma_bounce_free(uint8_t *buf)
+{
+	uint32_t idx = (uint32_t)(buf - &udma_bounce_pool[0][0]) /
+		       UDMA_BOUNCE_BUF_SIZE;
+	uint32_t irq = __disable_irq();
+	udma_bounce_free_mask |= 1ul << idx;
+	__restore_irq(irq);
+}
+
+uint32_t udma_bounce_available(void)
+{
+	return (uint32_t)__builtin_popcount(udma_bounce_free_mask);
+}
+
+int udma_bounce_pipe_start(struct udma_bounce_pipe *pipe, uint32_t user,
+			   uint32_t size, int is_rx)
+{
+	memset(pipe, 0, sizeof(struct udma_bounce_pipe));
+	pipe->buf[0] = udma_bounce_alloc();
+	if (pipe->buf[0] == NULL) {
+		return -1;
+	}
+	/* Without a second buffer chunks are simply not overlapped. */
+	if (size > UDMA_BOUNCE_BUF_SIZE) {
+		pipe->buf[1] = udma_bounce_alloc();
+	}
+	pipe->user = user;
+	pipe->left = size;
+	pipe->is_rx = (uint8_t)is_rx;
+	return 0;
+}
+
+uint32_t udma_bounce_pipe_next(struct udma_bounce_pipe *pipe, uint32_t *size)
+{
+	uint8_t nb_buf = (pipe->buf[1] != NULL) ? 2 : 1;
+	if ((pipe->left == 0) || (pipe->inflight == nb_buf)) {
+		return 0;
+	}
+	uint8_t idx = (pipe->head + pipe->inflight) % nb_buf;
+	uint32_t chunk = pipe->left;
+	if (chunk > UDMA_BOUNCE_BUF_SIZE) {
+		chunk = UDMA_BOUNCE_BUF_SIZE;
+	}
+	if (!pipe->is_rx) {
+		memcpy(pipe->buf[idx], (void *)pipe->user, chunk);
+	}
+	pipe->dst[idx] = pipe->user;
+	pipe->size[idx] = chunk;
+	pipe->user += chunk;
+	pipe->left -= chunk;
+	pipe->inflight++;
+	*size = chunk;
+	return (uint32_t)pipe->buf[idx];
+}
+
+int udma_bounce_pipe_done(struct udma_bounce_pipe *pipe)
+{
+	uint8_t nb_buf = (pipe->buf[1] != NULL) ? 2 : 1;
+	uint8_t idx = pipe->head;
+	if (pipe->is_rx) {
+		memcpy((void *)pipe->dst[idx], pipe->buf[idx], pipe->size[idx]);
+	}
+	pipe->head = (idx + 1) % nb_buf;
+	pipe->inflight--;
+	if ((pipe->inflight != 0) || (pipe->left != 0)) {
+		return 0;
+	}
+	udma_bounce_pipe_abort(pipe);
+	return 1;
+}
+
+void udma_bounce_pipe_abort(struct udma_bounce_pipe *pipe)
+{
+	if (pipe->buf[0] != NULL) {
+		udma_bounce_free(pipe->buf[0]);
+	}
+	if (pipe->buf[1] != NULL) {
+		udma_bounce_free(pipe->buf[1]);
+	}
+	memset(pipe, 0, sizeof(struct udma_bounce_pipe));
+}
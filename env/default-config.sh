@@ -7,12 +7,15 @@ export CONFIG_USE_NEWLIB=y
 
 # stdio
 export CONFIG_STDIO=fake
-## uart id to be used for stdio (if enabled)
+## uart id to be used for stdio (uart or binlog)
 export CONFIG_STDIO_UART_DEVICE_ID=0
 ## uart baudrate (if enabled)
 export CONFIG_STDIO_UART_BAUDRATE=115200
-## uart internal copy out buffer size (if enabled)
+## uart stdio ring buffer size (if enabled)
 export CONFIG_STDIO_UART_BUFSIZE=256
+## what to do when the uart stdio ring buffer is full: drop the new data,
+## block the writer or overwrite the oldest data (if enabled)
+export CONFIG_STDIO_UART_POLICY=block
 
 # divers
 export CONFIG_DRIVER_FLL=y
@@ -20,6 +23,12 @@ export CONFIG_DRIVER_CLKDIV=n
 export CONFIG_DRIVER_PLIC=n
 export CONFIG_DRIVER_INT=pclint
 
+# instrumentation
+## interrupt latency histograms
+export CONFIG_IRQ_LATENCY=n
+## task switch and interrupt trace (needs trace.h in FreeRTOSConfig.h)
+export CONFIG_TRACE=n
+
 # compilation options
 export CONFIG_CC_LTO=n
 export CONFIG_CC_SANITIZE=n
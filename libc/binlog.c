@@ -0,0 +1,60 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Binary log frames on top of the buffered uart stdio. Each frame is handed
+ * to stdio_uart_write() in one piece so that concurrent writers never
+ * interleave inside a frame.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "binlog.h"
+
+/* Text payload per frame, keeps the copy on the stack small. */
+#define BINLOG_TEXT_CHUNK 64
+
+/* stdio_uart.c */
+ssize_t stdio_uart_write(const void *ptr, size_t len);
+
+void binlog_write(uint32_t *frame, uint32_t nwords)
+{
+	uint32_t len = nwords * sizeof(uint32_t);
+	frame[0] = BINLOG_HEADER(BINLOG_TYPE_LOG, len - sizeof(uint32_t));
+	stdio_uart_write(frame, len);
+}
+
+ssize_t binlog_text(const void *ptr, size_t len)
+{
+	uint32_t frame[1 + BINLOG_TEXT_CHUNK / sizeof(uint32_t)];
+	const uint8_t *data = ptr;
+
+	for (size_t done = 0; done < len;) {
+		size_t chunk = len - done;
+		if (chunk > BINLOG_TEXT_CHUNK)
+			chunk = BINLOG_TEXT_CHUNK;
+		frame[0] = BINLOG_HEADER(BINLOG_TYPE_TEXT, chunk);
+		memcpy(&frame[1], data + done, chunk);
+		stdio_uart_write(frame, sizeof(uint32_t) + chunk);
+		done += chunk;
+	}
+	return (ssize_t)len;
+}
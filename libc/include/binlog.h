@@ -0,0 +1,118 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __BINLOG_H__
+#define __BINLOG_H__
+
+/**
+ * Binary logging with deferred formatting
+ *
+ * BINLOG(fmt, ...) does not format anything on the target. The format string
+ * is placed in the .binlog_fmt section, which is kept in the ELF file but not
+ * loaded, and the record sent over the stdio uart only holds the offset of
+ * the string in that section followed by the raw arguments, one 32-bit word
+ * each. scripts/binlogdecode formats the records on the host from the ELF
+ * file.
+ *
+ * Arguments are integers, pointers or floating point values. Floating point
+ * values are sent in single precision and 64-bit integers are truncated. A %s
+ * argument is only decoded when it points to a string of the ELF file, e.g. a
+ * literal. At most BINLOG_MAX_ARGS arguments are supported.
+ *
+ * With a CONFIG_STDIO other than binlog, BINLOG() is a plain printf().
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#define BINLOG_MAX_ARGS 8
+
+/* Frame header, the first word of every frame on the wire:
+ * byte 0 is BINLOG_SYNC, byte 1 the frame type and bytes 2-3 the payload
+ * length in bytes, little endian. */
+#define BINLOG_SYNC	  0xb7
+#define BINLOG_TYPE_TEXT  0 /* payload: raw stdout bytes */
+#define BINLOG_TYPE_LOG	  1 /* payload: format id, arguments */
+#define BINLOG_HEADER(type, len)                                               \
+	((uint32_t)BINLOG_SYNC | ((uint32_t)(type) << 8) |                     \
+	 ((uint32_t)(len) << 16))
+
+#if defined(CONFIG_STDIO) && defined(STDIO_BINLOG) &&                          \
+	(CONFIG_STDIO == STDIO_BINLOG)
+
+/* Send a log frame. frame[0] is filled with the header, frame[1] holds the
+ * format id and the arguments follow. */
+void binlog_write(uint32_t *frame, uint32_t nwords);
+
+/* Send stdout bytes as text frames. */
+ssize_t binlog_text(const void *ptr, size_t len);
+
+static inline uint32_t __binlog_float(float f)
+{
+	union {
+		float f;
+		uint32_t w;
+	} u = {.f = f};
+	return u.w;
+}
+
+#define __BINLOG_FLT(x) _Generic((x), float : (x), double : (x), default : 0.0f)
+#define __BINLOG_ARG(x)                                                        \
+	_Generic((x), float                                                    \
+		 : __binlog_float(__BINLOG_FLT(x)), double                     \
+		 : __binlog_float(__BINLOG_FLT(x)), default                    \
+		 : (uint32_t)(uintptr_t)(x))
+
+#define __BINLOG_NARG(...)                                                     \
+	__BINLOG_NARG_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define __BINLOG_NARG_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define __BINLOG_CAT(a, b)  __BINLOG_CAT_(a, b)
+#define __BINLOG_CAT_(a, b) a##b
+
+#define __BINLOG_MAP(...)                                                      \
+	__BINLOG_CAT(__BINLOG_MAP_, __BINLOG_NARG(__VA_ARGS__))(__VA_ARGS__)
+#define __BINLOG_MAP_0()
+#define __BINLOG_MAP_1(a)      , __BINLOG_ARG(a)
+#define __BINLOG_MAP_2(a, ...) , __BINLOG_ARG(a) __BINLOG_MAP_1(__VA_ARGS__)
+#define __BINLOG_MAP_3(a, ...) , __BINLOG_ARG(a) __BINLOG_MAP_2(__VA_ARGS__)
+#define __BINLOG_MAP_4(a, ...) , __BINLOG_ARG(a) __BINLOG_MAP_3(__VA_ARGS__)
+#define __BINLOG_MAP_5(a, ...) , __BINLOG_ARG(a) __BINLOG_MAP_4(__VA_ARGS__)
+#define __BINLOG_MAP_6(a, ...) , __BINLOG_ARG(a) __BINLOG_MAP_5(__VA_ARGS__)
+#define __BINLOG_MAP_7(a, ...) , __BINLOG_ARG(a) __BINLOG_MAP_6(__VA_ARGS__)
+#define __BINLOG_MAP_8(a, ...) , __BINLOG_ARG(a) __BINLOG_MAP_7(__VA_ARGS__)
+
+#define BINLOG(fmt, ...)                                                       \
+	do {                                                                   \
+		static const char __binlog_fmt[]                               \
+			__attribute__((section(".binlog_fmt"), used)) = fmt;   \
+		uint32_t __binlog_frame[] = {                                  \
+			0, (uint32_t)(uintptr_t)__binlog_fmt __BINLOG_MAP(     \
+				   __VA_ARGS__)};                              \
+		binlog_write(__binlog_frame,                                   \
+			     sizeof(__binlog_frame) / sizeof(uint32_t));       \
+	} while (0)
+
+#else
+
+#define BINLOG(fmt, ...) printf(fmt, ##__VA_ARGS__)
+
+#endif
+
+#endif /* __BINLOG_H__ */
@@ -22,16 +22,32 @@ SRCS += $(dir)/malloc/cl_l1_malloc.c
 SRCS += $(dir)/malloc/malloc_internal.c
 CV_CPPFLAGS += -I"$(FREERTOS_PROJ_ROOT)/$(dir)/malloc/include"
 endif
+CV_CPPFLAGS += -I"$(FREERTOS_PROJ_ROOT)/$(dir)/include"
 CV_CPPFLAGS += -DSTDIO_FAKE=2
 CV_CPPFLAGS += -DSTDIO_UART=1
 CV_CPPFLAGS += -DSTDIO_NULL=0
+CV_CPPFLAGS += -DSTDIO_BINLOG=3
 ifeq ($(CONFIG_STDIO),fake)
 CV_CPPFLAGS += -DCONFIG_STDIO=2
 else ifeq ($(CONFIG_STDIO),uart)
 CV_CPPFLAGS += -DCONFIG_STDIO=1
+else ifeq ($(CONFIG_STDIO),binlog)
+CV_CPPFLAGS += -DCONFIG_STDIO=3
+SRCS += $(dir)/binlog.c
+else ifeq ($(CONFIG_STDIO),null)
+CV_CPPFLAGS += -DCONFIG_STDIO=0
+endif
+# binlog sends its frames through the uart stdio buffer
+ifneq ($(filter uart binlog,$(CONFIG_STDIO)),)
 CV_CPPFLAGS += -DSTDIO_UART_DEVICE_ID=$(CONFIG_STDIO_UART_DEVICE_ID)
 CV_CPPFLAGS += -DSTDIO_UART_BAUDRATE=$(CONFIG_STDIO_UART_BAUDRATE)
 CV_CPPFLAGS += -DSTDIO_UART_BUFSIZE=$(CONFIG_STDIO_UART_BUFSIZE)
-else ifeq ($(CONFIG_STDIO),null)
-CV_CPPFLAGS += -DCONFIG_STDIO=0
+ifeq ($(CONFIG_STDIO_UART_POLICY),drop)
+CV_CPPFLAGS += -DSTDIO_UART_POLICY=0
+else ifeq ($(CONFIG_STDIO_UART_POLICY),overwrite)
+CV_CPPFLAGS += -DSTDIO_UART_POLICY=2
+else
+CV_CPPFLAGS += -DSTDIO_UART_POLICY=1
+endif
+SRCS += $(dir)/stdio_uart.c
 endif
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Buffered stdio over the udma uart
+ *
+ * Writers copy their data into a ring buffer and return. A drain task moves
+ * the ring content into two L2 staging buffers and queues them to the uart
+ * TX channel, so that one buffer is filled while the other one is sent. The
+ * end of transfer interrupt wakes the drain task up again.
+ *
+ * Before the scheduler runs there is no drain task, writes are sent right
+ * away by polling the channel. Interrupt handlers only append to the ring,
+ * they never wait.
+ */
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "io.h"
+#include "riscv.h"
+#include "udma.h"
+#include "udma_uart.h"
+#include "events.h"
+#include "fc_event.h"
+#include "soc_eu.h"
+
+#ifdef CONFIG_FREERTOS_KERNEL
+#include "irq.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#endif
+
+/* What to do with data that does not fit in the ring. */
+#define STDIO_UART_POLICY_DROP	    0 /* discard the new data */
+#define STDIO_UART_POLICY_BLOCK	    1 /* wait until the drain task made room */
+#define STDIO_UART_POLICY_OVERWRITE 2 /* discard the oldest data */
+
+#ifndef STDIO_UART_POLICY
+#define STDIO_UART_POLICY STDIO_UART_POLICY_BLOCK
+#endif
+
+/* Size of each of the two staging buffers. */
+#ifndef STDIO_UART_STAGE_SIZE
+#define STDIO_UART_STAGE_SIZE (STDIO_UART_BUFSIZE / 2)
+#endif
+
+#ifndef STDIO_UART_DRAIN_PRIORITY
+#define STDIO_UART_DRAIN_PRIORITY (configMAX_PRIORITIES - 1)
+#endif
+
+#define STDIO_UART_TX_CFG(dev)                                                 \
+	(UDMA_UART(dev) + UDMA_CHANNEL_TX_OFFSET + UDMA_CHANNEL_CFG_OFFSET)
+
+struct stdio_uart {
+	uint32_t head;	  /* ring write position, free running */
+	uint32_t tail;	  /* ring read position, free running */
+	uint32_t dropped; /* bytes discarded because the ring was full */
+	uint8_t stage_next; /* staging buffer to fill next */
+	volatile uint8_t locked; /* set while a task holds lock */
+#ifdef CONFIG_FREERTOS_KERNEL
+	uint32_t init; /* 0: not started, 1: starting, 2: drain task ready */
+	SemaphoreHandle_t lock;
+	TaskHandle_t drain;
+	TaskHandle_t waiter; /* writer waiting for room in the ring */
+#endif
+};
+
+static struct stdio_uart stdio_uart;
+static uint8_t stdio_uart_ring[STDIO_UART_BUFSIZE];
+static uint8_t stdio_uart_stage[2][STDIO_UART_STAGE_SIZE]
+	__attribute__((aligned(4)));
+
+static inline uint32_t stdio_uart_used(void)
+{
+	return stdio_uart.head - stdio_uart.tail;
+}
+
+/* Append as much of ptr as the policy allows, returns the bytes consumed. */
+static size_t stdio_uart_ring_put(const uint8_t *ptr, size_t len, int can_wait)
+{
+	uint32_t room = STDIO_UART_BUFSIZE - stdio_uart_used();
+	if (len > room) {
+		if ((STDIO_UART_POLICY == STDIO_UART_POLICY_BLOCK) && can_wait) {
+			len = room;
+		} else if (STDIO_UART_POLICY == STDIO_UART_POLICY_OVERWRITE) {
+			if (len > STDIO_UART_BUFSIZE) {
+				stdio_uart.dropped += len - STDIO_UART_BUFSIZE;
+				ptr += len - STDIO_UART_BUFSIZE;
+				len = STDIO_UART_BUFSIZE;
+			}
+			uint32_t drop = len - room;
+			stdio_uart.tail += drop;
+			stdio_uart.dropped += drop;
+		} else {
+			stdio_uart.dropped += len - room;
+			len = room;
+		}
+	}
+	for (size_t done = 0; done < len;) {
+		uint32_t pos = (stdio_uart.head + done) % STDIO_UART_BUFSIZE;
+		size_t chunk = STDIO_UART_BUFSIZE - pos;
+		if (chunk > len - done)
+			chunk = len - done;
+		memcpy(&stdio_uart_ring[pos], ptr + done, chunk);
+		done += chunk;
+	}
+	stdio_uart.head += len;
+	return len;
+}
+
+/* Move up to one staging buffer worth of ring data into buf. */
+static uint32_t stdio_uart_ring_get(uint8_t *buf)
+{
+	uint32_t len = stdio_uart_used();
+	if (len > STDIO_UART_STAGE_SIZE)
+		len = STDIO_UART_STAGE_SIZE;
+	for (uint32_t done = 0; done < len;) {
+		uint32_t pos = (stdio_uart.tail + done) % STDIO_UART_BUFSIZE;
+		uint32_t chunk = STDIO_UART_BUFSIZE - pos;
+		if (chunk > len - done)
+			chunk = len - done;
+		memcpy(buf + done, &stdio_uart_ring[pos], chunk);
+		done += chunk;
+	}
+	stdio_uart.tail += len;
+	return len;
+}
+
+static inline void stdio_uart_send(uint8_t *buf, uint32_t len)
+{
+	hal_uart_enqueue(STDIO_UART_DEVICE_ID, (uint32_t)buf, len,
+			 UDMA_CORE_TX_CFG_EN_MASK |
+			 REG_SET(UDMA_CORE_TX_CFG_DATASIZE,
+				 UDMA_CORE_CFG_DATASIZE_8),
+			 TX_CHANNEL);
+}
+
+static inline int stdio_uart_tx_busy(void)
+{
+	return readw(STDIO_UART_TX_CFG(STDIO_UART_DEVICE_ID)) &
+	       UDMA_CORE_RX_CFG_EN_MASK;
+}
+
+/* Number of staging buffers the channel is not working on. The channel runs
+ * one transfer and keeps at most one pending. */
+static inline int stdio_uart_tx_free(void)
+{
+	uint32_t cfg = readw(STDIO_UART_TX_CFG(STDIO_UART_DEVICE_ID));
+	if (!(cfg & UDMA_CORE_RX_CFG_EN_MASK))
+		return 2;
+	return (cfg & UDMA_CORE_RX_CFG_PENDING_MASK) ? 0 : 1;
+}
+
+/* Send the ring content without relying on the drain task. */
+static void stdio_uart_flush_poll(void)
+{
+	uint32_t len;
+	while (stdio_uart_tx_busy())
+		;
+	while ((len = stdio_uart_ring_get(stdio_uart_stage[0])) != 0) {
+		stdio_uart_send(stdio_uart_stage[0], len);
+		while (stdio_uart_tx_busy())
+			;
+	}
+}
+
+/* Send all of ptr by polling, the ring is flushed whenever it is full. */
+static void stdio_uart_write_poll(const uint8_t *ptr, size_t len)
+{
+	while (len != 0) {
+		size_t room = STDIO_UART_BUFSIZE - stdio_uart_used();
+		size_t done = stdio_uart_ring_put(ptr, (len < room) ? len : room,
+						  0);
+		ptr += done;
+		len -= done;
+		stdio_uart_flush_poll();
+	}
+}
+
+#ifdef CONFIG_FREERTOS_KERNEL
+static void stdio_uart_tx_handler(void *arg)
+{
+	BaseType_t woken = pdFALSE;
+	(void)arg;
+	vTaskNotifyGiveFromISR(stdio_uart.drain, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+static void stdio_uart_drain(void *arg)
+{
+	(void)arg;
+	__atomic_store_n(&stdio_uart.init, 2, __ATOMIC_RELEASE);
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		/* Keep both staging buffers busy while there is data. */
+		while ((stdio_uart_used() != 0) &&
+		       (stdio_uart_tx_free() != 0)) {
+			uint8_t *buf = stdio_uart_stage[stdio_uart.stage_next];
+			xSemaphoreTake(stdio_uart.lock, portMAX_DELAY);
+			stdio_uart.locked = 1;
+			uint32_t len = stdio_uart_ring_get(buf);
+			TaskHandle_t waiter = stdio_uart.waiter;
+			stdio_uart.waiter = NULL;
+			stdio_uart.locked = 0;
+			xSemaphoreGive(stdio_uart.lock);
+			stdio_uart_send(buf, len);
+			stdio_uart.stage_next ^= 1;
+			if (waiter)
+				xTaskNotifyGive(waiter);
+		}
+	}
+}
+
+/* Create the drain task, the first caller does it, the others keep polling
+ * until it runs. */
+static void stdio_uart_start(void)
+{
+	uint32_t irq = __disable_irq();
+	uint32_t init = stdio_uart.init;
+	if (init == 0)
+		stdio_uart.init = 1;
+	__restore_irq(irq);
+	if (init != 0)
+		return;
+	stdio_uart.lock = xSemaphoreCreateMutex();
+	if (stdio_uart.lock == NULL ||
+	    xTaskCreate(stdio_uart_drain, "stdio", configMINIMAL_STACK_SIZE,
+			NULL, STDIO_UART_DRAIN_PRIORITY,
+			&stdio_uart.drain) != pdPASS)
+		return; /* stay in polling mode */
+	pi_fc_event_handler_set(SOC_EVENT_UDMA_UART_TX(STDIO_UART_DEVICE_ID),
+				stdio_uart_tx_handler, NULL);
+	hal_soc_eu_set_fc_mask(SOC_EVENT_UDMA_UART_TX(STDIO_UART_DEVICE_ID));
+}
+
+ssize_t stdio_uart_write(const void *ptr, size_t len)
+{
+	const uint8_t *data = ptr;
+	size_t left = len;
+
+	if (__atomic_load_n(&stdio_uart.init, __ATOMIC_ACQUIRE) == 0)
+		stdio_uart_start();
+
+	if (__atomic_load_n(&stdio_uart.init, __ATOMIC_ACQUIRE) != 2 ||
+	    stdio_uart.drain == NULL) {
+		/* No drain task yet, only one thread of execution. */
+		stdio_uart_write_poll(data, left);
+		return (ssize_t)len;
+	}
+
+	/* main() before the scheduler starts takes the polling path above */
+	if (irq_in_isr()) {
+		/* Interrupt handler, the lock holder was preempted. */
+		if (!stdio_uart.locked) {
+			BaseType_t woken = pdFALSE;
+			stdio_uart_ring_put(data, left, 0);
+			vTaskNotifyGiveFromISR(stdio_uart.drain, &woken);
+			portYIELD_FROM_ISR(woken);
+		} else {
+			stdio_uart.dropped += len;
+		}
+		return (ssize_t)len;
+	}
+
+	xSemaphoreTake(stdio_uart.lock, portMAX_DELAY);
+	stdio_uart.locked = 1;
+	for (;;) {
+		size_t done = stdio_uart_ring_put(data, left, 1);
+		data += done;
+		left -= done;
+		xTaskNotifyGive(stdio_uart.drain);
+		if (left == 0)
+			break;
+		/* Ring is full, wait for the drain task to take some. */
+		stdio_uart.waiter = xTaskGetCurrentTaskHandle();
+		stdio_uart.locked = 0;
+		xSemaphoreGive(stdio_uart.lock);
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		xSemaphoreTake(stdio_uart.lock, portMAX_DELAY);
+		stdio_uart.locked = 1;
+	}
+	stdio_uart.locked = 0;
+	xSemaphoreGive(stdio_uart.lock);
+	return (ssize_t)len;
+}
+#else
+ssize_t stdio_uart_write(const void *ptr, size_t len)
+{
+	stdio_uart_write_poll(ptr, len);
+	return (ssize_t)len;
+}
+#endif
+
+void stdio_uart_flush(void)
+{
+	uint32_t irq = __disable_irq();
+	stdio_uart_flush_poll();
+	__restore_irq(irq);
+}
@@ -39,6 +39,8 @@
 #include <sys/stat.h>
 #include <sys/timeb.h>
 #include <sys/time.h>
+#include <sys/times.h>
+#include <time.h>
 #include <newlib.h>
 #include <unistd.h>
 #include <errno.h>
@@ -53,15 +55,25 @@
 #include "apb_soc.h"
 #include "stdout.h"
 
-#if CONFIG_STDIO == STDIO_UART
+#if CONFIG_STDIO == STDIO_UART || CONFIG_STDIO == STDIO_BINLOG
 #include "udma.h"
 #include "udma_uart.h"
+
+/* stdio_uart.c */
+ssize_t stdio_uart_write(const void *ptr, size_t len);
+void stdio_uart_flush(void);
+#endif
+
+#if CONFIG_STDIO == STDIO_BINLOG
+#include "binlog.h"
 #endif
 
 /* FreeRTOS */
 #ifdef CONFIG_FREERTOS_KERNEL
 #include "FreeRTOS.h"
 #include "task.h"
+/* the drivers are only built with the kernel */
+#include "hrtimer.h"
 #endif
 
 #if !defined(configUSE_NEWLIB_REENTRANT) || (configUSE_NEWLIB_REENTRANT != 1)
@@ -141,7 +153,9 @@ int _execve(const char *name, char *const argv[], char *const env[])
 
 void _exit(int exit_status)
 {
-#if CONFIG_STDIO == STDIO_UART
+#if CONFIG_STDIO == STDIO_UART || CONFIG_STDIO == STDIO_BINLOG
+	/* send what is left in the stdio buffer */
+	stdio_uart_flush();
 	/* wait for the udma stdout to be emptied */
 	while (readw((UDMA_UART(STDIO_UART_DEVICE_ID) +
 		      UDMA_CHANNEL_TX_OFFSET +
@@ -201,12 +215,59 @@ int _getpid()
 	return 1;
 }
 
+/* There is no real time clock, the time counts from the first call. */
 int _gettimeofday(struct timeval *tp, void *tzp)
 {
+#ifdef CONFIG_FREERTOS_KERNEL
+	uint64_t us = hrtimer_get_us();
+	if (tp) {
+		tp->tv_sec = (time_t)(us / 1000000);
+		tp->tv_usec = (suseconds_t)(us % 1000000);
+	}
+	return 0;
+#else
 	errno = -ENOSYS;
 	return -1;
+#endif
+}
+
+#ifdef CONFIG_FREERTOS_KERNEL
+/* newlib only declares these with _POSIX_TIMERS */
+#ifndef CLOCK_REALTIME
+#define CLOCK_REALTIME ((clockid_t)1)
+#endif
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC ((clockid_t)4)
+#endif
+
+int clock_gettime(clockid_t clock_id, struct timespec *tp)
+{
+	if (clock_id != CLOCK_REALTIME && clock_id != CLOCK_MONOTONIC) {
+		errno = EINVAL;
+		return -1;
+	}
+	uint64_t cycles = hrtimer_get_cycles();
+	uint32_t freq = hrtimer_get_freq();
+	tp->tv_sec = (time_t)(cycles / freq);
+	tp->tv_nsec = (long)(cycles % freq * 1000000000 / freq);
+	return 0;
 }
 
+int clock_getres(clockid_t clock_id, struct timespec *res)
+{
+	if (clock_id != CLOCK_REALTIME && clock_id != CLOCK_MONOTONIC) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (res) {
+		res->tv_sec = 0;
+		res->tv_nsec = (long)((1000000000 + hrtimer_get_freq() - 1) /
+				      hrtimer_get_freq());
+	}
+	return 0;
+}
+#endif
+
 int _isatty(int file)
 {
 	return (file == STDOUT_FILENO);
@@ -264,9 +325,24 @@ long _sysconf(int name)
 	return -1;
 }
 
+/* All the time is accounted to the process as user time. */
 clock_t _times(struct tms *buf)
 {
+#ifdef CONFIG_FREERTOS_KERNEL
+	uint64_t cycles = hrtimer_get_cycles();
+	clock_t clk = (clock_t)(cycles / hrtimer_get_freq() * CLOCKS_PER_SEC +
+				cycles % hrtimer_get_freq() * CLOCKS_PER_SEC /
+					hrtimer_get_freq());
+	if (buf) {
+		buf->tms_utime = clk;
+		buf->tms_stime = 0;
+		buf->tms_cutime = 0;
+		buf->tms_cstime = 0;
+	}
+	return clk;
+#else
 	return 0;
+#endif
 }
 
 int _unlink(const char *name)
@@ -319,31 +395,9 @@ ssize_t _write(int file, const void *ptr, size_t len)
 				   (pulp_cluster_id() << 7)));
 	return (ssize_t)len;
 #elif CONFIG_STDIO == STDIO_UART
-	/* direct writes to uart udma*/
-	static char copyout_buf[STDIO_UART_BUFSIZE] = {0};
-
-	/* make sure we can issue a dma transfer, so wait until tx is done */
-	while (readw((UDMA_UART(STDIO_UART_DEVICE_ID) +
-		      UDMA_CHANNEL_TX_OFFSET +
-		      UDMA_CHANNEL_CFG_OFFSET)) & UDMA_CORE_RX_CFG_EN_MASK) {
-	}
-	/* TODO: there is a race condition here when multiple threads start
-	 * executing from here */
-
-	/* copy to tmp buffer so that when we later functions don't clobber our
-	 * buffer */
-	memcpy(copyout_buf, ptr, len < STDIO_UART_BUFSIZE ? len : STDIO_UART_BUFSIZE);
-
-	hal_uart_enqueue(STDIO_UART_DEVICE_ID, (uint32_t)copyout_buf, len,
-			 UDMA_CORE_TX_CFG_EN_MASK |
-			 REG_SET(UDMA_CORE_TX_CFG_DATASIZE, UDMA_CORE_CFG_DATASIZE_8),
-			 TX_CHANNEL);
-
-	/* We don't wait for the dma transfer to finish despite _write()'s
-	 * blocking semantics. This should be ok since we are the only one's
-	 * writing to uart */
-
-	return len < STDIO_UART_BUFSIZE ? len : STDIO_UART_BUFSIZE;
+	return stdio_uart_write(ptr, len);
+#elif CONFIG_STDIO == STDIO_BINLOG
+	return binlog_text(ptr, len);
 #elif CONFIG_STDIO == STDIO_NULL
 	/* just nop */
 	return len;
@@ -41,6 +41,8 @@
 #define CSR_MHARTID  0xf14
 #define CSR_MINTSTATUS 0x346
 #define CSR_MINTTHRESH 0x347
+#define CSR_MCOUNTINHIBIT 0x320
+#define CSR_MCYCLE   0xb00
 
 /* TODO: complete this */
 #define MSTATUS_IE BIT(3)
@@ -24,6 +24,9 @@
 #include "csr.h"
 #include "bits.h"
 #include "io.h"
+#ifdef CONFIG_CLIC
+#include "clic.h"
+#endif
 
 #define MSTATUS_ADDR  0x300 /*!< Machine Status Register */
 #define MISA_ADDR     0x301 /*!< ISA and Extensions Register */
@@ -148,15 +151,44 @@
 
 /**
   \brief   Restore the MIE bit
-  \details Restore the MIE bit of MSTATUS
+  \details Restore the MIE bit of MSTATUS, as returned by __disable_mie().
  */
-__attribute__((always_inline)) static inline void __restore_irq(uint32_t irq)
+__attribute__((always_inline)) static inline void __restore_mie(uint32_t irq)
 {
 	/* TODO: should probably read then write this register to not clear
 	 * unintended bits */
 	csr_write(MSTATUS_ADDR, irq);
 }
 
+/**
+  \brief   Disable all interrupts
+  \details Clears the MIE bit of MSTATUS and returns its previous value.
+	   Cluster cores, which have no CLIC, and code which must not be
+	   preempted by fast interrupts use this instead of __disable_irq().
+ */
+__attribute__((always_inline)) static inline uint32_t __disable_mie(void)
+{
+	return csr_read_clear(MSTATUS_ADDR, BIT(MSTATUS_MIE_Pos));
+}
+
+#ifdef CONFIG_CLIC
+/* mintthresh masking the levels of the kernel and normal interrupts */
+#define CLIC_IRQ_THRESH CLIC_LEVEL_THRESH(CLIC_MAX_SYSCALL_LEVEL)
+#endif
+
+/**
+  \brief   Restore interrupts
+  \details Undo __disable_irq(), irq is the value it returned.
+ */
+__attribute__((always_inline)) static inline void __restore_irq(uint32_t irq)
+{
+#ifdef CONFIG_CLIC
+	csr_write(CSR_MINTTHRESH, irq);
+#else
+	__restore_mie(irq);
+#endif
+}
+
 /**
   \brief   Enable IRQ Interrupts
   \details Enables IRQ interrupts by setting the MPIE-bit in the MSTATUS.
@@ -170,12 +202,22 @@ __attribute__((always_inline)) static inline void __enable_irq(void)
 /**
   \brief   Disable IRQ Interrupts
   \details Disables IRQ interrupts by clearing the MPIE-bit in the CPSR.
-	   Can only be executed in Privileged modes.
+	   Can only be executed in Privileged modes. With the CLIC, raises
+	   mintthresh to CLIC_IRQ_THRESH instead and leaves MIE set, so fast
+	   interrupts above CLIC_MAX_SYSCALL_LEVEL are never masked. Returns
+	   the value to pass to __restore_irq().
  */
 __attribute__((always_inline)) static inline uint32_t __disable_irq(void)
 {
-	uint32_t val = csr_read_clear(MSTATUS_ADDR, BIT(MSTATUS_MIE_Pos));
-	return val;
+#ifdef CONFIG_CLIC
+	/* handlers which change the threshold restore it before returning */
+	uint32_t thresh = csr_read(CSR_MINTTHRESH);
+	if (thresh < CLIC_IRQ_THRESH)
+		csr_write(CSR_MINTTHRESH, CLIC_IRQ_THRESH);
+	return thresh;
+#else
+	return __disable_mie();
+#endif
 }
 
 
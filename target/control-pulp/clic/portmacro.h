@@ -0,0 +1,63 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Kernel port overrides for the CLIC, found before the port's portmacro.h
+ * which is included from here.
+ *
+ * Kernel critical sections raise mintthresh to mask the kernel and normal
+ * interrupt levels instead of clearing MIE, so fast interrupts above
+ * CLIC_MAX_SYSCALL_LEVEL are never masked.
+ *
+ * mintthresh is not part of the task context saved by the port. A task can
+ * only be switched out in a critical section by yielding, portYIELD() keeps
+ * its threshold on its stack and unmasks for the other tasks. A task
+ * preempted by an interrupt was not in a critical section, so it runs again
+ * with the threshold vSystemIrqHandler found on entry.
+ */
+
+#ifndef __CLIC_PORTMACRO_H__
+#define __CLIC_PORTMACRO_H__
+
+#include_next "portmacro.h"
+
+#ifndef __ASSEMBLER__
+
+#include "csr.h"
+#include "clic.h"
+
+#undef portDISABLE_INTERRUPTS
+#undef portENABLE_INTERRUPTS
+#undef portYIELD
+
+#define portDISABLE_INTERRUPTS()                                               \
+	csr_write(CSR_MINTTHRESH,                                              \
+		  CLIC_LEVEL_THRESH(CLIC_MAX_SYSCALL_LEVEL))
+#define portENABLE_INTERRUPTS() csr_write(CSR_MINTTHRESH, 0)
+
+#define portYIELD()                                                            \
+	do {                                                                   \
+		unsigned long __thresh = csr_read(CSR_MINTTHRESH);             \
+		csr_write(CSR_MINTTHRESH, 0);                                  \
+		__asm volatile("ecall" ::: "memory");                          \
+		csr_write(CSR_MINTTHRESH, __thresh);                           \
+	} while (0)
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* __CLIC_PORTMACRO_H__ */
@@ -31,6 +31,10 @@ CV_CPPFLAGS += -I$(FREERTOS_PROJ_ROOT)/$(dir)/include
 
 ifeq ($(CONFIG_DRIVER_INT),clic)
 CV_LDFLAGS += -T$(FREERTOS_PROJ_ROOT)/$(dir)/link_clic.ld
+ifeq ($(CONFIG_FREERTOS_KERNEL),y)
+# critical sections on mintthresh, must come before the port's portmacro.h
+CV_CPPFLAGS := -I$(FREERTOS_PROJ_ROOT)/$(dir)/clic $(CV_CPPFLAGS)
+endif
 else
 CV_LDFLAGS += -T$(FREERTOS_PROJ_ROOT)/$(dir)/link.ld
 endif
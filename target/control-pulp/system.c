@@ -30,6 +30,11 @@
 #include "freq.h"
 #include "properties.h"
 #include "irq.h"
+#include "irq_latency.h"
+#include "trace.h"
+#ifdef CONFIG_CLIC
+#include "clic.h"
+#endif
 #include "soc_eu.h"
 #include "udma_ctrl.h"
 #include "udma_uart.h"
@@ -64,6 +69,8 @@ void cl_notify_fc_event_handler(void);
 void timer_irq_handler(void);
 void undefined_handler(void);
 void (*isr_table[ISR_TABLE_SIZE])(void);
+/* handlers running through vSystemIrqHandler, see irq_in_isr() */
+volatile uint32_t irq_nesting;
 
 /**
  * Board init code. Always call this before anything else.
@@ -72,6 +79,7 @@ void system_init(void)
 {
 	/* make sure irq (itc) is a good state */
 	pulp_irq_init();
+	irq_latency_reset();
 
 	/* Hook up isr table. This table is temporary until we figure out how to
 	 * do proper vectored interrupts.
@@ -100,7 +108,7 @@ void system_init(void)
 	irq_clint_enable(IRQ_FC_EVT_SOC_EVT);
 
 	/* enable uart as stdio*/
-#if CONFIG_STDIO == STDIO_UART
+#if CONFIG_STDIO == STDIO_UART || CONFIG_STDIO == STDIO_BINLOG
 	udma_ctrl_cg_disable(UDMA_UART_ID(STDIO_UART_DEVICE_ID));
 
 	int baudrate = STDIO_UART_BAUDRATE;
@@ -159,10 +167,37 @@ void vPortSetupTimerInterrupt(void)
 	timer_irq_init(ARCHI_REF_CLOCK / configTICK_RATE_HZ);
 	/* TODO: allow setting interrupt priority (to super high(?)) */
 	irq_enable(IRQ_FC_EVT_TIMER0_LO);
+#ifdef CONFIG_CLIC
+	/* Critical sections before the scheduler left the kernel levels masked
+	 * by the threshold. Mask with MIE instead until the first task starts,
+	 * its mstatus enables them. */
+	__disable_mie();
+	csr_write(CSR_MINTTHRESH, 0);
+#endif
 }
 
 void vSystemIrqHandler(uint32_t mcause)
 {
 	extern void (*isr_table[ISR_TABLE_SIZE])(void);
-	isr_table[mcause & (ISR_TABLE_SIZE-1)]();
+	int id = mcause & (ISR_TABLE_SIZE-1);
+	uint32_t start = irq_latency_enter(id);
+	irq_nesting++;
+	trace_irq_enter(id);
+#ifdef CONFIG_CLIC
+	/* Fast interrupts above the kernel levels may preempt the handler. The
+	 * trap handler has saved mepc and mstatus already, mcause holds the
+	 * previous interrupt level which a nested trap overwrites. */
+	uint32_t thresh = csr_read(CSR_MINTTHRESH);
+	csr_write(CSR_MINTTHRESH, CLIC_IRQ_THRESH);
+	__enable_irq();
+	isr_table[id]();
+	__disable_mie();
+	csr_write(CSR_MCAUSE, mcause);
+	csr_write(CSR_MINTTHRESH, thresh);
+#else
+	isr_table[id]();
+#endif
+	trace_irq_exit(id);
+	irq_nesting--;
+	irq_latency_exit(id, start);
 }
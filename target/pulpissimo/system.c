@@ -30,6 +30,8 @@
 #include "fc_event.h"
 #include "properties.h"
 #include "irq.h"
+#include "irq_latency.h"
+#include "trace.h"
 #include "soc_eu.h"
 #include "udma_ctrl.h"
 #include "udma_uart.h"
@@ -63,6 +65,8 @@ void vTaskSwitchContext(void);
 void timer_irq_handler(void);
 void undefined_handler(void);
 void (*isr_table[32])(void);
+/* handlers running through vSystemIrqHandler, see irq_in_isr() */
+volatile uint32_t irq_nesting;
 
 /**
  * Board init code. Always call this before anything else.
@@ -76,6 +80,7 @@ void system_init(void)
 
 	/* make sure irq (itc) is a good state */
 	pulp_irq_init();
+	irq_latency_reset();
 
 	/* Hook up isr table. This table is temporary until we figure out how to
 	 * do proper vectored interrupts.
@@ -97,7 +102,7 @@ void system_init(void)
 	irq_clint_global_enable();
 
 	/* enable uart as stdio*/
-#if CONFIG_STDIO == STDIO_UART
+#if CONFIG_STDIO == STDIO_UART || CONFIG_STDIO == STDIO_BINLOG
 	udma_ctrl_cg_disable(UDMA_UART_ID(STDIO_UART_DEVICE_ID));
 
 	int baudrate = STDIO_UART_BAUDRATE;
@@ -161,5 +166,12 @@ void vPortSetupTimerInterrupt(void)
 void vSystemIrqHandler(uint32_t mcause)
 {
 	extern void (*isr_table[32])(void);
-	isr_table[mcause & 0x1f]();
+	int id = mcause & 0x1f;
+	uint32_t start = irq_latency_enter(id);
+	irq_nesting++;
+	trace_irq_enter(id);
+	isr_table[id]();
+	trace_irq_exit(id);
+	irq_nesting--;
+	irq_latency_exit(id, start);
 }
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2021 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * A fast, hardware vectored interrupt preempts a handler running at the kernel
+ * level. Needs the CLIC (CONFIG_DRIVER_INT=clic).
+ */
+
+/* FreeRTOS kernel includes. */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* c stdlib */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* system includes */
+#include "system.h"
+#include "irq.h"
+#ifdef CONFIG_CLIC
+#include "clic.h"
+#endif
+
+/* pmsis */
+#include "target.h"
+#include "os.h"
+
+void vApplicationMallocFailedHook(void);
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
+
+#define KERNEL_IRQ IRQ_FC_EVT_SW5
+#define FAST_IRQ   IRQ_FC_EVT_SW6
+
+static volatile int fast_count;
+static volatile int kernel_count;
+static volatile int nested;
+
+#ifdef CONFIG_CLIC
+__attribute__((interrupt)) void fast_handler(void)
+{
+	fast_count++;
+}
+
+void kernel_handler(void)
+{
+	int count = fast_count;
+	irq_pend(FAST_IRQ);
+	for (int i = 0; i < 1000 && fast_count == count; i++)
+		;
+	nested = fast_count != count;
+	kernel_count++;
+}
+
+void restored_handler(void)
+{
+	kernel_count++;
+}
+
+static void wait_count(volatile int *count, int n)
+{
+	for (int i = 0; i < 100 && *count < n; i++)
+		vTaskDelay(1);
+}
+
+static void test_nesting(void)
+{
+	if (irq_set_fast_handler(FAST_IRQ, fast_handler,
+				 CLIC_MAX_SYSCALL_LEVEL, 0) != -1) {
+		printf("fast handler accepted at the kernel level\n");
+		exit(1);
+	}
+	if (irq_set_fast_handler(FAST_IRQ, fast_handler,
+				 CLIC_MAX_SYSCALL_LEVEL + 1, 0)) {
+		printf("failed to set fast handler\n");
+		exit(1);
+	}
+	irq_set_handler(KERNEL_IRQ, kernel_handler);
+	irq_enable(FAST_IRQ);
+	irq_enable(KERNEL_IRQ);
+
+	/* straight from a task */
+	irq_pend(FAST_IRQ);
+	wait_count(&fast_count, 1);
+	if (fast_count != 1) {
+		printf("fast handler not run\n");
+		exit(1);
+	}
+	printf("fast handler ok\n");
+
+	irq_pend(KERNEL_IRQ);
+	wait_count(&kernel_count, 1);
+	if (kernel_count != 1 || !nested) {
+		printf("fast handler did not preempt the kernel level one\n");
+		exit(1);
+	}
+	printf("nesting ok\n");
+
+	/* back through the trap handler */
+	irq_disable(KERNEL_IRQ);
+	irq_set_handler(FAST_IRQ, restored_handler);
+	irq_pend(FAST_IRQ);
+	wait_count(&kernel_count, 2);
+	if (kernel_count != 2 || fast_count != 2) {
+		printf("handler not restored\n");
+		exit(1);
+	}
+	printf("restore ok\n");
+
+	irq_disable(FAST_IRQ);
+	exit(0);
+}
+#else
+static void test_nesting(void)
+{
+	printf("no clic, skipped\n");
+	exit(0);
+}
+#endif
+
+int main(void)
+{
+	/* Init board hardware. */
+	system_init();
+
+	printf("clic nesting test\n");
+	return pmsis_kickoff((void *)test_nesting);
+}
+
+/* Some debugging help */
+void vApplicationMallocFailedHook(void)
+{
+	taskDISABLE_INTERRUPTS();
+	printf("error: application malloc failed\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+	(void)pcTaskName;
+	(void)pxTask;
+
+	taskDISABLE_INTERRUPTS();
+	printf("error: stack overflow\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * All processing elements write a line to the uart at the same time through
+ * pi_cl_uart_write(). The requests are delegated to the FC in batches. Each
+ * core sleeps on its event unit in pi_cl_uart_write_wait() until the FC has
+ * completed its request, which is checked to be done and successful.
+ */
+
+/* FreeRTOS kernel includes. */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* c stdlib */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/* system includes */
+#include "system.h"
+
+/* pmsis */
+#include "cluster/fc_to_cl_delegate.h"
+#include "cluster/event_unit.h"
+#include "device.h"
+#include "target.h"
+#include "os.h"
+#include "pmsis_task.h"
+#include "uart.h"
+
+#define NB_LINES 4
+
+void vApplicationMallocFailedHook(void);
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
+
+static struct pi_device uart;
+static volatile uint32_t lines_done;
+static volatile uint32_t errors;
+
+static void pe_entry(void *arg)
+{
+	pi_cl_uart_req_t req;
+	char msg[32];
+	uint32_t done = 0;
+	uint32_t err = 0;
+
+	for (int i = 0; i < NB_LINES; i++) {
+		/* msg lives in L1, the FC bounces it through L2. */
+		int len = sprintf(msg, "[%" PRIu32 " %" PRIu32 "] line %d\n",
+				  pi_cluster_id(), pi_core_id(), i);
+		pi_cl_uart_write(&uart, msg, (uint32_t)len, &req);
+		pi_cl_uart_write_wait(&req);
+		/* the wait must only return once the FC signalled the end */
+		if (!req.done || pi_task_status_get(&req.task))
+			err++;
+		else
+			done++;
+	}
+
+	hal_eu_mutex_lock(0);
+	lines_done += done;
+	errors += err;
+	hal_eu_mutex_unlock(0);
+}
+
+static void cluster_entry(void *arg)
+{
+	pi_cl_team_fork(0, pe_entry, NULL);
+}
+
+static int test_entry(void)
+{
+	struct pi_device cluster_dev;
+	struct pi_cluster_conf cl_conf;
+	struct pi_cluster_task cluster_task;
+	struct pi_uart_conf conf;
+
+	pi_uart_conf_init(&conf);
+	conf.enable_tx = 1;
+	conf.enable_rx = 0;
+	conf.baudrate_bps = 115200;
+
+	pi_open_from_conf(&uart, &conf);
+	if (pi_uart_open(&uart)) {
+		printf("UART open failed !\n");
+		return -1;
+	}
+
+	pi_cluster_conf_init(&cl_conf);
+	pi_open_from_conf(&cluster_dev, &cl_conf);
+	if (pi_cluster_open(&cluster_dev))
+		return -1;
+
+	pi_cluster_send_task_to_cl(
+		&cluster_dev,
+		pi_cluster_task(&cluster_task, cluster_entry, NULL));
+
+	if (errors ||
+	    lines_done != NB_LINES * (uint32_t)pi_cl_cluster_nb_cores()) {
+		printf("cl_uart: %" PRIu32 " lines written, %" PRIu32
+		       " errors\n", lines_done, errors);
+		return -1;
+	}
+	return 0;
+}
+
+static void test_kickoff(void *arg)
+{
+	int ret = test_entry();
+	pmsis_exit(ret);
+}
+
+int main(void)
+{
+	system_init();
+
+	return pmsis_kickoff((void *)test_kickoff);
+}
+
+void vApplicationMallocFailedHook(void)
+{
+	taskDISABLE_INTERRUPTS();
+	printf("error: application malloc failed\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+	(void)pcTaskName;
+	(void)pxTask;
+
+	taskDISABLE_INTERRUPTS();
+	printf("error: stack overflow\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Run pi_task callbacks through the event kernel: immediate pushes, pushes
+ * which overflow the task ring, delayed pushes, completion groups and pushes
+ * from an interrupt handler.
+ */
+
+/* FreeRTOS kernel includes. */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* c stdlib */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+
+/* system includes */
+#include "system.h"
+#include "timer.h"
+#include "timer_irq.h"
+#include "fll.h"
+#include "irq.h"
+#include "gpio.h"
+
+/* pmsis */
+#include "target.h"
+#include "os.h"
+#include "pmsis_task.h"
+#include "event_kernel.h"
+
+void vApplicationMallocFailedHook(void);
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
+
+#define NB_CALLBACKS 4
+
+static pi_task_t tasks[NB_CALLBACKS];
+static volatile int order[NB_CALLBACKS];
+static volatile int nb_called;
+static volatile TickType_t called_at[NB_CALLBACKS];
+
+/* the kernel is not woken up while the scheduler is suspended, this many
+ * pushes fill the task ring and go on in the overflow list */
+#define NB_OVERFLOW (2 * PI_EVENT_KERNEL_RING_SIZE)
+
+static pi_task_t seq_tasks[NB_OVERFLOW];
+static volatile int seq_order[NB_OVERFLOW];
+static volatile int nb_seq;
+
+static pi_task_t isr_tasks[NB_CALLBACKS];
+
+/* runs only while the main task sleeps */
+static volatile uint32_t background_count;
+
+static void background(void *arg)
+{
+	for (;;)
+		background_count++;
+}
+
+static void callback(void *arg)
+{
+	int id = (int)arg;
+	called_at[id] = xTaskGetTickCount();
+	order[nb_called++] = id;
+}
+
+static void seq_callback(void *arg)
+{
+	seq_order[nb_seq++] = (int)arg;
+}
+
+void timer1_handler(void)
+{
+	/* one shot */
+	irq_disable(IRQ_FC_EVT_TIMER0_HI);
+	for (int i = 0; i < NB_CALLBACKS; i++)
+		pi_task_push(&isr_tasks[i]);
+}
+
+static int check_seq(int n, const char *name)
+{
+	for (int i = 0; i < 1000 && nb_seq < n; i++)
+		vTaskDelay(1);
+	if (nb_seq != n) {
+		printf("%s: %d of %d callbacks run\n", name, nb_seq, n);
+		return -1;
+	}
+	for (int i = 0; i < n; i++) {
+		if (seq_order[i] != i) {
+			printf("%s: callback %d ran as %d\n", name, seq_order[i],
+			       i);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void wait_called(int n)
+{
+	for (int i = 0; i < 1000 && nb_called < n; i++)
+		vTaskDelay(1);
+}
+
+static void test_events(void)
+{
+	/* immediate pushes run in order */
+	for (int i = 0; i < NB_CALLBACKS; i++) {
+		pi_task_callback(&tasks[i], callback, (void *)i);
+		pi_task_push(&tasks[i]);
+	}
+	wait_called(NB_CALLBACKS);
+	for (int i = 0; i < NB_CALLBACKS; i++) {
+		if (order[i] != i) {
+			printf("callback %d ran as %d\n", order[i], i);
+			exit(1);
+		}
+	}
+	printf("push ok\n");
+
+	/* full ring, the overflow runs after it in push order */
+	nb_seq = 0;
+	vTaskSuspendAll();
+	for (int i = 0; i < NB_OVERFLOW; i++) {
+		pi_task_callback(&seq_tasks[i], seq_callback, (void *)i);
+		pi_task_push(&seq_tasks[i]);
+	}
+	xTaskResumeAll();
+	if (check_seq(NB_OVERFLOW, "overflow"))
+		exit(1);
+	printf("push overflow ok\n");
+
+	/* delayed pushes run by expiry, not by push order */
+	nb_called = 0;
+	TickType_t start = xTaskGetTickCount();
+	for (int i = 0; i < NB_CALLBACKS; i++) {
+		pi_task_callback(&tasks[i], callback, (void *)i);
+		pi_task_push_delayed_us(&tasks[i],
+					(NB_CALLBACKS - i) * 10000);
+	}
+	wait_called(NB_CALLBACKS);
+	for (int i = 0; i < NB_CALLBACKS; i++) {
+		int id = order[i];
+		TickType_t delay = pdMS_TO_TICKS((NB_CALLBACKS - id) * 10);
+		if (id != NB_CALLBACKS - 1 - i) {
+			printf("delayed callback %d ran as %d\n", id, i);
+			exit(1);
+		}
+		if (called_at[id] - start < delay) {
+			printf("delayed callback %d early: %" PRIu32 " < %" PRIu32
+			       " ticks\n", id, (uint32_t)(called_at[id] - start),
+			       (uint32_t)delay);
+			exit(1);
+		}
+	}
+	printf("push delayed ok\n");
+
+	/* blocking task released after the delay, the waiter sleeps */
+	if (xTaskCreate(background, "background", configMINIMAL_STACK_SIZE,
+			NULL, tskIDLE_PRIORITY, NULL) != pdPASS) {
+		printf("failed to create task\n");
+		exit(1);
+	}
+	pi_task_t block;
+	pi_task_block(&block);
+	start = xTaskGetTickCount();
+	uint32_t count = background_count;
+	pi_task_push_delayed_us(&block, 5000);
+	pi_task_wait_on(&block);
+	if (xTaskGetTickCount() - start < pdMS_TO_TICKS(5)) {
+		printf("blocking task released early\n");
+		exit(1);
+	}
+	if (background_count == count) {
+		printf("waiter did not sleep\n");
+		exit(1);
+	}
+	printf("release delayed ok\n");
+
+	/* completion groups */
+	pi_task_group_t group;
+	pi_task_group_init(&group);
+	for (int i = 0; i < 3; i++) {
+		pi_task_block(&tasks[i]);
+		if (pi_task_group_add(&group, &tasks[i]) != i) {
+			printf("wrong group index\n");
+			exit(1);
+		}
+	}
+	pi_task_push_delayed_us(&tasks[0], 30000);
+	pi_task_push_delayed_us(&tasks[1], 10000);
+	pi_task_push_delayed_us(&tasks[2], 20000);
+	if (pi_task_wait_any(&group, 1000) != -1) {
+		printf("wait any did not time out\n");
+		exit(1);
+	}
+	int expected[] = {1, 2, 0};
+	for (int i = 0; i < 3; i++) {
+		int index = pi_task_wait_any(&group, PI_TASK_WAIT_FOREVER);
+		if (index != expected[i]) {
+			printf("wait any returned %d instead of %d\n", index,
+			       expected[i]);
+			exit(1);
+		}
+	}
+	if (pi_task_wait_any(&group, PI_TASK_WAIT_FOREVER) != -1) {
+		printf("wait any on an empty group\n");
+		exit(1);
+	}
+	pi_task_block(&tasks[0]);
+	pi_task_block(&tasks[1]);
+	pi_task_push(&tasks[0]);
+	pi_task_push_delayed_us(&tasks[1], 10000);
+	pi_task_group_add(&group, &tasks[0]);
+	pi_task_group_add(&group, &tasks[1]);
+	if (pi_task_wait_all(&group, 50000) != 0 || !tasks[1].done) {
+		printf("wait all failed\n");
+		exit(1);
+	}
+	printf("completion groups ok\n");
+
+	/* pushes from an interrupt handler */
+	nb_seq = 0;
+	for (int i = 0; i < NB_CALLBACKS; i++)
+		pi_task_callback(&isr_tasks[i], seq_callback, (void *)i);
+	irq_set_handler(FC_TIMER1_IRQN, timer1_handler);
+	writew(1, (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_RESET_HI_OFFSET));
+	writew(ARCHI_REF_CLOCK / 1000,
+	       (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CMP_HI_OFFSET));
+	writew(TIMER_CFG_HI_ENABLE_MASK | TIMER_CFG_HI_RESET_MASK |
+		       TIMER_CFG_HI_CLKCFG_MASK | TIMER_CFG_HI_MODE_MASK |
+		       TIMER_CFG_HI_IRQEN_MASK,
+	       (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CFG_HI_OFFSET));
+	irq_enable(IRQ_FC_EVT_TIMER0_HI);
+	irq_clint_enable(IRQ_FC_EVT_TIMER0_HI);
+	if (check_seq(NB_CALLBACKS, "push from isr"))
+		exit(1);
+	printf("push from isr ok\n");
+
+	exit(0);
+}
+
+int main(void)
+{
+	/* Init board hardware. */
+	system_init();
+
+	printf("event kernel test\n");
+	return pmsis_kickoff((void *)test_events);
+}
+
+/* Some debugging help */
+void vApplicationMallocFailedHook(void)
+{
+	taskDISABLE_INTERRUPTS();
+	printf("error: application malloc failed\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+	(void)pcTaskName;
+	(void)pxTask;
+
+	taskDISABLE_INTERRUPTS();
+	printf("error: stack overflow\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2021 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * High resolution clock and sub-tick one shot and periodic timers.
+ */
+
+/* FreeRTOS kernel includes. */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* c stdlib */
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/time.h>
+
+/* system includes */
+#include "system.h"
+#include "hrtimer.h"
+
+/* pmsis */
+#include "target.h"
+#include "os.h"
+#include "pmsis_task.h"
+
+void vApplicationMallocFailedHook(void);
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
+
+#define ONE_SHOT_US 300
+#define PERIOD_US   100
+#define NB_PERIODS  10
+/* interrupt entry and handling */
+#define SLACK_US 50
+
+/* newlib only declares these with _POSIX_TIMERS */
+#ifndef CLOCK_REALTIME
+#define CLOCK_REALTIME ((clockid_t)1)
+#endif
+int clock_gettime(clockid_t clock_id, struct timespec *tp);
+
+static pi_task_t done;
+static volatile uint64_t fired_at[NB_PERIODS];
+static volatile int nb_fired;
+
+static void one_shot(void *arg)
+{
+	fired_at[0] = hrtimer_get_us();
+	pi_task_push(&done);
+}
+
+static void periodic(void *arg)
+{
+	struct hrtimer *timer = arg;
+	fired_at[nb_fired++] = hrtimer_get_us();
+	if (nb_fired == NB_PERIODS) {
+		hrtimer_stop(timer);
+		pi_task_push(&done);
+	}
+}
+
+static void test_hrtimer(void)
+{
+	struct hrtimer timer;
+
+	/* the clock */
+	uint64_t prev = hrtimer_get_cycles();
+	for (int i = 0; i < 100; i++) {
+		uint64_t now = hrtimer_get_cycles();
+		if (now < prev) {
+			printf("clock went backwards\n");
+			exit(1);
+		}
+		prev = now;
+	}
+	struct timespec ts;
+	struct timeval tv;
+	if (clock_gettime(0, &ts) != -1) {
+		printf("clock_gettime accepted a bad clock id\n");
+		exit(1);
+	}
+	if (clock_gettime(CLOCK_REALTIME, &ts) || gettimeofday(&tv, NULL)) {
+		printf("clock_gettime or gettimeofday failed\n");
+		exit(1);
+	}
+	if (tv.tv_sec < ts.tv_sec || (tv.tv_sec == ts.tv_sec &&
+				      tv.tv_usec < ts.tv_nsec / 1000)) {
+		printf("gettimeofday behind clock_gettime\n");
+		exit(1);
+	}
+	printf("clock ok, %" PRIu32 " Hz\n", hrtimer_get_freq());
+
+	/* one shot, well below the tick period */
+	pi_task_block(&done);
+	hrtimer_setup(&timer, one_shot, NULL);
+	uint64_t start = hrtimer_get_us();
+	hrtimer_start(&timer, ONE_SHOT_US, 0);
+	pi_task_wait_on(&done);
+	uint64_t delay = fired_at[0] - start;
+	printf("one shot of %d us after %" PRIu32 " us\n", ONE_SHOT_US,
+	       (uint32_t)delay);
+	if (delay < ONE_SHOT_US || delay > ONE_SHOT_US + SLACK_US) {
+		printf("one shot timer off\n");
+		exit(1);
+	}
+
+	/* periodic, stops itself */
+	pi_task_block(&done);
+	hrtimer_setup(&timer, periodic, &timer);
+	start = hrtimer_get_us();
+	hrtimer_start(&timer, PERIOD_US, PERIOD_US);
+	pi_task_wait_on(&done);
+	for (int i = 0; i < NB_PERIODS; i++) {
+		uint64_t due = start + (uint64_t)(i + 1) * PERIOD_US;
+		if (fired_at[i] < due || fired_at[i] > due + SLACK_US) {
+			printf("period %d at %" PRIu32 " us instead of %" PRIu32
+			       " us\n", i, (uint32_t)(fired_at[i] - start),
+			       (uint32_t)(due - start));
+			exit(1);
+		}
+	}
+	printf("periodic ok\n");
+	exit(0);
+}
+
+int main(void)
+{
+	/* Init board hardware. */
+	system_init();
+
+	printf("hrtimer test\n");
+	return pmsis_kickoff((void *)test_hrtimer);
+}
+
+/* Some debugging help */
+void vApplicationMallocFailedHook(void)
+{
+	taskDISABLE_INTERRUPTS();
+	printf("error: application malloc failed\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+	(void)pcTaskName;
+	(void)pxTask;
+
+	taskDISABLE_INTERRUPTS();
+	printf("error: stack overflow\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
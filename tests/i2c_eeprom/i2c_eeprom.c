@@ -55,6 +55,11 @@ void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
 
 static struct pi_device i2c;
 
+/* Spans several 255 bytes command chunks */
+#define LONG_READ_SIZE 600
+static uint8_t long_rx[LONG_READ_SIZE];
+static uint8_t short_rx[LONG_READ_SIZE];
+
 void eeprom(void)
 {
 	/* initalize i2c */
@@ -143,6 +148,59 @@ void eeprom(void)
 	}
 	if (error != 0)
 		exit(1);
+
+	/* More than 255 bytes take several command chunks, check it against
+	 * reads short enough for a single one. */
+	printf("reading %d bytes at once\n", LONG_READ_SIZE);
+	res = pi_i2c_write(&i2c, eeprom_addr, sizeof(eeprom_addr),
+			   PI_I2C_XFER_START | PI_I2C_XFER_STOP);
+	res |= pi_i2c_read(&i2c, long_rx, LONG_READ_SIZE,
+			   PI_I2C_XFER_START | PI_I2C_XFER_STOP);
+	res |= pi_i2c_write(&i2c, eeprom_addr, sizeof(eeprom_addr),
+			    PI_I2C_XFER_START | PI_I2C_XFER_STOP);
+	for (int i = 0; i < LONG_READ_SIZE; i += 100) {
+		int len = LONG_READ_SIZE - i < 100 ? LONG_READ_SIZE - i : 100;
+		res |= pi_i2c_read(&i2c, &short_rx[i], len,
+				   PI_I2C_XFER_START | PI_I2C_XFER_STOP);
+	}
+	if (res != PI_OK) {
+		printf("long read failed\n");
+		exit(1);
+	}
+	if (memcmp(long_rx, short_rx, LONG_READ_SIZE) ||
+	    memcmp(long_rx, expected_rx, sizeof(expected_rx))) {
+		printf("long read differs\n");
+		exit(1);
+	}
+	printf("long read ok\n");
+
+	/* Queued back to back, the read is prepared while the write runs. */
+	pi_task_t write_task, read_task;
+	memset(rx, 0, sizeof(rx));
+	pi_task_block(&write_task);
+	pi_task_block(&read_task);
+	pi_i2c_write_async(&i2c, eeprom_addr, sizeof(eeprom_addr),
+			   PI_I2C_XFER_START | PI_I2C_XFER_STOP, &write_task);
+	pi_i2c_read_async(&i2c, rx, sizeof(rx),
+			  PI_I2C_XFER_START | PI_I2C_XFER_STOP, &read_task);
+	pi_task_wait_on(&write_task);
+	pi_task_wait_on(&read_task);
+	pi_task_destroy(&write_task);
+	pi_task_destroy(&read_task);
+	if (memcmp(rx, expected_rx, sizeof(expected_rx))) {
+		printf("queued read differs\n");
+		exit(1);
+	}
+	printf("queued read ok\n");
+
+	/* Address and data in a single transfer with a repeated start. */
+	memset(rx, 0, sizeof(rx));
+	pi_i2c_write_read(&i2c, eeprom_addr, rx, sizeof(eeprom_addr), sizeof(rx));
+	if (memcmp(rx, expected_rx, sizeof(expected_rx))) {
+		printf("write-read differs\n");
+		exit(1);
+	}
+	printf("write-read ok\n");
 	exit(0);
 }
 
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Raise a software interrupt which wakes a task through the event kernel, check
+ * that the kernel tick entries were measured and print the recorded latencies.
+ */
+
+/* FreeRTOS kernel includes. */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* c stdlib */
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+/* system includes */
+#include "system.h"
+#include "irq.h"
+#include "irq_latency.h"
+
+/* pmsis */
+#include "target.h"
+#include "os.h"
+#include "pmsis_task.h"
+
+void vApplicationMallocFailedHook(void);
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
+
+#define SW_IRQ    IRQ_FC_EVT_SW5
+#define NB_RAISES 100
+
+static pi_task_t task;
+
+void sw_handler(void)
+{
+	pi_task_push(&task);
+}
+
+static void test_latency(void)
+{
+	struct irq_latency_stat entry, handler;
+
+	irq_latency_reset();
+	irq_set_handler(SW_IRQ, sw_handler);
+	irq_enable(SW_IRQ);
+
+	for (int i = 0; i < NB_RAISES; i++) {
+		pi_task_block(&task);
+		irq_latency_raise(SW_IRQ);
+		irq_pend(SW_IRQ);
+		pi_task_wait_on(&task);
+	}
+	irq_disable(SW_IRQ);
+
+	if (irq_latency_get(SW_IRQ, &entry, &handler)) {
+		printf("line %d not instrumented\n", SW_IRQ);
+		exit(1);
+	}
+	if (entry.count != NB_RAISES || handler.count != NB_RAISES) {
+		printf("recorded %" PRIu32 " entries, %" PRIu32
+		       " handlers instead of %d\n",
+		       entry.count, handler.count, NB_RAISES);
+		exit(1);
+	}
+	if (entry.min > entry.max || handler.min > handler.max) {
+		printf("min above max\n");
+		exit(1);
+	}
+
+	/* the tick entry is measured from the timer compare match */
+	vTaskDelay(2);
+	irq_latency_get(IRQ_FC_EVT_TIMER0_LO, &entry, &handler);
+	if (entry.count == 0 || entry.count != handler.count) {
+		printf("recorded %" PRIu32 " tick entries for %" PRIu32
+		       " handlers\n",
+		       entry.count, handler.count);
+		exit(1);
+	}
+	irq_latency_dump();
+	exit(0);
+}
+
+int main(void)
+{
+	/* Init board hardware. */
+	system_init();
+
+	printf("irq latency test\n");
+	return pmsis_kickoff((void *)test_latency);
+}
+
+/* Some debugging help */
+void vApplicationMallocFailedHook(void)
+{
+	taskDISABLE_INTERRUPTS();
+	printf("error: application malloc failed\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+	(void)pcTaskName;
+	(void)pxTask;
+
+	taskDISABLE_INTERRUPTS();
+	printf("error: stack overflow\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Measure the SoC events per second sustained by fc_soc_event_handler. First
+ * a single software event is raised at a time, which costs one interrupt
+ * entry per event as before the FIFO was drained. Then bursts of the eight
+ * software events are raised at once, so the FIFO holds several events on
+ * each interrupt entry. Each handler counts through the argument it was
+ * registered with, every event must be handled exactly once.
+ */
+
+/* FreeRTOS kernel includes. */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* c stdlib */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/* system includes */
+#include "system.h"
+#include "csr.h"
+#include "irq.h"
+#include "soc_eu.h"
+#include "fc_event.h"
+
+/* pmsis */
+#include "target.h"
+#include "os.h"
+
+void vApplicationMallocFailedHook(void);
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
+
+#define BENCH_BURSTS 1000
+
+static volatile uint32_t counts[NB_SW_EVENTS];
+static volatile uint32_t total;
+
+static inline uint32_t cycles(void)
+{
+	return csr_read(CSR_MCYCLE);
+}
+
+static void count_event(void *arg)
+{
+	(*(volatile uint32_t *)arg)++;
+	total++;
+}
+
+/* Raise bursts of nb_events software events at once, returns the cycles per
+ * event. */
+static uint32_t run(int nb_events, int *errors)
+{
+	uint32_t mask = (1u << nb_events) - 1;
+
+	total = 0;
+	for (int i = 0; i < NB_SW_EVENTS; i++) {
+		counts[i] = 0;
+	}
+
+	uint32_t start = cycles();
+	for (uint32_t i = 1; i <= BENCH_BURSTS; i++) {
+		hal_soc_eu_set_mask(mask);
+		while (total < i * (uint32_t)nb_events)
+			;
+	}
+	uint32_t elapsed = cycles() - start;
+
+	for (int i = 0; i < NB_SW_EVENTS; i++) {
+		uint32_t expected = (i < nb_events) ? BENCH_BURSTS : 0;
+		if (counts[i] != expected) {
+			printf("burst %d: event %d handled %" PRIu32
+			       " times\n", nb_events, i, counts[i]);
+			(*errors)++;
+		}
+	}
+
+	uint64_t per_sec = (uint64_t)total * system_core_clock_get() / elapsed;
+	printf("bursts of %d: %" PRIu32 " events in %" PRIu32
+	       " cycles, %" PRIu32 " cycles per event, %" PRIu32
+	       " events/s\n",
+	       nb_events, total, elapsed, elapsed / total, (uint32_t)per_sec);
+	return elapsed / total;
+}
+
+static void bench(void)
+{
+	int errors = 0;
+
+	/* Enable the cycle counter. */
+	csr_write(CSR_MCOUNTINHIBIT, 0);
+
+	for (int i = 0; i < NB_SW_EVENTS; i++) {
+		pi_fc_event_handler_set(SOC_EVENT_SW(i), count_event,
+					(void *)&counts[i]);
+		hal_soc_eu_set_fc_mask(SOC_EVENT_SW(i));
+	}
+
+	/* one interrupt entry per event */
+	uint32_t single = run(1, &errors);
+	/* several events drained per interrupt entry */
+	uint32_t drained = run(NB_SW_EVENTS, &errors);
+	printf("soc events: %" PRIu32 " cycles per event alone, %" PRIu32
+	       " drained in bursts\n", single, drained);
+
+	for (int i = 0; i < NB_SW_EVENTS; i++) {
+		hal_soc_eu_clear_fc_mask(SOC_EVENT_SW(i));
+		pi_fc_event_handler_clear(SOC_EVENT_SW(i));
+	}
+
+	if (errors) {
+		printf("soc events: %d errors\n", errors);
+		pmsis_exit(EXIT_FAILURE);
+	}
+	pmsis_exit(EXIT_SUCCESS);
+}
+
+/* Program Entry. */
+int main(void)
+{
+	/* Init board hardware. */
+	system_init();
+
+	return pmsis_kickoff((void *)bench);
+}
+
+void vApplicationMallocFailedHook(void)
+{
+	taskDISABLE_INTERRUPTS();
+	printf("error: application malloc failed\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+	(void)pcTaskName;
+	(void)pxTask;
+
+	taskDISABLE_INTERRUPTS();
+	printf("error: stack overflow\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
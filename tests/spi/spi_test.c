@@ -60,6 +60,9 @@
 
 #define NB_BUFFERS 4
 
+/* more than one 8 KiB chunk, the last one is not a multiple of a word */
+#define TAIL_SIZE (8192 + 2)
+
 void vApplicationMallocFailedHook(void);
 void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
 
@@ -103,6 +106,56 @@ static void set_spim_verif_command(struct pi_device *spim, int cmd, int addr,
 		pi_spi_send(spim, cmd_buffer, 8 * 8, PI_SPI_CS_AUTO);
 }
 
+/* A transfer split in chunks whose last one is sent in bytes. */
+static int test_tail(struct pi_device *spim)
+{
+	int error = 0;
+	uint8_t *tx = pmsis_l2_malloc(TAIL_SIZE);
+	uint8_t *rx = pmsis_l2_malloc(TAIL_SIZE);
+	if ((tx == NULL) || (rx == NULL))
+		return -1;
+
+	printf("transfer of %d bytes\n", TAIL_SIZE);
+	for (int i = 0; i < TAIL_SIZE; i++) {
+		tx[i] = i * 7 + 3;
+		rx[i] = 0;
+	}
+	set_spim_verif_command(spim, 0x1, 0, TAIL_SIZE, cmd_buffer[0], NULL);
+	pi_spi_send(spim, tx, TAIL_SIZE * 8, PI_SPI_CS_AUTO);
+	set_spim_verif_command(spim, 0x2, 0, TAIL_SIZE, cmd_buffer[0], NULL);
+	pi_spi_receive(spim, rx, TAIL_SIZE * 8, PI_SPI_CS_AUTO);
+
+	for (int i = 0; i < TAIL_SIZE; i++) {
+		if (rx[i] != tx[i]) {
+			printf("tail: first error at index %d, expected 0x%x, "
+			       "got 0x%x\n",
+			       i, tx[i], rx[i]);
+			error = -1;
+			break;
+		}
+	}
+	pmsis_l2_malloc_free(tx, TAIL_SIZE);
+	pmsis_l2_malloc_free(rx, TAIL_SIZE);
+	return error;
+}
+
+/* Full duplex has no quad mode, the transfer must fail without being sent. */
+static int test_quad_full_duplex(struct pi_device *spim)
+{
+	static uint32_t tx[4], rx[4];
+	pi_task_t task;
+
+	pi_task_block(&task);
+	pi_spi_transfer_async(spim, tx, rx, sizeof(tx) * 8,
+			      PI_SPI_CS_AUTO | PI_SPI_LINES_QUAD, &task);
+	pi_task_wait_on(&task);
+	if (pi_task_status_get(&task) != -1) {
+		printf("quad full duplex transfer was not rejected\n");
+		return -1;
+	}
+	return 0;
+}
+
 static int test_entry()
 {
 	struct pi_spi_conf conf;
@@ -252,6 +305,11 @@ static int test_entry()
 		}
 	}
 
+	if (!error)
+		error = test_tail(&spim);
+	if (!error)
+		error = test_quad_full_duplex(&spim);
+
 	if (error) {
 		printf("Got %d errors\n", error);
 	} else {
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Test a SPI NOR flash on chip select 0 of SPI master 0. Programs a pattern,
+ * reads it back aligned and unaligned, with and without the read cache, and
+ * checks that a cached read hits. Streams the pattern in small sequential
+ * reads through a cache of one and of several lines. Then closes the device with asynchronous
+ * operations still queued and checks that all of them complete.
+ */
+
+/* FreeRTOS kernel includes. */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* c stdlib */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/* system includes */
+#include "system.h"
+#include "csr.h"
+
+/* pmsis */
+#include "target.h"
+#include "os.h"
+#include "device.h"
+#include "pmsis_task.h"
+#include "spiflash.h"
+
+void vApplicationMallocFailedHook(void);
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
+
+/* first sector of the flash, erased by the test */
+#define TEST_ADDR 0
+#define TEST_SIZE 1024
+#define NB_ASYNC  4
+#define STREAM_CHUNK 16
+
+static uint8_t pattern[TEST_SIZE];
+/* one more byte for the unaligned reads */
+static uint32_t rx_words[TEST_SIZE / 4 + 1];
+
+static inline uint32_t cycles(void)
+{
+	return csr_read(CSR_MCYCLE);
+}
+
+static int open_flash(struct pi_device *flash, uint32_t cache_lines)
+{
+	struct pi_spiflash_conf conf;
+
+	pi_spiflash_conf_init(&conf);
+	conf.cache_lines = cache_lines;
+	pi_open_from_conf(flash, &conf);
+	if (pi_spiflash_open(flash)) {
+		printf("spiflash open failed\n");
+		return -1;
+	}
+	return 0;
+}
+
+/* Reads at every offset into a word and with sizes which are not a multiple
+ * of a word. */
+static int check_reads(struct pi_device *flash, const char *name)
+{
+	static const uint32_t sizes[] = { 1, 3, 4, 61, 256, 513, TEST_SIZE - 3 };
+	uint8_t *rx = (uint8_t *)rx_words;
+	int errors = 0;
+
+	for (uint32_t offset = 0; offset < 4; offset++) {
+		for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+			uint32_t size = sizes[i];
+			uint32_t addr = (offset * 7) % (TEST_SIZE - size + 1);
+			memset(rx, 0, sizeof(rx_words));
+			if (pi_spiflash_read(flash, TEST_ADDR + addr,
+					     &rx[offset], size) ||
+			    memcmp(&rx[offset], &pattern[addr], size)) {
+				printf("%s: read of %" PRIu32 " bytes at %" PRIu32
+				       " into +%" PRIu32 " differs\n",
+				       name, size, addr, offset);
+				errors++;
+			}
+		}
+	}
+	return errors;
+}
+
+/* The second read of a line must be served from the cache. */
+static int check_cache_hit(struct pi_device *flash)
+{
+	uint8_t *rx = (uint8_t *)rx_words;
+	uint32_t start = cycles();
+	pi_spiflash_read(flash, TEST_ADDR + 512, rx, 16);
+	uint32_t miss = cycles() - start;
+	start = cycles();
+	pi_spiflash_read(flash, TEST_ADDR + 520, rx, 16);
+	uint32_t hit = cycles() - start;
+
+	printf("cache miss %" PRIu32 " cycles, hit %" PRIu32 " cycles\n", miss,
+	       hit);
+	if ((hit >= miss) || memcmp(rx, &pattern[520], 16)) {
+		printf("cache hit failed\n");
+		return 1;
+	}
+	return 0;
+}
+
+/* Small sequential reads, each line is read ahead while the previous one is
+ * consumed. A single line cache has no room for it and must not read ahead
+ * into the line being returned. */
+static int check_stream(struct pi_device *flash, const char *name)
+{
+	uint8_t *rx = (uint8_t *)rx_words;
+	int errors = 0;
+
+	memset(rx, 0, sizeof(rx_words));
+	uint32_t start = cycles();
+	for (uint32_t addr = 0; addr < TEST_SIZE; addr += STREAM_CHUNK) {
+		if (pi_spiflash_read(flash, TEST_ADDR + addr, &rx[addr],
+				     STREAM_CHUNK)) {
+			errors++;
+		}
+	}
+	uint32_t stop = cycles();
+
+	printf("%s stream: %" PRIu32 " cycles for %d bytes\n", name,
+	       stop - start, TEST_SIZE);
+	if (errors || memcmp(rx, pattern, TEST_SIZE)) {
+		printf("%s stream differs\n", name);
+		return 1;
+	}
+	return 0;
+}
+
+/* Operations still queued at close are completed with an error. The worker
+ * runs them in order, once one is dropped all the following ones are. */
+static int check_async_close(struct pi_device *flash)
+{
+	pi_task_t tasks[NB_ASYNC];
+	int errors = 0;
+	int failed = 0;
+
+	for (int i = 0; i < NB_ASYNC; i++) {
+		pi_task_block(&tasks[i]);
+		pi_spiflash_program_async(flash, TEST_ADDR + i * 256, pattern,
+					  256, &tasks[i]);
+	}
+	pi_spiflash_close(flash);
+
+	for (int i = 0; i < NB_ASYNC; i++) {
+		pi_task_wait_on(&tasks[i]);
+		int32_t status = pi_task_status_get(&tasks[i]);
+		if (status == -1) {
+			failed++;
+		} else if ((status != 0) || failed) {
+			printf("async close: operation %d status %" PRId32 "\n",
+			       i, status);
+			errors++;
+		}
+		pi_task_destroy(&tasks[i]);
+	}
+	printf("async close: %d of %d operations dropped\n", failed, NB_ASYNC);
+	return errors;
+}
+
+static void test_spiflash(void)
+{
+	struct pi_device flash;
+	int errors = 0;
+
+	for (int i = 0; i < TEST_SIZE; i++) {
+		pattern[i] = (uint8_t)(i * 13 + (i >> 8));
+	}
+
+	/* Enable the cycle counter. */
+	csr_write(CSR_MCOUNTINHIBIT, 0);
+
+	if (open_flash(&flash, 4)) {
+		exit(1);
+	}
+	if (pi_spiflash_erase_sector(&flash, TEST_ADDR) ||
+	    pi_spiflash_program(&flash, TEST_ADDR, pattern, TEST_SIZE)) {
+		printf("spiflash program failed\n");
+		exit(1);
+	}
+	/* programming invalidated the lines, the first read misses */
+	errors += check_cache_hit(&flash);
+	errors += check_reads(&flash, "cached");
+	errors += check_stream(&flash, "cached");
+	pi_spiflash_close(&flash);
+
+	if (open_flash(&flash, 1)) {
+		exit(1);
+	}
+	errors += check_reads(&flash, "one line");
+	errors += check_stream(&flash, "one line");
+	pi_spiflash_close(&flash);
+
+	/* unaligned reads go through the bounce buffer */
+	if (open_flash(&flash, 0)) {
+		exit(1);
+	}
+	errors += check_reads(&flash, "uncached");
+	errors += check_async_close(&flash);
+
+	if (errors) {
+		printf("spiflash: %d errors\n", errors);
+		exit(1);
+	}
+	printf("spiflash ok\n");
+	exit(0);
+}
+
+int main(void)
+{
+	/* Init board hardware. */
+	system_init();
+
+	printf("spi flash test\n");
+	return pmsis_kickoff((void *)test_spiflash);
+}
+
+/* Some debugging help */
+void vApplicationMallocFailedHook(void)
+{
+	taskDISABLE_INTERRUPTS();
+	printf("error: application malloc failed\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+	(void)pcTaskName;
+	(void)pxTask;
+
+	taskDISABLE_INTERRUPTS();
+	printf("error: stack overflow\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2021 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Sleep through long delays without the periodic tick and check the tick
+ * count against the free running high half of the FC timer.
+ */
+
+/* FreeRTOS kernel includes. */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* c stdlib */
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+/* system includes */
+#include "system.h"
+#include "pulp_mem_map.h"
+#include "timer.h"
+#include "io.h"
+
+/* pmsis */
+#include "target.h"
+#include "os.h"
+
+void vApplicationMallocFailedHook(void);
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
+
+#define DELAY_TICKS 100
+/* timer counts per tick */
+#define TICK_PERIOD (ARCHI_REF_CLOCK / configTICK_RATE_HZ)
+
+volatile uint32_t idle_sleeps;
+
+static inline uint32_t wall_clock(void)
+{
+	return readw((uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CNT_HI_OFFSET));
+}
+
+static void test_tickless(void)
+{
+	/* free running on the reference clock */
+	writew(TIMER_CFG_HI_ENABLE_MASK | TIMER_CFG_HI_RESET_MASK |
+		       TIMER_CFG_HI_CLKCFG_MASK,
+	       (uintptr_t)(PULP_FC_TIMER_ADDR + TIMER_CFG_HI_OFFSET));
+
+	for (int i = 1; i <= 3; i++) {
+		uint32_t sleeps = idle_sleeps;
+		TickType_t start = xTaskGetTickCount();
+		uint32_t wall = wall_clock();
+
+		vTaskDelay(i * DELAY_TICKS);
+
+		uint32_t ticks = xTaskGetTickCount() - start;
+		wall = wall_clock() - wall;
+		sleeps = idle_sleeps - sleeps;
+		printf("delay %d: %" PRIu32 " ticks, %" PRIu32
+		       " timer counts, %" PRIu32 " sleeps\n",
+		       i * DELAY_TICKS, ticks, wall, sleeps);
+
+		if (ticks < (uint32_t)i * DELAY_TICKS) {
+			printf("woke up early\n");
+			exit(1);
+		}
+		/* a tick of slack on each side */
+		if (wall + TICK_PERIOD < ticks * TICK_PERIOD ||
+		    wall > (ticks + 1) * TICK_PERIOD) {
+			printf("tick count drifted from the timer\n");
+			exit(1);
+		}
+		if (sleeps == 0 || sleeps > 4) {
+			printf("expected a few long sleeps\n");
+			exit(1);
+		}
+	}
+	exit(0);
+}
+
+int main(void)
+{
+	/* Init board hardware. */
+	system_init();
+
+	printf("tickless idle test\n");
+	return pmsis_kickoff((void *)test_tickless);
+}
+
+/* Some debugging help */
+void vApplicationMallocFailedHook(void)
+{
+	taskDISABLE_INTERRUPTS();
+	printf("error: application malloc failed\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+	(void)pcTaskName;
+	(void)pxTask;
+
+	taskDISABLE_INTERRUPTS();
+	printf("error: stack overflow\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2021 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Run-time statistics and task switch trace. A busy task runs whenever the
+ * others sleep, a periodic task wakes up on each tick. Both must show up in
+ * the run time counters and in the trace, along with the tick interrupts.
+ * Feed the output to scripts/trace2perfetto to look at it.
+ */
+
+/* FreeRTOS kernel includes. */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* c stdlib */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/* system includes */
+#include "system.h"
+#include "irq.h"
+#include "trace.h"
+
+/* pmsis */
+#include "target.h"
+#include "os.h"
+
+void vApplicationMallocFailedHook(void);
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
+
+#define TRACE_TICKS 20
+
+extern struct trace_buf trace_buf;
+
+static volatile uint32_t busy_count;
+static volatile uint32_t periodic_count;
+
+static void busy(void *arg)
+{
+	for (;;)
+		busy_count++;
+}
+
+static void periodic(void *arg)
+{
+	for (;;) {
+		for (int i = 0; i < 100; i++)
+			periodic_count++;
+		vTaskDelay(1);
+	}
+}
+
+static uint32_t count_records(uint16_t type, uint16_t id)
+{
+	uint32_t nb = trace_buf.count < TRACE_NB_RECORDS ? trace_buf.count :
+							     TRACE_NB_RECORDS;
+	uint32_t found = 0;
+
+	for (uint32_t i = 0; i < nb; i++) {
+		if (trace_buf.records[i].type == type &&
+		    trace_buf.records[i].id == id)
+			found++;
+	}
+	return found;
+}
+
+static uint32_t runtime_of(TaskHandle_t task)
+{
+	TaskStatus_t status;
+
+	vTaskGetInfo(task, &status, pdFALSE, eInvalid);
+	return status.ulRunTimeCounter;
+}
+
+static void test_trace(void)
+{
+	TaskHandle_t tasks[2];
+	int errors = 0;
+
+	if (xTaskCreate(busy, "busy", configMINIMAL_STACK_SIZE, NULL,
+			tskIDLE_PRIORITY, &tasks[0]) != pdPASS ||
+	    xTaskCreate(periodic, "periodic", configMINIMAL_STACK_SIZE, NULL,
+			tskIDLE_PRIORITY + 2, &tasks[1]) != pdPASS) {
+		printf("failed to create tasks\n");
+		exit(1);
+	}
+
+	trace_start();
+	vTaskDelay(TRACE_TICKS);
+	trace_stop();
+
+	trace_print_task_stats();
+	trace_dump();
+
+	for (int i = 0; i < 2; i++) {
+		const char *name = pcTaskGetName(tasks[i]);
+		UBaseType_t id = uxTaskGetTaskNumber(tasks[i]);
+
+		if (id >= TRACE_NB_TASKS ||
+		    strcmp(trace_buf.names[id], name) != 0) {
+			printf("%s: not named in the trace\n", name);
+			errors++;
+			continue;
+		}
+		if (count_records(TRACE_TASK_IN, id) == 0 ||
+		    count_records(TRACE_TASK_OUT, id) == 0) {
+			printf("%s: no task switches traced\n", name);
+			errors++;
+		}
+		if (runtime_of(tasks[i]) == 0) {
+			printf("%s: no run time counted\n", name);
+			errors++;
+		}
+	}
+
+	uint32_t ticks = count_records(TRACE_IRQ_ENTER, IRQ_FC_EVT_TIMER0_LO);
+	if (ticks < TRACE_TICKS / 2 ||
+	    ticks != count_records(TRACE_IRQ_EXIT, IRQ_FC_EVT_TIMER0_LO)) {
+		printf("tick interrupts: %" PRIu32 " traced\n", ticks);
+		errors++;
+	}
+
+	if (errors) {
+		printf("trace: %d errors\n", errors);
+		exit(1);
+	}
+	printf("trace: %" PRIu32 " records ok\n", trace_buf.count);
+	exit(0);
+}
+
+int main(void)
+{
+	/* Init board hardware. */
+	system_init();
+
+	printf("trace test\n");
+	return pmsis_kickoff((void *)test_trace);
+}
+
+/* Some debugging help */
+void vApplicationMallocFailedHook(void)
+{
+	taskDISABLE_INTERRUPTS();
+	printf("error: application malloc failed\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+	(void)pcTaskName;
+	(void)pxTask;
+
+	taskDISABLE_INTERRUPTS();
+	printf("error: stack overflow\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
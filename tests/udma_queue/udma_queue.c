@@ -0,0 +1,338 @@
+/*
+ * Copyright 2020 ETH Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+ * Check the ordering and channel ownership of udma_queue, including tasks
+ * parked while it is full and tasks pushed from an interrupt handler. Compare
+ * the interrupt-disabled time with the linked list fifo the drivers used
+ * before: every section with interrupts masked is timed, for the fifo and for
+ * the queue on the producer path and on the overflow path.
+ */
+
+/* FreeRTOS kernel includes. */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* c stdlib */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/* system includes */
+#include "system.h"
+#include "csr.h"
+#include "irq.h"
+#include "riscv.h"
+
+/* pmsis */
+#include "target.h"
+#include "os.h"
+
+void vApplicationMallocFailedHook(void);
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
+
+#define BENCH_ITERATIONS 1000
+/* Transfers in flight in each iteration, kept below the queue size. */
+#define BENCH_DEPTH 8
+/* Tasks pushed beyond the queue size in the overflow check. */
+#define OVERFLOW_DEPTH 4
+/* Tasks queued before the interrupt handler pushes. */
+#define ISR_DEPTH 4
+
+#define SW_IRQ IRQ_FC_EVT_SW5
+
+static inline uint32_t cycles(void)
+{
+	return csr_read(CSR_MCYCLE);
+}
+
+/* Worst time and number of the sections with interrupts masked. */
+struct masked_stat {
+	uint32_t max;
+	uint32_t count;
+};
+
+static struct masked_stat masked;
+static uint32_t masked_start;
+
+static uint32_t bench_irq_disable(void)
+{
+	uint32_t irq = __disable_irq();
+	masked.count++;
+	masked_start = cycles();
+	return irq;
+}
+
+static void bench_irq_restore(uint32_t irq)
+{
+	uint32_t elapsed = cycles() - masked_start;
+	if (elapsed > masked.max)
+		masked.max = elapsed;
+	__restore_irq(irq);
+}
+
+/* time the masked sections of the queue */
+#define udma_queue_irq_disable()    bench_irq_disable()
+#define udma_queue_irq_restore(irq) bench_irq_restore(irq)
+#include "udma_queue.h"
+
+static pi_task_t tasks[UDMA_QUEUE_SIZE + OVERFLOW_DEPTH];
+static struct udma_queue queue;
+
+/* Former driver fifo, every access runs with interrupts disabled. */
+struct locked_fifo {
+	struct pi_task *head;
+	struct pi_task *tail;
+};
+
+static void locked_enqueue(struct locked_fifo *fifo, struct pi_task *task)
+{
+	uint32_t irq = bench_irq_disable();
+	task->next = NULL;
+	if (fifo->head == NULL) {
+		fifo->head = task;
+	} else {
+		fifo->tail->next = task;
+	}
+	fifo->tail = task;
+	bench_irq_restore(irq);
+}
+
+static struct pi_task *locked_pop(struct locked_fifo *fifo)
+{
+	uint32_t irq = bench_irq_disable();
+	struct pi_task *task = fifo->head;
+	if (task != NULL) {
+		fifo->head = task->next;
+		if (fifo->head == NULL)
+			fifo->tail = NULL;
+	}
+	bench_irq_restore(irq);
+	return task;
+}
+
+static struct masked_stat masked_take(void)
+{
+	struct masked_stat stat = masked;
+	masked.max = 0;
+	masked.count = 0;
+	return stat;
+}
+
+/* Pop nb tasks in order, the last one drops the channel. */
+static int pop_all(struct pi_task **expect, int nb)
+{
+	int errors = 0;
+	for (int j = 0; j < nb; j++) {
+		if (udma_queue_pop(&queue) != expect[j])
+			errors++;
+		if (udma_queue_next(&queue) != ((j < nb - 1) ? expect[j + 1] :
+							       NULL))
+			errors++;
+	}
+	return errors;
+}
+
+static int bench_fifo(void)
+{
+	static struct locked_fifo fifo;
+	int errors = 0;
+
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		/* Submitters enqueue, end of transfer pops. */
+		for (int j = 0; j < BENCH_DEPTH; j++)
+			locked_enqueue(&fifo, &tasks[j]);
+		for (int j = 0; j < BENCH_DEPTH; j++) {
+			if (locked_pop(&fifo) != &tasks[j])
+				errors++;
+		}
+	}
+	return errors;
+}
+
+/* The producer task pushes, the first push claims the channel, the end of
+ * transfer hands it over until the queue is empty. */
+static int bench_queue(void)
+{
+	struct pi_task *expect[BENCH_DEPTH];
+	int errors = 0;
+
+	for (int j = 0; j < BENCH_DEPTH; j++)
+		expect[j] = &tasks[j];
+
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		for (int j = 0; j < BENCH_DEPTH; j++) {
+			if (udma_queue_push(&queue, &tasks[j]))
+				errors++;
+			struct pi_task *task = udma_queue_claim(&queue);
+			if ((j == 0) != (task == &tasks[0]))
+				errors++;
+		}
+		errors += pop_all(expect, BENCH_DEPTH);
+	}
+	return errors;
+}
+
+/* Past the queue size tasks are parked and run in push order. */
+static int check_overflow(void)
+{
+	struct pi_task *expect[UDMA_QUEUE_SIZE + OVERFLOW_DEPTH];
+	int errors = 0;
+
+	for (int j = 0; j < UDMA_QUEUE_SIZE + OVERFLOW_DEPTH; j++) {
+		expect[j] = &tasks[j];
+		udma_queue_push_defer(&queue, &tasks[j]);
+	}
+	if (udma_queue_push(&queue, &tasks[0]) != -1)
+		errors++;
+	if (udma_queue_claim(&queue) != &tasks[0])
+		errors++;
+	errors += pop_all(expect, UDMA_QUEUE_SIZE + OVERFLOW_DEPTH);
+	return errors;
+}
+
+static pi_task_t isr_task;
+static struct pi_task *volatile isr_claimed;
+static volatile int isr_done;
+
+void sw_handler(void)
+{
+	udma_queue_push_defer(&queue, &isr_task);
+	isr_claimed = udma_queue_claim(&queue);
+	isr_done = 1;
+}
+
+static void isr_push(void)
+{
+	isr_done = 0;
+	irq_pend(SW_IRQ);
+	while (!isr_done)
+		;
+}
+
+/* An interrupt handler pushes behind the producer's tasks, and claims the
+ * channel when it is idle. */
+static int check_isr(void)
+{
+	struct pi_task *expect[ISR_DEPTH + 1];
+	int errors = 0;
+
+	irq_set_handler(SW_IRQ, sw_handler);
+	irq_enable(SW_IRQ);
+
+	for (int j = 0; j < ISR_DEPTH; j++) {
+		expect[j] = &tasks[j];
+		udma_queue_push(&queue, &tasks[j]);
+	}
+	expect[ISR_DEPTH] = &isr_task;
+	if (udma_queue_claim(&queue) != &tasks[0])
+		errors++;
+	isr_push();
+	if (isr_claimed != NULL)
+		errors++;
+	errors += pop_all(expect, ISR_DEPTH + 1);
+
+	isr_push();
+	if (isr_claimed != &isr_task)
+		errors++;
+	errors += pop_all(expect + ISR_DEPTH, 1);
+
+	irq_disable(SW_IRQ);
+	return errors;
+}
+
+static void print_masked(const char *name, struct masked_stat stat)
+{
+	printf("%s: %" PRIu32 " IRQ disabled sections, worst %" PRIu32
+	       " cycles\n",
+	       name, stat.count, stat.max);
+}
+
+static void bench(void)
+{
+	int errors = 0;
+
+	/* Enable the cycle counter. */
+	csr_write(CSR_MCOUNTINHIBIT, 0);
+	udma_queue_init(&queue);
+
+	errors += bench_fifo();
+	struct masked_stat fifo = masked_take();
+
+	/* the first push makes this task the producer */
+	udma_queue_push(&queue, &tasks[0]);
+	struct pi_task *first = udma_queue_claim(&queue);
+	if (first != &tasks[0])
+		errors++;
+	errors += pop_all(&first, 1);
+	masked_take();
+
+	errors += bench_queue();
+	struct masked_stat producer = masked_take();
+	if (producer.count != 0) {
+		printf("udma_queue: producer path masks interrupts\n");
+		errors++;
+	}
+
+	errors += check_overflow();
+	errors += check_isr();
+	struct masked_stat parked = masked_take();
+
+	if (!udma_queue_empty(&queue) || (queue.owned != 0))
+		errors++;
+
+	print_masked("locked fifo", fifo);
+	print_masked("udma_queue producer", producer);
+	print_masked("udma_queue overflow and interrupt", parked);
+
+	if (errors) {
+		printf("udma_queue: %d errors\n", errors);
+		pmsis_exit(EXIT_FAILURE);
+	}
+	pmsis_exit(EXIT_SUCCESS);
+}
+
+/* Program Entry. */
+int main(void)
+{
+	/* Init board hardware. */
+	system_init();
+
+	return pmsis_kickoff((void *)bench);
+}
+
+void vApplicationMallocFailedHook(void)
+{
+	taskDISABLE_INTERRUPTS();
+	printf("error: application malloc failed\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+	(void)pcTaskName;
+	(void)pxTask;
+
+	taskDISABLE_INTERRUPTS();
+	printf("error: stack overflow\n");
+	__asm volatile("ebreak");
+	for (;;)
+		;
+}